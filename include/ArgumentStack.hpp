@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "Object.hpp"
+
+namespace Lox {
+
+/**
+ * Storage for the arguments of calls in progress, owned by an Interpreter.
+ *
+ * Arguments are evaluated straight into slots of the stack and handed to
+ * the callee as a span. The stack grows in chunks that never move, so a
+ * span stays valid while nested calls push their own arguments, and
+ * once warmed up calls don't allocate for their arguments at all.
+ * */
+class ArgumentStack
+{
+public:
+  /**
+   * Slots of one call, released when the frame goes out of scope.
+   * */
+  class Frame
+  {
+  public:
+    Object& operator[](std::size_t i) noexcept { return slots[i]; }
+    Arguments arguments() const noexcept { return { slots, count }; }
+
+    Frame(Frame const&) = delete;
+    Frame& operator=(Frame const&) = delete;
+    ~Frame();
+
+  private:
+    friend class ArgumentStack;
+
+    Frame(ArgumentStack& stack,
+          Object* slots,
+          std::size_t count,
+          std::size_t chunk,
+          std::size_t top) noexcept;
+
+    ArgumentStack& stack;
+    Object* slots;
+    std::size_t count;
+    // position to return to
+    std::size_t chunk;
+    std::size_t top;
+  };
+
+  /**
+   * Reserves count contiguous slots holding nil.
+   * */
+  Frame push(std::size_t count);
+
+  ArgumentStack();
+  ArgumentStack(ArgumentStack const&) = delete;
+  ArgumentStack& operator=(ArgumentStack const&) = delete;
+
+  static constexpr std::size_t chunk_size = 1024UL;
+
+private:
+  struct Chunk
+  {
+    std::unique_ptr<Object[]> slots;
+    std::size_t size;
+  };
+
+  void pop(Frame const& frame) noexcept;
+
+private:
+  std::vector<Chunk> chunks;
+  std::size_t current;
+  std::size_t top;
+};
+
+} // namespace Lox
\ No newline at end of file
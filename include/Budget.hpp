@@ -0,0 +1,122 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace Lox {
+
+struct BudgetOptions
+{
+  // loop iterations and calls per interpret(), 0 for no limit
+  std::uint64_t fuel = 0UL;
+  // wall-clock time per interpret(), 0 for no limit
+  std::chrono::milliseconds time{};
+  // bytes of strings, environments and functions allocated per
+  // interpret(), 0 for no limit
+  std::size_t heap_bytes = 0UL;
+};
+
+/**
+ * Limits on what one interpret() may use, exceeding them ends the
+ * script with a LoxRuntimeError.
+ *
+ * Loop iterations and calls tick, which only decrements a countdown.
+ * The fuel left and the deadline are checked when it runs out, at least
+ * every check_interval ticks, so without limits a tick is all it costs.
+ *
+ * Objects are values that copy their strings, so the heap quota counts
+ * the bytes a script allocates, not the ones it holds at a time. Natives
+ * growing buffers, like those of maps, arrays and string builders, count
+ * the bytes they grow by.
+ *
+ * Tasks get a copy of the spawning interpreter's budget, each may use
+ * the fuel and heap left at the spawn and ends at the same deadline.
+ * */
+class Budget
+{
+public:
+  /**
+   * At loop iterations and calls.
+   * */
+  void tick()
+  {
+    if (--countdown == 0UL) {
+      refill();
+    }
+  }
+
+  void allocate(std::size_t bytes)
+  {
+    allocated += bytes;
+    if (allocated > quota) {
+      overQuota();
+    }
+  }
+
+  /**
+   * Starts counting afresh, at the start of interpret().
+   * */
+  void start();
+
+  /**
+   * Whether ticks may end the script. Native code of the jit
+   * doesn't tick, so it doesn't run then.
+   * */
+  bool metered() const noexcept
+  {
+    return options.fuel > 0UL || options.time.count() > 0;
+  }
+
+  /**
+   * When the time is up, for blocking waits to give up then.
+   * Nullopt without a time limit.
+   * */
+  std::optional<std::chrono::steady_clock::time_point> waitLimit()
+    const noexcept
+  {
+    if (options.time.count() > 0) {
+      return deadline;
+    }
+    return std::nullopt;
+  }
+
+  /**
+   * A LoxRuntimeError once the time is up, after a wait
+   * ended by waitLimit().
+   * */
+  void checkTime();
+
+  std::uint64_t fuelUsed() const noexcept { return burned + batch - countdown; }
+  std::size_t allocatedBytes() const noexcept { return allocated; }
+
+  explicit Budget(BudgetOptions options = {});
+
+  static constexpr std::uint64_t check_interval = 1024UL;
+
+private:
+  void refill();
+  [[noreturn]] void overQuota() const;
+  [[noreturn]] void timeUp();
+
+  /**
+   * Makes the next tick check again, for an exhausted budget
+   * to keep failing.
+   * */
+  void exhaust() noexcept;
+
+private:
+  BudgetOptions options;
+  // ticks left until the next check
+  std::uint64_t countdown;
+  // ticks the current countdown started with
+  std::uint64_t batch;
+  // ticks before the current countdown
+  std::uint64_t burned;
+  std::chrono::steady_clock::time_point deadline;
+  std::size_t allocated;
+  std::size_t quota;
+};
+
+} // namespace Lox
\ No newline at end of file
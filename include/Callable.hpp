@@ -3,18 +3,33 @@
 #include <memory>
 
 #include "Interpreter.hpp"
+#include "Jit.hpp"
 
 namespace Lox {
 
-using CallableFn = std::function<Object(std::vector<Object> const&)>;
+class LoxFunction;
+
+/**
+ * Native implementation of a Lox function. Plain function pointers keep
+ * calls free of allocations and type erasure.
+ * */
+using NativeFn = Object (*)(Interpreter&, Arguments);
 
 class Callable
 {
 public:
   virtual size_t arity() const = 0;
-  virtual Object call(Interpreter&, std::vector<Object> const& args) const = 0;
+  virtual Object call(Interpreter&, Arguments args) const = 0;
   virtual std::string toString() const = 0;
-  virtual std::unique_ptr<Callable> clone() const = 0;
+
+  /**
+   * This if it's a function declared in Lox, whose calls the
+   * Interpreter runs on its frame stack. nullptr for natives.
+   * */
+  virtual LoxFunction const* function() const noexcept { return nullptr; }
+
+  // arity of natives that take any number of arguments
+  static constexpr size_t variadic = ~0UL;
 
   Callable() = default;
   Callable(Callable const&) = delete;
@@ -29,17 +44,32 @@ class NativeFunction : public Callable
 public:
   virtual size_t arity() const override;
 
-  virtual Object call(Interpreter&,
-                      std::vector<Object> const& args) const override;
+  virtual Object call(Interpreter& interpreter, Arguments args) const override;
 
   virtual std::string toString() const override;
-  virtual std::unique_ptr<Callable> clone() const override;
 
-  NativeFunction() = default;
-  explicit NativeFunction(CallableFn fn, size_t in_arity);
+  std::string const& name() const noexcept { return _name; }
+
+  /**
+   * Wraps a C++ function over plain values, e.g. double(double, double).
+   * Arguments are checked and unpacked by code generated for F's
+   * signature, see NativeBinding.hpp. F may take the Interpreter& first.
+   * */
+  template<auto F>
+  static std::unique_ptr<NativeFunction> bind(std::string name);
+
+  /**
+   * Code bind() generates, gets the name to report bad arguments with.
+   * */
+  using Bound = Object (*)(Interpreter&, std::string const& name, Arguments);
+
+  NativeFunction(std::string name, NativeFn fn, size_t in_arity);
+  NativeFunction(std::string name, Bound bound, size_t in_arity);
 
 private:
-  CallableFn fn;
+  std::string _name;
+  NativeFn fn;
+  Bound bound;
   size_t _arity;
 };
 
@@ -47,30 +77,66 @@ class LoxFunction : public Callable
 {
 public:
   virtual size_t arity() const override;
-  virtual Object call(Interpreter& interpreter,
-                      std::vector<Object> const& args) const override;
+  virtual Object call(Interpreter& interpreter, Arguments args) const override;
   virtual std::string toString() const override;
-  virtual std::unique_ptr<Callable> clone() const override;
+  virtual LoxFunction const* function() const noexcept override
+  {
+    return this;
+  }
+
+  SharedEnv const& closureEnvironment() const noexcept { return closure; }
 
-  LoxFunction(std::unique_ptr<FunctionDeclarationStatement>&& declaration);
-  LoxFunction(std::unique_ptr<FunctionDeclarationStatement>&& declaration,
+  LoxFunction(std::shared_ptr<FunctionDeclarationStatement const> declaration);
+  LoxFunction(std::shared_ptr<FunctionDeclarationStatement const> declaration,
               SharedEnv closure);
 
 private:
-  std::unique_ptr<FunctionDeclarationStatement> declaration;
+  friend class Interpreter;
+  friend class Jit;
+  friend class Portable;
+
+  /**
+   * Result of a call that doesn't run the body in the interpreter: a new
+   * generator, a memoized result or that of native code. Otherwise
+   * nullopt, with key set if the result of the body is to be memoized.
+   * */
+  std::optional<Object> shortcut(Interpreter& interpreter,
+                                 Arguments args,
+                                 std::optional<std::string>& key) const;
+
+  /**
+   * Environment the body runs in, the parameters bound to args.
+   * */
+  SharedEnv bind(Interpreter& interpreter, Arguments args) const;
+
+  void memoize(Interpreter& interpreter,
+               std::string key,
+               Object const& result) const;
+
+  /**
+   * Runs the body in the interpreter, bypassing memoization and jit.
+   * */
+  Object interpret(Interpreter& interpreter, Arguments args) const;
+
+private:
+  std::shared_ptr<FunctionDeclarationStatement const> declaration;
+  // declaration again, nested declarations in the body share its owner
+  std::shared_ptr<void const> owner;
   SharedEnv closure;
+  mutable JitProfile jit_profile;
 };
 
 class ReturnValue : public std::exception
 {
 public:
   Object const& value() const { return v; }
+  Object& value() { return v; }
 
   ReturnValue()
     : v(Object::null())
   {}
   ReturnValue(Object v)
-    : v(v)
+    : v(std::move(v))
   {}
 
 private:
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+#include "Budget.hpp"
+#include "NativeModule.hpp"
+#include "NativeObject.hpp"
+#include "Portable.hpp"
+
+namespace Lox {
+
+/**
+ * Bounded multi-producer multi-consumer queue of Portable values.
+ *
+ * The buffer is a ring of cells, each with a sequence number telling
+ * whether it is free for the producer or filled for the consumer of a
+ * given position (Vyukov's bounded queue). Producers and consumers
+ * claim positions with a compare-and-swap and never take a lock.
+ *
+ * Only blocking on a full or empty channel involves the kernel: waiters
+ * sleep on a futex of the opposite side's counter, which is bumped after
+ * every successful operation. Notifying is free while nobody waits.
+ * Waits of a budget with a time limit end when the time is up.
+ * */
+class Channel : public NativeObject
+{
+public:
+  static constexpr char const* type_name = "a Channel";
+
+  /**
+   * Adds value unless the channel is full or closed,
+   * value is only moved from on success.
+   * */
+  bool trySend(Portable& value);
+
+  /**
+   * Blocks while the channel is full. A LoxRuntimeError if the
+   * channel is closed or the time of budget is up.
+   * */
+  void send(Portable value, Budget* budget = nullptr);
+
+  std::optional<Portable> tryReceive();
+
+  /**
+   * Blocks while the channel is empty, nullopt once it is closed
+   * and drained. A LoxRuntimeError if the time of budget is up.
+   * */
+  std::optional<Portable> receive(Budget* budget = nullptr);
+
+  /**
+   * Wakes all waiters, values sent before stay receivable.
+   * */
+  void close() noexcept;
+
+  bool closed() const noexcept { return is_closed; }
+
+  // requested capacity rounded up to a power of two
+  std::size_t capacity() const noexcept { return mask + 1UL; }
+
+  virtual std::string toString() const override;
+
+  virtual bool shareable() const noexcept override { return true; }
+
+  explicit Channel(std::size_t capacity);
+
+private:
+  /**
+   * Sleeps until counter is bumped from seen or the time of budget
+   * is up, may wake early.
+   * */
+  void wait(std::atomic<std::uint32_t>& counter,
+            std::uint32_t seen,
+            Budget* budget);
+
+  void bump(std::atomic<std::uint32_t>& counter) noexcept;
+
+  struct Cell
+  {
+    std::atomic<std::size_t> sequence;
+    Portable value;
+    // claimed by a send that found the channel closed, holds no value
+    bool dropped = false;
+  };
+
+  std::unique_ptr<Cell[]> cells;
+  std::size_t mask;
+  std::atomic<bool> is_closed;
+
+  // positions of the next send and receive, apart to avoid false sharing
+  alignas(64) std::atomic<std::size_t> send_pos;
+  alignas(64) std::atomic<std::size_t> receive_pos;
+
+  // bumped after every send or receive, blocked threads wait on them
+  alignas(64) std::atomic<std::uint32_t> sent;
+  alignas(64) std::atomic<std::uint32_t> received;
+  // threads sleeping in wait(), bumps skip the syscall without any
+  alignas(64) std::atomic<std::uint32_t> waiting;
+};
+
+/**
+ * Adds Channel, channelSend, channelReceive, channelTryReceive
+ * and channelClose to a module.
+ * */
+void
+addChannel(NativeModule& module);
+
+} // namespace Lox
\ No newline at end of file
@@ -1,8 +1,11 @@
 #pragma once
 
-#include <map>
+#include <cstddef>
 #include <memory>
+#include <optional>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "LoxRuntimeError.hpp"
 #include "Token.hpp"
@@ -14,25 +17,188 @@ class Environment;
 using Env = std::unique_ptr<Environment>;
 using SharedEnv = std::shared_ptr<Environment>;
 
+/**
+ * Variables of one scope.
+ *
+ * Most scopes hold a handful of variables, so they live in inline slots
+ * searched linearly. Only when those run out the variables move to a
+ * hash map. The root environment, which holds the globals, uses the hash
+ * map from the start so its cells never move.
+ * */
 class Environment
 {
 public:
   void define(std::string name, Object value);
 
-  void assign(Token name, Object value);
-  //   TODO: consider if ref is needed
-  Object get(Token name) const;
+  void assign(Token const& name, Object value);
+
+  /**
+   * The stored value, valid until the variable is assigned
+   * or the environment changes otherwise.
+   * */
+  Object const& get(Token const& name) const;
+
+  /**
+   * Storage of a variable defined directly in this environment or
+   * nullptr. Redefining the variable reuses the same cell, so the
+   * pointer stays valid until the environment outgrows its inline
+   * slots, which never happens to the root environment.
+   * */
+  Object* cell(std::string const& name);
+
+  // forgets all variables and the snapshot, keeps the parent
+  void clear() noexcept;
+
+  /**
+   * Takes the variables as they are now as the state restore() goes
+   * back to. Nothing is copied up front, a variable's value is saved
+   * when it is first written afterwards, so restoring takes time in the
+   * number of variables changed rather than defined. Native objects
+   * like maps held by the variables go back as well, each saves a copy
+   * of itself on its first write. Ones that can't be copied, like files,
+   * are kept by reference.
+   *
+   * The environments functions closed over are journaled the same way,
+   * e.g. the counter of a function returned by another one. They move
+   * their variables to the hash map, so their cells don't move either.
+   *
+   * Root environment only.
+   * */
+  void snapshot();
+
+  /**
+   * Undoes the changes since snapshot(), false if there is none.
+   * Variables defined since are removed, which invalidates their cells.
+   * */
+  bool restore();
+
+  /**
+   * Saves the value of cell, about to be written through the pointer
+   * from cell(), if it is the first write since the snapshot. define()
+   * and assign() do this themselves.
+   * */
+  void preserve(Object* cell);
+
+  bool hasSnapshot() const noexcept { return journal != nullptr; }
+
+  /**
+   * Changes whenever a variable is defined, assigned or removed. Writes
+   * through a pointer from cell() call written() themselves, native
+   * values like maps changing in place don't count.
+   * */
+  std::size_t generation() const noexcept { return _generation; }
+  void written() noexcept { ++_generation; }
+
+  /**
+   * Calls fn(name, value) for every variable defined directly here.
+   * */
+  template<typename F>
+  void forEach(F&& fn) const
+  {
+    if (table) {
+      for (auto const& [name, value] : *table) {
+        fn(name, value);
+      }
+      return;
+    }
+    for (auto i = 0UL; i < count; ++i) {
+      fn(slot(i)->name, slot(i)->value);
+    }
+  }
 
   Environment();
   Environment(SharedEnv parent);
-  Environment(SharedEnv parent, std::map<std::string, Object> values);
+  Environment(Environment const&) = delete;
+  Environment& operator=(Environment const&) = delete;
+  ~Environment();
+
+  static constexpr std::size_t inline_slots = 4UL;
 
 private:
-  Object get(std::string name) const;
+  struct Slot
+  {
+    std::string name;
+    Object value;
+  };
+
+  Object const* find(std::string const& name) const;
+
+  /**
+   * Values of variables before their first write since the snapshot,
+   * nullopt for ones defined since.
+   * */
+  struct Saved
+  {
+    std::string name;
+    std::optional<Object> value;
+  };
+  struct Journal
+  {
+    std::unordered_map<Object*, Saved> cells;
+    // natives and closures reachable from the variables at the
+    // snapshot, the root's journal only
+    std::vector<std::shared_ptr<NativeObject>> natives;
+    std::vector<SharedEnv> closures;
+  };
+
+  void track(Object const& value);
+  void track(std::shared_ptr<NativeObject> const& native);
+  void track(SharedEnv const& closure);
+  void untrack() noexcept;
+
+  // moves the variables from the inline slots to the table
+  void useTable();
+
+  Slot* slot(std::size_t i) noexcept;
+  Slot const* slot(std::size_t i) const noexcept;
 
 private:
   SharedEnv parent;
-  std::map<std::string, Object> values;
+  std::size_t count;
+  alignas(Slot) std::byte slots[inline_slots * sizeof(Slot)];
+  std::unique_ptr<std::unordered_map<std::string, Object>> table;
+  std::unique_ptr<Journal> journal;
+  std::size_t _generation;
+};
+
+/**
+ * Recycles the memory of environments, owned by an Interpreter.
+ *
+ * Environments are allocated together with their shared_ptr control
+ * block from a free list. Once the last reference to an environment is
+ * gone its block goes back to the list, so steady-state calls and block
+ * executions don't reach the system allocator for their frames.
+ * */
+class EnvironmentPool : public std::enable_shared_from_this<EnvironmentPool>
+{
+public:
+  SharedEnv make(SharedEnv parent);
+
+  // blocks requested from the system allocator so far
+  std::size_t allocations() const noexcept { return fresh; }
+  // blocks handed out again from the free list
+  std::size_t reuses() const noexcept { return recycled; }
+
+  EnvironmentPool() = default;
+  EnvironmentPool(EnvironmentPool const&) = delete;
+  EnvironmentPool& operator=(EnvironmentPool const&) = delete;
+  ~EnvironmentPool();
+
+  // blocks kept on the free list at most
+  static constexpr std::size_t max_free = 4096UL;
+
+private:
+  template<typename T>
+  friend class PoolAllocator;
+
+  void* allocate(std::size_t bytes);
+  void deallocate(void* block, std::size_t bytes) noexcept;
+
+private:
+  std::vector<void*> free;
+  std::size_t block_size = 0UL;
+  std::size_t fresh = 0UL;
+  std::size_t recycled = 0UL;
 };
 
 } // namespace Lox
\ No newline at end of file
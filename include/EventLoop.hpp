@@ -0,0 +1,163 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Object.hpp"
+
+namespace Lox {
+
+class Interpreter;
+class NativeModule;
+
+/**
+ * Timers and file I/O of one interpreter, completed by callbacks.
+ *
+ * Built on epoll: pipes, FIFOs and other pollable files are read and
+ * written non-blocking on the interpreter's thread. Regular files are
+ * always ready as far as epoll is concerned, so a few I/O threads read
+ * and write those and report back through an eventfd. Callbacks only
+ * ever run on the interpreter's thread, from run().
+ * */
+class EventLoop
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * Calls fn() once delay passed, the id is for cancelTimer.
+   * */
+  std::size_t setTimer(Object fn, std::chrono::milliseconds delay);
+
+  // false if the timer already fired or was cancelled
+  bool cancelTimer(std::size_t id);
+
+  /**
+   * Calls fn(contents, nil) once the whole file is read,
+   * fn(nil, error) if that fails.
+   * */
+  void readFile(std::string const& path, Object fn);
+
+  /**
+   * Replaces the file's contents by data,
+   * then calls fn(nil) or fn(error).
+   * */
+  void writeFile(std::string const& path, std::string data, Object fn);
+
+  bool pending() const noexcept { return !callbacks.empty(); }
+
+  /**
+   * Runs callbacks as their events happen until nothing is
+   * pending. Errors of callbacks propagate, the rest stays
+   * pending for the next run. Waiting ends at the deadline of
+   * the interpreter's budget, no callback runs after it.
+   * */
+  void run(Interpreter& interpreter);
+
+  EventLoop();
+  EventLoop(EventLoop const&) = delete;
+  EventLoop& operator=(EventLoop const&) = delete;
+  ~EventLoop();
+
+  static constexpr std::size_t io_threads = 4UL;
+
+private:
+  struct Timer
+  {
+    Clock::time_point deadline;
+    std::size_t id;
+
+    bool operator>(Timer const& other) const noexcept
+    {
+      return deadline != other.deadline ? deadline > other.deadline
+                                        : id > other.id;
+    }
+  };
+
+  // I/O on a pollable file, on the interpreter's thread
+  struct Watch
+  {
+    std::size_t id;
+    bool writing;
+    std::string path;
+    std::string data;
+    std::size_t written;
+  };
+
+  // I/O done by an I/O thread
+  struct Completion
+  {
+    std::size_t id;
+    bool writing;
+    std::optional<std::string> data;
+    std::optional<std::string> error;
+  };
+
+  std::size_t add(Object fn);
+
+  /**
+   * Reads or writes fd on the interpreter's thread if epoll can
+   * watch it, on an I/O thread otherwise. Takes ownership of fd.
+   * */
+  void transfer(int fd, Watch io);
+
+  void submit(std::function<Completion()> job);
+  void complete(Completion done);
+  void work(std::stop_token stop);
+
+  void collectTimers();
+  // pops the cancelled timers off the top of the heap
+  void dropCancelled();
+  void collectWatch(int fd);
+  void collectCompletions();
+
+  void schedule(std::size_t id,
+                bool writing,
+                std::optional<std::string> data,
+                std::optional<std::string> error);
+
+  /**
+   * Milliseconds epoll may wait for the next timer, at most
+   * until limit, -1 for no limit.
+   * */
+  int timeout(std::optional<Clock::time_point> limit) const;
+
+private:
+  int epoll_fd;
+  int wake_fd;
+  std::size_t next_id;
+  // callbacks of everything pending
+  std::unordered_map<std::size_t, Object> callbacks;
+  // min-heap on the deadline, cancelled timers are dropped lazily
+  std::vector<Timer> timers;
+  // timers whose callback neither ran nor was cancelled, due or not
+  std::unordered_set<std::size_t> live_timers;
+  std::unordered_map<int, Watch> watches;
+  // callbacks to run with their arguments, in order
+  std::deque<std::pair<std::size_t, std::vector<Object>>> due;
+
+  std::mutex mutex;
+  std::condition_variable_any ready;
+  std::deque<std::function<Completion()>> jobs;
+  std::vector<Completion> completions;
+  std::vector<std::jthread> threads;
+};
+
+/**
+ * The "event" module: setTimeout(fn, ms), clearTimeout(id),
+ * readFile(path, fn) and writeFile(path, data, fn).
+ * */
+NativeModule
+eventModule();
+
+} // namespace Lox
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <algorithm>
 #include <any>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -23,6 +25,34 @@ public:
 
   virtual std::any accept(ExpressionVisitor&) const = 0;
   virtual Expr clone() const = 0;
+
+  /**
+   * A function is called somewhere inside. The Interpreter steps through
+   * such expressions on its frame stack, others it visits directly.
+   * */
+  bool stepped() const { return _stepped; }
+
+protected:
+  explicit Expression(bool in_stepped)
+    : _stepped(in_stepped)
+  {}
+
+private:
+  bool _stepped = false;
+};
+
+/**
+ * Filled in by the Resolver for variable accesses which can only
+ * ever refer to a global. Sites are numbered per Resolver, the
+ * interpreter caches the global's storage cell under that number on
+ * first use, so later accesses skip the lookup. The tree itself is
+ * never written to while it runs and can be shared between threads.
+ * */
+struct GlobalSite
+{
+  bool global = false;
+  std::uint32_t unit = 0U;
+  std::uint32_t index = 0U;
 };
 
 class AssignmentExpression;
@@ -55,6 +85,7 @@ class AssignmentExpression : public Expression
 public:
   Token name() const { return _name; }
   Expression const& value() const { return *_value; }
+  GlobalSite& site() const { return _site; }
 
   virtual std::any accept(ExpressionVisitor& visitor) const override
   {
@@ -63,17 +94,23 @@ public:
 
   virtual Expr clone() const override
   {
-    return std::make_unique<AssignmentExpression>(_name, _value->clone());
+    auto cloned =
+      std::make_unique<AssignmentExpression>(_name, _value->clone());
+    cloned->_site = _site;
+    return cloned;
   }
 
   AssignmentExpression(Token in_name, Expr in_value)
-    : _name(in_name)
+    : Expression(in_value->stepped())
+    , _name(in_name)
     , _value(std::move(in_value))
+    , _site()
   {}
 
 private:
   Token _name;
   Expr _value;
+  mutable GlobalSite _site;
 };
 
 class BinaryExpression : public Expression
@@ -95,7 +132,8 @@ public:
   }
 
   BinaryExpression(Expr&& in_lhs, Token in_op, Expr&& in_rhs)
-    : _lhs(std::move(in_lhs))
+    : Expression(in_lhs->stepped() || in_rhs->stepped())
+    , _lhs(std::move(in_lhs))
     , _op(std::move(in_op))
     , _rhs(std::move(in_rhs))
   {}
@@ -112,6 +150,11 @@ public:
   std::vector<Expr> const& arguments() const { return args; }
   Expression const& callee() const { return *_callee; }
 
+  /**
+   * The callee or an argument calls a function itself.
+   * */
+  bool steppedOperands() const { return stepped_operands; }
+
   virtual std::any accept(ExpressionVisitor& visitor) const override
   {
     return visitor.visitCallExpression(*this);
@@ -129,13 +172,19 @@ public:
   }
 
   CallExpression(Expr in_callee, std::vector<Expr> args)
-    : _callee(std::move(in_callee))
+    : Expression(true)
+    , _callee(std::move(in_callee))
     , args(std::move(args))
+    , stepped_operands(_callee->stepped() ||
+                       std::any_of(this->args.begin(),
+                                   this->args.end(),
+                                   [](auto const& arg) { return arg->stepped(); }))
   {}
 
 private:
   Expr _callee;
   std::vector<Expr> args;
+  bool stepped_operands;
 };
 
 class GroupingExpression : public Expression
@@ -154,7 +203,8 @@ public:
   }
 
   GroupingExpression(Expr&& in_expr)
-    : _expr(std::move(in_expr))
+    : Expression(in_expr->stepped())
+    , _expr(std::move(in_expr))
   {}
 
 private:
@@ -188,6 +238,7 @@ class VariableExpression : public Expression
 {
 public:
   Token const& name() const { return _name; }
+  GlobalSite& site() const { return _site; }
 
   virtual std::any accept(ExpressionVisitor& visitor) const override
   {
@@ -196,15 +247,19 @@ public:
 
   virtual Expr clone() const override
   {
-    return std::make_unique<VariableExpression>(_name);
+    auto cloned = std::make_unique<VariableExpression>(_name);
+    cloned->_site = _site;
+    return cloned;
   }
 
   VariableExpression(Token in_name)
     : _name(in_name)
+    , _site()
   {}
 
 private:
   Token _name;
+  mutable GlobalSite _site;
 };
 
 class UnaryExpression : public Expression
@@ -224,7 +279,8 @@ public:
   }
 
   UnaryExpression(Token in_op, Expr&& in_rhs)
-    : _op(in_op)
+    : Expression(in_rhs->stepped())
+    , _op(in_op)
     , _rhs(std::move(in_rhs))
   {}
 
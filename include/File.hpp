@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "Iterator.hpp"
+
+namespace Lox {
+
+/**
+ * A file mapped read-only into memory. Reading it copies nothing until
+ * a script asks for its text or a line of it, and pages of a file read
+ * front to back are fetched ahead and dropped behind by the kernel.
+ *
+ * If the file is truncated while mapped, touching pages past its new
+ * end raises SIGBUS. read() and find() catch it and throw a
+ * LoxRuntimeError instead, contents() is only safe for files nobody
+ * truncates.
+ * */
+class MappedFile : public NativeObject
+{
+public:
+  static constexpr char const* type_name = "a file";
+
+  std::string_view contents() const noexcept { return { data, sz }; }
+
+  std::size_t size() const noexcept { return sz; }
+
+  /**
+   * Copy of up to len bytes from pos on.
+   * */
+  std::string read(std::size_t pos, std::size_t len) const;
+
+  /**
+   * Position of the first ch from pos on, npos if there is none.
+   * */
+  std::size_t find(char ch, std::size_t pos) const;
+
+  std::string const& path() const noexcept { return _path; }
+
+  virtual std::string toString() const override;
+
+  // a LoxRuntimeError if the file can't be opened
+  explicit MappedFile(std::string path);
+  ~MappedFile();
+
+private:
+  std::string _path;
+  char const* data;
+  std::size_t sz;
+};
+
+/**
+ * Lines of a MappedFile without their line breaks, each found only
+ * when asked for.
+ * */
+class LineIterator : public Iterator
+{
+public:
+  virtual bool hasNext(Interpreter& interpreter) override;
+
+  virtual Object next(Interpreter& interpreter) override;
+
+  virtual std::string toString() const override;
+
+  explicit LineIterator(std::shared_ptr<MappedFile const> file);
+
+private:
+  std::shared_ptr<MappedFile const> file;
+  std::size_t pos;
+};
+
+/**
+ * Output file with a buffer of its own, written out when full,
+ * on close() and when the writer goes away.
+ * */
+class FileWriter : public NativeObject
+{
+public:
+  static constexpr char const* type_name = "a file writer";
+
+  void write(std::string_view data);
+
+  void close();
+
+  virtual std::string toString() const override;
+
+  // a LoxRuntimeError if the file can't be created
+  explicit FileWriter(std::string path);
+  ~FileWriter();
+
+  static constexpr std::size_t buffer_size = 64UL * 1024UL;
+
+private:
+  void writeOut(std::string_view data);
+
+private:
+  std::string path;
+  int fd;
+  std::string buffer;
+};
+
+} // namespace Lox
\ No newline at end of file
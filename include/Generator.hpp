@@ -0,0 +1,72 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "Environment.hpp"
+#include "Interpreter.hpp"
+#include "Iterator.hpp"
+
+namespace Lox {
+
+class FunctionDeclarationStatement;
+
+/**
+ * The suspended call of a function with yields in its body.
+ *
+ * Bodies run on the interpreter's frame stack. A yield takes the tasks
+ * of the rest of the body off it, see suspend(), and the next resume
+ * puts them back on top. Nothing of the call is left on the native
+ * stack in between.
+ * */
+class Generator : public Iterator
+{
+public:
+  static constexpr char const* type_name = "a generator";
+
+  /**
+   * Runs the body up to the next yield unless that already happened,
+   * false once the body returned or ran off its end.
+   * */
+  virtual bool hasNext(Interpreter& interpreter) override;
+
+  virtual Object next(Interpreter& interpreter) override;
+
+  virtual std::string toString() const override;
+
+  /**
+   * Suspended before the first statement of declaration's
+   * body, env holds the arguments.
+   * */
+  Generator(std::shared_ptr<FunctionDeclarationStatement const> declaration,
+            std::shared_ptr<void const> owner,
+            SharedEnv env);
+
+private:
+  friend class Interpreter;
+
+  /**
+   * Runs the body up to the next yield, nullopt once
+   * it returned or ran off its end.
+   * */
+  std::optional<Object> resume(Interpreter& interpreter);
+
+  /**
+   * Keeps what is left of the body at a yield, and the
+   * environment to go on in.
+   * */
+  void suspend(std::vector<Interpreter::Task> rest, SharedEnv at);
+
+private:
+  std::shared_ptr<FunctionDeclarationStatement const> declaration;
+  std::shared_ptr<void const> owner;
+  // empty while running and once finished
+  std::vector<Interpreter::Task> tasks;
+  SharedEnv env;
+  // yielded by hasNext, not taken by next yet
+  std::optional<Object> ahead;
+  bool running;
+};
+
+} // namespace Lox
\ No newline at end of file
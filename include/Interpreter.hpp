@@ -1,13 +1,33 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "ArgumentStack.hpp"
+#include "Budget.hpp"
 #include "Environment.hpp"
+#include "EventLoop.hpp"
+#include "Jit.hpp"
 #include "LoxRuntimeError.hpp"
+#include "Memoizer.hpp"
 #include "Statement.hpp"
 
 namespace Lox {
 
+class Callable;
+class Generator;
+class LoxFunction;
+class NativeModule;
+class Program;
+struct TaskSnapshot;
+
 class Interpreter
   : public ExpressionVisitor
   , public StatementVisitor
@@ -15,7 +35,127 @@ class Interpreter
 public:
   Environment& environment();
 
-  void interpret(std::vector<Stmt> const& statements);
+  /**
+   * False if a runtime error, printed to output(), ended the statements.
+   * */
+  bool interpret(std::vector<Stmt> const& statements);
+
+  /**
+   * Runs program, which may run in other interpreters at the same time.
+   * Unlike with bare statements, functions keep referring to its tree.
+   * */
+  bool interpret(std::shared_ptr<Program const> const& program);
+
+  /**
+   * Takes the globals as they are now, e.g. after loading modules and
+   * a prelude, as the state reset() goes back to, see
+   * Environment::snapshot().
+   * */
+  void snapshot();
+
+  /**
+   * Forgets what scripts did to the globals and their pending events.
+   * Goes back to the snapshot if there is one, otherwise to only the
+   * built-in globals like a new interpreter. The frame stacks, call
+   * depth, memoization and jit are kept, memoized results are not.
+   * */
+  void reset();
+
+  /**
+   * Only the globals part of reset(), for switching globals while
+   * Lox code further up the native stack still runs, e.g. a task
+   * run by a worker that is joining another one.
+   * */
+  void resetGlobals();
+
+  /**
+   * Runs fn with globals of its own, the built-in ones, and gives the
+   * globals back afterwards. For running Lox code while code further
+   * up the native stack keeps its globals, e.g. a task run by a worker
+   * that is joining another one.
+   * */
+  void withOwnGlobals(std::function<void()> const& fn);
+
+  /**
+   * While alive, function declarations executed by the interpreter
+   * belong to the tree owner keeps alive, see LoxFunction.
+   * */
+  class CodeScope
+  {
+  public:
+    CodeScope(Interpreter& interpreter,
+              std::shared_ptr<void const> const& owner) noexcept
+      : interpreter(interpreter)
+      , previous(std::exchange(interpreter.code_owner, &owner))
+    {}
+    CodeScope(CodeScope const&) = delete;
+    CodeScope& operator=(CodeScope const&) = delete;
+    ~CodeScope() { interpreter.code_owner = previous; }
+
+  private:
+    Interpreter& interpreter;
+    std::shared_ptr<void const> const* previous;
+  };
+
+  /**
+   * Maximum number of nested calls before a script fails with
+   * a "Stack overflow." runtime error. Calls are frames on the
+   * heap, not on the native stack, a depth above
+   * limit_max_call_depth is a std::invalid_argument.
+   * */
+  size_t maxCallDepth() const noexcept { return max_call_depth; }
+  void setMaxCallDepth(size_t depth);
+
+  size_t callDepth() const noexcept { return frames.size(); }
+
+  /**
+   * Where print statements and runtime errors go, std::cout unless set.
+   * Interpreters share no mutable state, so ones with their own output
+   * can run on different threads at the same time.
+   * */
+  std::ostream& output() noexcept { return *out; }
+  void setOutput(std::ostream& output) noexcept { out = &output; }
+
+  /**
+   * Opt-in: serve calls of functions the PurityAnalyzer marked
+   * as pure from a bounded result cache.
+   * */
+  void enableMemoization(MemoOptions options = {});
+  Memoizer* memoizer() noexcept { return memo.get(); }
+
+  /**
+   * Opt-in: compile hot functions to native code.
+   * */
+  void enableJit(JitOptions options = {});
+  Jit* jit() noexcept { return _jit.get(); }
+
+  /**
+   * Opt-in: limits on fuel, time and allocations of every interpret(),
+   * see Budget.
+   * */
+  void setBudget(BudgetOptions options) { _budget = Budget{ options }; }
+  Budget& budget() noexcept { return _budget; }
+
+  /**
+   * Timers and I/O of the "event" module, started on first use.
+   * interpret() runs it after the statements until nothing is pending.
+   * */
+  EventLoop& eventLoop();
+
+  /**
+   * What spawning a task copied of the globals, for the next spawn
+   * to reuse while they are unchanged, see TaskPool.
+   * */
+  std::shared_ptr<TaskSnapshot const>& taskSnapshot() noexcept
+  {
+    return task_snapshot;
+  }
+
+  /**
+   * Storage of the global a resolved site refers to,
+   * nullptr if it isn't defined (yet).
+   * */
+  Object* globalCell(Token const& name, GlobalSite const& site);
 
   virtual void visitBlockStatement(BlockStatement const& stmt) override;
 
@@ -36,6 +176,8 @@ public:
 
   virtual void visitReturnStatement(ReturnStatement const&) override;
 
+  virtual void visitYieldStatement(YieldStatement const&) override;
+
   virtual std::any visitAssignmentExpression(
     AssignmentExpression const& expr) override;
 
@@ -56,19 +198,270 @@ public:
 
   void executeBlock(std::vector<Stmt> const&, SharedEnv);
 
+  /**
+   * Calls callee like a call expression would, e.g. for natives
+   * calling back into Lox.
+   * */
+  Object call(Object const& callee, Arguments args);
+
+  /**
+   * Defines the functions of a native module as globals.
+   * */
+  void load(NativeModule const& module);
+
+  /**
+   * Loads a registered module, throws a LoxRuntimeError
+   * if there is none of that name.
+   * */
+  void load(std::string_view module);
+
+  /**
+   * New scope below parent, allocated from the interpreter's pool.
+   * */
+  SharedEnv makeEnvironment(SharedEnv parent);
+
+  EnvironmentPool const& environmentPool() const noexcept { return *pool; }
+
+  SharedEnv const& globalEnvironment() const noexcept { return globals; }
+
+  /**
+   * The text print shows for obj.
+   * */
+  static std::string stringify(Object const& obj);
+
   Interpreter();
 
+  static constexpr size_t default_max_call_depth = 100000UL;
+  // frames and environments of some 100 MB
+  static constexpr size_t limit_max_call_depth = 1UL << 20;
+
 private:
+  // suspends and resumes its body on the frame stack
+  friend class Generator;
+  // runs its body on the frame stack
+  friend class LoxFunction;
+
+  class Stepper;
+
+  /**
+   * What is left to do of a node the interpreter is in the middle of.
+   *
+   * Lox calls don't recurse natively. Statements and expressions that
+   * call functions are stepped through on a heap-allocated stack of
+   * tasks, with their operands on a stack of values, see run(). All
+   * other nodes are visited directly, which only recurses as deep as
+   * the tree nests.
+   * */
+  struct Task
+  {
+    enum class Op : std::uint8_t
+    {
+      BLOCK,
+      BODY,
+      DISCARD,
+      PRINT,
+      DEFINE,
+      IF,
+      WHILE,
+      COUNTED,
+      RETURN,
+      YIELD,
+      EVALUATE,
+      ASSIGN,
+      LOGICAL,
+      BINARY,
+      UNARY,
+      CALL
+    };
+
+    Op op;
+    // next statement or argument, where a loop is at
+    std::uint32_t index = 0U;
+    void const* node = nullptr;
+    // to go back to after a block, reused by the bodies of a loop
+    SharedEnv env = nullptr;
+    // native counter of a counted loop and the variable it stands for
+    std::int64_t counter = 0;
+    Object* cell = nullptr;
+  };
+
+  struct CallFrame
+  {
+    Callable const* callee;
+    // Lox functions only: the operand the result replaces, the
+    // callee until then, and what to go back to on return
+    std::size_t slot = 0UL;
+    std::size_t tasks = 0UL;
+    SharedEnv env = nullptr;
+    std::shared_ptr<void const> const* code_owner = nullptr;
+    // the result is memoized under this key
+    std::optional<std::string> key = std::nullopt;
+    // resumed in place of a call, a yield suspends it
+    Generator* generator = nullptr;
+  };
+
+  /**
+   * Sizes of the stacks when a run of them started, and
+   * what it left unwinding with an exception goes back to.
+   * */
+  struct Mark
+  {
+    std::size_t tasks;
+    std::size_t operands;
+    std::size_t frames;
+    SharedEnv env;
+    std::shared_ptr<void const> const* code_owner;
+  };
+
+  /**
+   * A site's cached cell of a global.
+   * */
+  struct SiteCell
+  {
+    Object* cell = nullptr;
+    // the value was saved for the snapshot before the site wrote it
+    bool preserved = false;
+  };
+
+  SiteCell& siteCell(Token const& name, GlobalSite const& site);
+
+  // after the cells may have gone or a new snapshot was taken
+  void forgetSiteCells() noexcept;
+
+  /**
+   * Before the global name is written. Memoized results of functions
+   * calling the function it holds are dropped once it is replaced.
+   * */
+  void replacingGlobal(std::string const& name,
+                       Object const* global) noexcept;
+
+  void pushFrame(Callable const& callee);
+  void popFrame() noexcept;
+
   void execute(Statement const& stmt);
 
   Object evaluate(Expression const& expr);
 
-  static bool isTruthy(Object const& obj);
+  /**
+   * Evaluates expr on the frame stack.
+   * */
+  Object step(Expression const& expr);
 
-  static std::string stringify(Object const& obj);
+  Mark mark() const;
+
+  Object pop();
+
+  /**
+   * Steps through the tasks until the stacks are back at mark.
+   * Throws what a task throws, leaving it to unwind(mark).
+   * */
+  void run(Mark const& mark);
+
+  void unwind(Mark const& mark) noexcept;
+
+  /**
+   * Executes stmt right away if it isn't stepped,
+   * otherwise pushes the tasks to step through it.
+   * */
+  void enter(Statement const& stmt);
+
+  /**
+   * Like enter(Statement), the value ends up on the operand stack.
+   * */
+  void enter(Expression const& expr);
+
+  /**
+   * Enters a loop body, reusing frame as its environment where possible,
+   * see executeLoopBody().
+   * */
+  void enterLoopBody(Statement const& body, SharedEnv& frame);
+
+  void stepCountedLoop();
+
+  /**
+   * Calls the callee on the operand stack with the count
+   * operands above it, the result replaces all of them.
+   * */
+  void callOperands(std::size_t count);
+
+  /**
+   * Starts a call of fn whose result replaces the operand at slot.
+   * Calls that don't run the body in the interpreter finish right
+   * away, otherwise its frame is entered. args may be operands,
+   * nothing is pushed before they are bound.
+   * */
+  void startCall(LoxFunction const& fn, Arguments args, std::size_t slot);
+
+  /**
+   * Enters the body of fn in callee_env, its frame is on top already.
+   * */
+  void enterBody(LoxFunction const& fn,
+                 SharedEnv callee_env,
+                 std::size_t slot,
+                 std::optional<std::string> key);
+
+  /**
+   * Returns result from the call on top of the frames.
+   * */
+  void leave(Object result);
+
+  /**
+   * Runs a call of fn to its end, for natives calling back into Lox.
+   * callee, if fn's, keeps it alive meanwhile.
+   * */
+  Object callFunction(LoxFunction const& fn, Arguments args, Object callee);
+
+  /**
+   * Runs fn's body without the calls that bypass it, see LoxFunction.
+   * */
+  Object interpretBody(LoxFunction const& fn, Arguments args);
+
+  Object callNative(Callable const& callable, Arguments args);
+
+  static Callable const& checkCall(Object const& callee, std::size_t count);
+
+  void evaluateArguments(CallExpression const& expr,
+                         ArgumentStack::Frame& args);
+
+  void define(VarDeclarationStatement const& stmt, Object value);
+
+  void assign(AssignmentExpression const& expr, Object const& value);
+
+  Object binary(BinaryExpression const& expr,
+                Object const& lhs,
+                Object const& rhs);
+
+  static Object unary(UnaryExpression const& expr, Object const& rhs);
+
+  /**
+   * Result of an expression visit. Objects don't fit into the small
+   * buffer of std::any, so the visits leave their value here for
+   * evaluate() and return an empty any instead of a heap-allocated one.
+   * */
+  std::any produce(Object value);
+
+  static bool isTruthy(Object const& obj);
 
   static bool isEqual(Object const& lhs, Object const& rhs);
 
+  /**
+   * Runs a counted loop on a native counter, false if
+   * the regular loop has to take over from where it stopped.
+   * */
+  bool runCountedLoop(WhileStatement const& stmt,
+                      CountedLoop const& loop,
+                      SharedEnv& frame);
+
+  /**
+   * Executes one iteration of a loop body, reusing frame
+   * as its environment where possible.
+   * */
+  void executeLoopBody(Statement const& body, SharedEnv& frame);
+
+  static std::optional<Object> integerArithmetic(TokenType op,
+                                                 std::int64_t lhs,
+                                                 std::int64_t rhs);
+
   static void checkNumberOperand(Token const& op, Object const& operand);
 
   static void checkNumberOperands(Token const& op,
@@ -76,7 +469,29 @@ private:
                                   Object const& rhs);
 
 private:
+  std::shared_ptr<EnvironmentPool> pool;
   SharedEnv env;
+  SharedEnv globals;
+  // globals of withOwnGlobals() not in use
+  std::vector<SharedEnv> spare_globals;
+  ArgumentStack arg_stack;
+  Object evaluated;
+  // cells of globals by site, per resolver unit
+  std::unordered_map<std::uint32_t, std::vector<SiteCell>> site_cells;
+  std::uint32_t cached_unit;
+  std::vector<SiteCell>* cached_cells;
+  std::ostream* out;
+  // owner of the tree being executed, nullptr if declarations need copying
+  std::shared_ptr<void const> const* code_owner;
+  std::vector<CallFrame> frames;
+  std::vector<Task> tasks;
+  std::vector<Object> operands;
+  size_t max_call_depth;
+  Budget _budget;
+  std::unique_ptr<Memoizer> memo;
+  std::unique_ptr<Jit> _jit;
+  std::unique_ptr<EventLoop> events;
+  std::shared_ptr<TaskSnapshot const> task_snapshot;
 };
 
 } // namespace Lox
\ No newline at end of file
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "NativeObject.hpp"
+#include "Object.hpp"
+
+namespace Lox {
+
+class Interpreter;
+
+/**
+ * A native value the global hasNext(it) and next(it) step through,
+ * e.g. a Generator or the lines of a file.
+ * */
+class Iterator : public NativeObject
+{
+public:
+  static constexpr char const* type_name = "an iterator";
+
+  virtual bool hasNext(Interpreter& interpreter) = 0;
+
+  // the next value, nil once there are no more
+  virtual Object next(Interpreter& interpreter) = 0;
+};
+
+} // namespace Lox
\ No newline at end of file
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Object.hpp"
+
+namespace Lox {
+
+class Interpreter;
+class LoxFunction;
+class VariableExpression;
+
+struct JitOptions
+{
+  // calls before a function is compiled, 0 compiles on the first call
+  size_t threshold = 50UL;
+  // time the first native call against the interpreter
+  bool measure = false;
+};
+
+struct JitStats
+{
+  std::string function;
+  // empty if compiled, why not otherwise
+  std::string unsupported;
+  std::chrono::nanoseconds compile_time{};
+  size_t code_bytes = 0UL;
+  size_t native_calls = 0UL;
+  size_t bailouts = 0UL;
+  std::optional<double> speedup;
+};
+
+/**
+ * Machine code of a single function.
+ * */
+class CompiledFunction
+{
+public:
+  double operator()(void* context, Arguments args) const;
+
+  size_t size() const noexcept { return sz; }
+
+  /**
+   * A call of the function itself by its global name,
+   * nullptr if the function isn't recursive.
+   * */
+  VariableExpression const* selfCall() const noexcept { return self_call; }
+
+  /**
+   * Native stack a call of the function uses at most.
+   * */
+  size_t frameBytes() const noexcept { return frame_bytes; }
+
+  CompiledFunction(std::vector<unsigned char> const& code,
+                   VariableExpression const* self_call,
+                   size_t frame_bytes);
+  CompiledFunction(CompiledFunction const&) = delete;
+  CompiledFunction& operator=(CompiledFunction const&) = delete;
+  ~CompiledFunction();
+
+private:
+  void* mapping;
+  size_t sz;
+  VariableExpression const* self_call;
+  size_t frame_bytes;
+};
+
+/**
+ * Per-function bookkeeping, owned by the LoxFunction.
+ * */
+struct JitProfile
+{
+  size_t calls = 0UL;
+  bool attempted = false;
+  std::unique_ptr<CompiledFunction> code;
+  size_t stats_index = 0UL;
+};
+
+/**
+ * Baseline compiler for Linux x86-64.
+ *
+ * Compiles the body of a hot function to native code if it only consists
+ * of returns, ifs and blocks over number arithmetic on its parameters and
+ * calls of itself. Such code has no side effects, so whenever the native
+ * code can't continue (argument not a number, function no longer bound to
+ * its name, call depth exhausted) the call simply runs in the interpreter.
+ * */
+class Jit
+{
+public:
+  /**
+   * Result of running fn natively, nullopt if the interpreter has to.
+   * */
+  std::optional<Object> call(Interpreter& interpreter,
+                             LoxFunction const& fn,
+                             Arguments args);
+
+  std::vector<JitStats> const& stats() const noexcept { return _stats; }
+
+  static bool isSupportedPlatform() noexcept;
+
+  explicit Jit(JitOptions options);
+
+private:
+  void compile(LoxFunction const& fn);
+
+  std::optional<Object> run(Interpreter& interpreter,
+                            LoxFunction const& fn,
+                            Arguments args);
+
+private:
+  static constexpr size_t no_bailout = ~0UL;
+
+  JitOptions options;
+  std::vector<JitStats> _stats;
+  bool suspended;
+  size_t bailed_at;
+};
+
+} // namespace Lox
\ No newline at end of file
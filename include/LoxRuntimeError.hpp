@@ -16,6 +16,11 @@ public:
     , lexeme(lexeme)
   {}
 
+  /**
+   * What failed, e.g. the operator or the function called.
+   * */
+  std::string const& where() const noexcept { return lexeme; }
+
 private:
   std::string lexeme;
 };
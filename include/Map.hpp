@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "NativeModule.hpp"
+#include "NativeObject.hpp"
+
+namespace Lox {
+
+/**
+ * Hash map from strings, numbers, booleans and nil to any Lox value.
+ *
+ * Open addressing in the style of Swiss tables: every slot has a control
+ * byte holding 7 bits of the key's hash (or empty/deleted), probing
+ * compares a group of 16 control bytes at once and only touches entries
+ * whose bits match. Slots hold an index into a dense vector of entries,
+ * so the table itself costs 5 bytes per slot and iteration walks
+ * contiguous memory in insertion order. Erasing moves the last entry
+ * into the hole.
+ *
+ * Entries keep the full hash of their key, growing the table never
+ * hashes a string again and probing compares hashes before strings.
+ * Keys and values are stored as a Value rather than an Object, which
+ * is less than half the size.
+ *
+ * Numbers compare like in Lox, 1 and 1.0 are the same key and
+ * 0 and -0 as well. NaN isn't equal to itself and can't be a key.
+ * */
+class Map : public NativeObject
+{
+public:
+  static constexpr char const* type_name = "a Map";
+
+  /**
+   * A Lox value without the bookkeeping of Object, keys never
+   * hold integers, callables or natives.
+   * */
+  using Value = std::variant<std::monostate,
+                             bool,
+                             double,
+                             std::int64_t,
+                             std::string,
+                             std::shared_ptr<Callable>,
+                             std::shared_ptr<NativeObject>>;
+
+  struct Entry
+  {
+    std::uint64_t hash;
+    Value key;
+    Value value;
+  };
+
+  /**
+   * The value of key, nullopt if it isn't in the map.
+   * Keys that can't be in a map are a LoxRuntimeError.
+   * */
+  std::optional<Object> get(Object const& key) const;
+  bool contains(Object const& key) const;
+
+  /**
+   * Inserts key or replaces its value.
+   * */
+  void set(Object const& key, Object value);
+
+  /**
+   * True if key was in the map.
+   * */
+  bool erase(Object const& key);
+
+  std::size_t size() const noexcept { return entries.size(); }
+
+  /**
+   * Entries in insertion order, as long as nothing was erased.
+   * */
+  std::vector<Entry> const& items() const noexcept { return entries; }
+
+  /**
+   * Changes whenever a key is inserted or erased, for iterations
+   * that call back into Lox.
+   * */
+  std::size_t generation() const noexcept { return _generation; }
+
+  /**
+   * Heap memory of table and entries, strings that don't fit
+   * into std::string itself not included.
+   * */
+  std::size_t bytes() const noexcept;
+
+  virtual std::string toString() const override;
+
+  virtual std::unique_ptr<NativeObject> clone() const override;
+  virtual void restore(NativeObject& saved) override;
+  virtual void forEachNative(
+    std::function<void(std::shared_ptr<NativeObject> const&)> const& fn)
+    const override;
+
+  static Object toObject(Value const& value);
+  static Value toValue(Object const& obj);
+
+  Map() = default;
+
+private:
+  static constexpr std::size_t group_size = 16UL;
+
+  /**
+   * Position of key in entries, or of the slot it would be inserted
+   * into if it is missing.
+   * */
+  struct Probe
+  {
+    std::size_t slot;
+    bool found;
+  };
+
+  Probe probe(Object const& key, std::uint64_t hash) const;
+  Probe find(Object const& key) const;
+
+  void rehash(std::size_t capacity);
+  void place(std::size_t index, std::uint64_t hash);
+  std::size_t slotOf(std::size_t index, std::uint64_t hash) const;
+
+private:
+  std::vector<std::int8_t> control;
+  std::vector<std::uint32_t> slots;
+  std::vector<Entry> entries;
+  std::size_t tombstones = 0UL;
+  std::size_t _generation = 0UL;
+};
+
+/**
+ * The "map" module, construction of Maps and natives over them.
+ * */
+NativeModule
+mapModule();
+
+} // namespace Lox
\ No newline at end of file
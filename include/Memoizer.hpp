@@ -0,0 +1,109 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Object.hpp"
+
+namespace Lox {
+
+class FunctionDeclarationStatement;
+
+struct MemoOptions
+{
+  size_t max_entries_per_function = 1UL << 16;
+  size_t max_bytes = 64UL << 20;
+};
+
+struct MemoStats
+{
+  std::string function;
+  size_t hits = 0UL;
+  size_t misses = 0UL;
+  size_t evictions = 0UL;
+  size_t entries = 0UL;
+  size_t bytes = 0UL;
+};
+
+/**
+ * Result caches of pure functions, one per function declaration.
+ *
+ * Only calls whose arguments and result are numbers, strings, booleans
+ * or nil are cached. A function's cache is dropped as a whole once it
+ * would exceed its entry limit or the memory cap shared by all caches.
+ * The tables themselves count against the cap too, they keep the
+ * program of their function alive.
+ *
+ * Statistics are kept per function name apart from the tables, so they
+ * add up over redefinitions and tables dropped for lack of memory.
+ * */
+class Memoizer
+{
+public:
+  using Declaration = std::shared_ptr<FunctionDeclarationStatement const>;
+
+  /**
+   * Encodes args into key, false if one of them can't be memoized.
+   * */
+  static bool makeKey(Arguments args, std::string& key);
+
+  static bool isMemoizable(Object const& obj) noexcept;
+
+  Object const* lookup(Declaration const& fn, std::string const& key);
+
+  void store(Declaration const& fn, std::string key, Object const& result);
+
+  std::vector<MemoStats> stats() const;
+
+  /**
+   * Drops the results of functions depending on the top-level
+   * function name, which is about to be replaced.
+   * */
+  void invalidate(std::string const& name) noexcept;
+
+  // drops all results, tables and statistics, e.g. between unrelated scripts
+  void clear() noexcept;
+
+  size_t bytes() const noexcept { return total_bytes; }
+  // most bytes held at a time since the last clear()
+  size_t peakBytes() const noexcept { return peak_bytes; }
+
+  explicit Memoizer(MemoOptions options);
+
+private:
+  struct Table
+  {
+    // keeps the declaration alive, so its address can't be reused
+    Declaration fn;
+    std::unordered_map<std::string, Object> results;
+    size_t bytes;
+    // of the function's name in statistics
+    MemoStats* stats;
+  };
+
+  Table& table(Declaration const& fn);
+  void evict(Table& table);
+  // drops the results of table without counting an eviction
+  void drop(Table& table) noexcept;
+  void dropTables() noexcept;
+
+  /**
+   * Drops tables without results, which keep nothing
+   * but their declaration's program alive.
+   * */
+  void dropEmptyTables() noexcept;
+
+  static size_t entryBytes(std::string const& key, Object const& result);
+
+private:
+  MemoOptions options;
+  std::map<FunctionDeclarationStatement const*, Table> tables;
+  std::map<std::string, MemoStats> statistics;
+  size_t total_bytes;
+  size_t peak_bytes;
+};
+
+} // namespace Lox
\ No newline at end of file
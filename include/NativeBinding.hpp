@@ -0,0 +1,197 @@
+#pragma once
+
+#include <concepts>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "Callable.hpp"
+#include "NativeObject.hpp"
+
+namespace Lox {
+
+namespace binding {
+
+/**
+ * How a parameter of a bound C++ function is read from a Lox value.
+ * */
+template<typename T>
+struct Parameter;
+
+template<>
+struct Parameter<double>
+{
+  static constexpr char const* expected = "a number";
+  static bool accepts(Object const& obj) noexcept { return obj.isNumber(); }
+  static double get(Object const& obj) { return obj.number(); }
+};
+
+template<>
+struct Parameter<bool>
+{
+  static constexpr char const* expected = "a boolean";
+  static bool accepts(Object const& obj) noexcept { return obj.isBoolean(); }
+  static bool get(Object const& obj) { return obj.boolean(); }
+};
+
+template<>
+struct Parameter<std::string_view>
+{
+  static constexpr char const* expected = "a string";
+  static bool accepts(Object const& obj) noexcept { return obj.isString(); }
+  static std::string_view get(Object const& obj) { return obj.string(); }
+};
+
+template<>
+struct Parameter<std::string>
+{
+  static constexpr char const* expected = "a string";
+  static bool accepts(Object const& obj) noexcept { return obj.isString(); }
+  static std::string const& get(Object const& obj) { return obj.string(); }
+};
+
+template<>
+struct Parameter<Object>
+{
+  static constexpr char const* expected = "a value";
+  static bool accepts(Object const&) noexcept { return true; }
+  static Object const& get(Object const& obj) { return obj; }
+};
+
+/**
+ * Native values are passed by reference, e.g. NumberArray&.
+ * */
+template<typename T>
+  requires std::derived_from<T, NativeObject>
+struct Parameter<T>
+{
+  static constexpr char const* expected = T::type_name;
+  static bool accepts(Object const& obj) noexcept
+  {
+    return obj.native<T>() != nullptr;
+  }
+  static T& get(Object const& obj) { return *obj.native<T>(); }
+};
+
+/**
+ * Converts the result of a bound C++ function to a Lox value.
+ * */
+template<typename T>
+Object
+result(T&& value)
+{
+  using Type = std::remove_cvref_t<T>;
+  if constexpr (std::is_same_v<Type, Object>) {
+    return std::forward<T>(value);
+  } else if constexpr (std::is_same_v<Type, bool>) {
+    return Object{ value };
+  } else if constexpr (std::is_arithmetic_v<Type>) {
+    return Object{ static_cast<double>(value) };
+  } else if constexpr (std::is_same_v<Type, std::string>) {
+    return Object{ std::forward<T>(value) };
+  } else if constexpr (std::is_convertible_v<Type,
+                                             std::shared_ptr<NativeObject>>) {
+    return Object{ std::shared_ptr<NativeObject>{ std::forward<T>(value) } };
+  } else {
+    static_assert(std::is_convertible_v<Type, std::string_view>,
+                  "unsupported result type of a native function");
+    return Object{ std::string{ std::string_view{ value } } };
+  }
+}
+
+/**
+ * A LoxRuntimeError at the native name unless
+ * argument i is accepted for T.
+ * */
+template<typename T>
+void
+check(std::string const& name, Arguments args, std::size_t i)
+{
+  if (!Parameter<T>::accepts(args[i])) {
+    throw LoxRuntimeError{ "<native " + name + ">",
+                           "Argument " + std::to_string(i + 1UL) +
+                             " must be " + Parameter<T>::expected + "." };
+  }
+}
+
+template<typename Fn>
+struct Signature;
+
+template<typename R, typename... P>
+struct Signature<R (*)(P...)>
+{
+  static constexpr bool takes_interpreter = false;
+  static constexpr std::size_t arity = sizeof...(P);
+  // the parameters passed from Lox
+  using Lox = R (*)(P...);
+};
+
+/**
+ * F may take the calling interpreter first, e.g. to charge what it
+ * allocates to the budget. It isn't one of the Lox arguments.
+ * */
+template<typename R, typename... P>
+struct Signature<R (*)(Interpreter&, P...)>
+{
+  static constexpr bool takes_interpreter = true;
+  static constexpr std::size_t arity = sizeof...(P);
+  using Lox = R (*)(P...);
+};
+
+template<auto F, typename R, typename... P, std::size_t... I>
+Object
+unpack(Interpreter& interpreter,
+       std::string const& name,
+       Arguments args,
+       R (*)(P...),
+       std::index_sequence<I...>)
+{
+  (check<std::remove_cvref_t<P>>(name, args, I), ...);
+
+  auto call = [&]() -> R {
+    if constexpr (Signature<decltype(F)>::takes_interpreter) {
+      return F(interpreter, Parameter<std::remove_cvref_t<P>>::get(args[I])...);
+    } else {
+      return F(Parameter<std::remove_cvref_t<P>>::get(args[I])...);
+    }
+  };
+
+  if constexpr (std::is_void_v<R>) {
+    call();
+    return Object::null();
+  } else {
+    return result(call());
+  }
+}
+
+/**
+ * NativeFunction::Bound calling F, the interpreter
+ * checked the arity already.
+ * */
+template<auto F>
+Object
+trampoline(Interpreter& interpreter, std::string const& name, Arguments args)
+{
+  using Fn = Signature<decltype(F)>;
+  return unpack<F>(interpreter,
+                   name,
+                   args,
+                   typename Fn::Lox{},
+                   std::make_index_sequence<Fn::arity>{});
+}
+
+} // namespace binding
+
+template<auto F>
+std::unique_ptr<NativeFunction>
+NativeFunction::bind(std::string name)
+{
+  return std::make_unique<NativeFunction>(
+    std::move(name),
+    &binding::trampoline<F>,
+    binding::Signature<decltype(F)>::arity);
+}
+
+} // namespace Lox
\ No newline at end of file
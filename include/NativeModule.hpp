@@ -0,0 +1,71 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "NativeBinding.hpp"
+
+namespace Lox {
+
+/**
+ * A named group of native functions loaded into the globals
+ * of an Interpreter.
+ *
+ * Embedders bind plain C++ functions, the argument checks and
+ * conversions are generated from their signatures:
+ *
+ *   auto geometry = NativeModule{ "geometry" };
+ *   geometry.function<&distance>("distance").function<&area>("area");
+ *   NativeModule::add(std::move(geometry));
+ *
+ * Registered modules are loaded by scripts with `load("geometry");`,
+ * on the command line with `--module geometry` or by the embedder
+ * through Interpreter::load.
+ * */
+class NativeModule
+{
+public:
+  template<auto F>
+  NativeModule& function(std::string name)
+  {
+    return insert(NativeFunction::bind<F>(std::move(name)));
+  }
+
+  NativeModule& function(std::string name, NativeFn fn, size_t arity);
+
+  std::string const& name() const noexcept { return _name; }
+
+  /**
+   * Defines all functions of the module in env. The functions are
+   * immutable and shared by every environment the module is loaded in.
+   * */
+  void load(Environment& env) const;
+
+  explicit NativeModule(std::string name);
+
+  /**
+   * Registers module to be loadable by its name, replacing
+   * a module of the same name. Safe to call from any thread.
+   * */
+  static void add(NativeModule module);
+
+  static std::shared_ptr<NativeModule const> find(std::string_view name);
+
+private:
+  NativeModule& insert(std::unique_ptr<NativeFunction> fn);
+
+private:
+  std::string _name;
+  std::vector<std::shared_ptr<Callable>> functions;
+};
+
+/**
+ * Modules that are always registered: "math", "string", "time",
+ * "array", "map", "task" and "event".
+ * */
+std::vector<NativeModule>
+standardModules();
+
+} // namespace Lox
\ No newline at end of file
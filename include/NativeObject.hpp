@@ -0,0 +1,86 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace Lox {
+
+/**
+ * Base of values implemented in C++, e.g. NumberArray.
+ *
+ * Objects hold them by shared_ptr like callables, so copies of a value
+ * refer to the same instance and mutations are visible through all of
+ * them. Two native values are equal only if they are the same instance.
+ * */
+class NativeObject
+{
+public:
+  virtual std::string toString() const = 0;
+
+  /**
+   * True if the value may be used by several threads at once. Tasks
+   * share such values, others are passed to them as a clone().
+   * */
+  virtual bool shareable() const noexcept { return false; }
+
+  /**
+   * A copy of the value for a snapshot to go back to, nullptr
+   * for values that can't be copied, like files or generators.
+   * */
+  virtual std::unique_ptr<NativeObject> clone() const { return nullptr; }
+
+  /**
+   * Takes over the value of saved, a clone() of this.
+   * */
+  virtual void restore(NativeObject&) {}
+
+  /**
+   * Calls fn with every native value held by this one.
+   * */
+  virtual void forEachNative(
+    std::function<void(std::shared_ptr<NativeObject> const&)> const&) const
+  {}
+
+  /**
+   * While tracked, the first write saves a clone() that
+   * rollback() goes back to. See Environment::snapshot().
+   * */
+  void track(bool on) noexcept
+  {
+    tracked = on;
+    saved.reset();
+  }
+
+  bool isTracked() const noexcept { return tracked; }
+
+  void rollback()
+  {
+    if (saved) {
+      restore(*saved);
+      saved.reset();
+    }
+  }
+
+  NativeObject() = default;
+  NativeObject(NativeObject const&) = delete;
+  NativeObject& operator=(NativeObject const&) = delete;
+  virtual ~NativeObject() = default;
+
+protected:
+  /**
+   * Called by members before they change the value.
+   * */
+  void write()
+  {
+    if (tracked && !saved) {
+      saved = clone();
+    }
+  }
+
+private:
+  std::unique_ptr<NativeObject> saved;
+  bool tracked = false;
+};
+
+} // namespace Lox
\ No newline at end of file
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+
+namespace Lox {
+
+/**
+ * Bytes of native stack the calling thread has left, not counting a
+ * safety margin kept for the error path, natives and the exception
+ * unwinder. Lox calls don't use native stack, but natives calling back
+ * into Lox and compiled code do.
+ * */
+std::size_t
+nativeStackLeft() noexcept;
+
+} // namespace Lox
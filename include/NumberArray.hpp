@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <optional>
+#include <vector>
+
+#include "NativeModule.hpp"
+#include "NativeObject.hpp"
+
+namespace Lox {
+
+/**
+ * Allocator handing out storage aligned to Alignment bytes.
+ * */
+template<typename T, std::size_t Alignment>
+class AlignedAllocator
+{
+public:
+  using value_type = T;
+
+  template<typename U>
+  struct rebind
+  {
+    using other = AlignedAllocator<U, Alignment>;
+  };
+
+  T* allocate(std::size_t n)
+  {
+    return static_cast<T*>(
+      ::operator new(n * sizeof(T), std::align_val_t{ Alignment }));
+  }
+
+  void deallocate(T* p, std::size_t) noexcept
+  {
+    ::operator delete(p, std::align_val_t{ Alignment });
+  }
+
+  template<typename U>
+  bool operator==(AlignedAllocator<U, Alignment> const&) const noexcept
+  {
+    return true;
+  }
+
+  AlignedAllocator() = default;
+  template<typename U>
+  AlignedAllocator(AlignedAllocator<U, Alignment> const&) noexcept
+  {}
+};
+
+/**
+ * Growable array of doubles in one contiguous, cache-line aligned buffer.
+ *
+ * The bulk operations run SIMD kernels picked once for the CPU at
+ * runtime (AVX2, SSE2 or plain loops). They accumulate in several lanes,
+ * so sums may differ from a sequential loop in the last bits. Results of
+ * min and max are unspecified for arrays containing NaN, sort puts NaNs
+ * last.
+ * */
+class NumberArray : public NativeObject
+{
+public:
+  static constexpr char const* type_name = "a NumberArray";
+  static constexpr std::size_t alignment = 64UL;
+
+  std::size_t size() const noexcept { return values.size(); }
+  double* data() noexcept { return values.data(); }
+  double const* data() const noexcept { return values.data(); }
+
+  // heap memory of the buffer
+  std::size_t bytes() const noexcept
+  {
+    return values.capacity() * sizeof(double);
+  }
+
+  /**
+   * Element access, index out of range is a LoxRuntimeError.
+   * */
+  double get(std::size_t index) const;
+  void set(std::size_t index, double value);
+
+  void push(double value);
+
+  double sum() const noexcept;
+
+  /**
+   * Sizes have to match, otherwise LoxRuntimeError.
+   * */
+  double dot(NumberArray const& other) const;
+  void add(NumberArray const& other);
+
+  void scale(double factor);
+
+  std::optional<double> min() const noexcept;
+  std::optional<double> max() const noexcept;
+
+  void sort();
+
+  virtual std::string toString() const override;
+
+  virtual std::unique_ptr<NativeObject> clone() const override;
+  virtual void restore(NativeObject& saved) override;
+
+  NumberArray() = default;
+  explicit NumberArray(std::size_t size);
+
+  /**
+   * Name of the kernels in use, e.g. "avx2".
+   * */
+  static char const* kernels() noexcept;
+
+private:
+  void checkSize(NumberArray const& other) const;
+
+private:
+  std::vector<double, AlignedAllocator<double, alignment>> values;
+};
+
+/**
+ * The "array" module, construction of NumberArrays and natives over them.
+ * */
+NativeModule
+numberArrayModule();
+
+} // namespace Lox
\ No newline at end of file
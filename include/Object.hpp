@@ -1,7 +1,10 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <optional>
+#include <span>
 #include <string>
 
 #include <functional>
@@ -14,24 +17,52 @@ enum class ObjectType
   NIL,
   NUMBER,
   STRING,
-  CALLABLE
+  CALLABLE,
+  NATIVE
 };
 
 class Callable;
+class NativeObject;
 
 class Object
 {
 public:
   std::string const& string() const;
   double number() const;
+  std::int64_t integer() const;
   bool boolean() const;
   Callable& callable() const;
+  NativeObject& native() const;
+
+  /**
+   * The native value if it is a T, nullptr otherwise.
+   * */
+  template<typename T>
+  T* native() const
+  {
+    return dynamic_cast<T*>(_native.get());
+  }
+
+  /**
+   * Shared ownership of the callable or native value, for containers
+   * that keep them without a whole Object around them.
+   * */
+  std::shared_ptr<Callable> const& sharedCallable() const noexcept
+  {
+    return _callable;
+  }
+  std::shared_ptr<NativeObject> const& sharedNative() const noexcept
+  {
+    return _native;
+  }
 
   bool isString() const noexcept;
   bool isNumber() const noexcept;
+  bool isInteger() const noexcept;
   bool isBoolean() const noexcept;
   bool isNull() const noexcept;
   bool isCallable() const noexcept;
+  bool isNative() const noexcept;
 
   ObjectType type() const noexcept;
 
@@ -41,19 +72,60 @@ public:
   explicit Object(std::string str);
   explicit Object(double num);
   explicit Object(bool boolean);
-  explicit Object(std::unique_ptr<Callable> in_callable);
+  explicit Object(std::shared_ptr<Callable> in_callable);
+  explicit Object(std::shared_ptr<NativeObject> in_native);
   Object(Object const& orig);
+  Object(Object&& orig) noexcept;
   Object& operator=(Object const& orig);
+  Object& operator=(Object&& orig) noexcept;
   ~Object();
 
   static Object null();
 
+  /**
+   * Copy constructions and copy assignments of objects so far
+   * on all threads, running or exited.
+   * */
+  static std::size_t copies() noexcept;
+
+  /**
+   * Lox only knows doubles, whole numbers may internally be kept as
+   * integers though. Arithmetic on those stays exact as long as they
+   * are within +-max_integer, beyond that they become doubles again.
+   * */
+  static Object fromInteger(std::int64_t value);
+  static constexpr std::int64_t max_integer = std::int64_t{ 1 } << 53;
+
+  static constexpr bool fitsInteger(std::int64_t value) noexcept
+  {
+    return value >= -max_integer && value <= max_integer;
+  }
+
 private:
+  union Number
+  {
+    double real;
+    std::int64_t integer;
+  };
+
   std::optional<std::string> str;
-  std::optional<double> num;
+  // one slot for both kinds of numbers, integral tells which it holds
+  std::optional<Number> num;
   std::optional<bool> _boolean;
-  std::unique_ptr<Callable> _callable;
+  bool integral;
+  /**
+   * Callables are immutable, so copies of an object share one
+   * instance (and with it e.g. a function's memoized results).
+   * */
+  std::shared_ptr<Callable> _callable;
+  std::shared_ptr<NativeObject> _native;
   ObjectType _type;
 };
 
+/**
+ * Arguments of a call, a view of the interpreter's argument stack
+ * that is only valid for the duration of the call.
+ * */
+using Arguments = std::span<Object const>;
+
 } // namespace Lox
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <optional>
 #include <vector>
 
 #include "Statement.hpp"
@@ -26,6 +27,7 @@ private:
   Stmt forStatement();
   Stmt function();
   Stmt returnStatement();
+  Stmt yieldStatement();
 
   Expr expression();
   Expr assignment();
@@ -40,6 +42,10 @@ private:
   Expr call();
   Expr finishCall(Expr);
 
+  static std::optional<CountedLoop> countedLoop(Statement const* initializer,
+                                                Expression const* condition,
+                                                Expression const* incr);
+
   bool match(TokenType token_type);
   bool matchOneOf(std::vector<TokenType> token_types);
   bool check(TokenType type) const;
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "NativeObject.hpp"
+#include "Object.hpp"
+
+namespace Lox {
+
+class FunctionDeclarationStatement;
+class Interpreter;
+
+/**
+ * A value on its way from one interpreter into another.
+ *
+ * Interpreters share no mutable state, so values cross either shared,
+ * if immutable or safe to share, or as deep copies. Nil, booleans,
+ * numbers, strings, natives, shareable native values and top-level
+ * functions are shared. A top-level function keeps its tree and gets
+ * the globals of the receiving interpreter as closure. Maps are copied
+ * entry by entry, other native values by NativeObject::clone(), every
+ * receiving interpreter gets a copy of its own.
+ * */
+class Portable
+{
+public:
+  /**
+   * Portable copy of obj, a LoxRuntimeError naming it what
+   * if it can't cross interpreters.
+   * */
+  static Portable from(Interpreter const& interpreter,
+                       Object const& obj,
+                       std::string const& what);
+
+  Object toObject(Interpreter& interpreter) const&;
+  // moves strings instead of copying them
+  Object toObject(Interpreter& interpreter) &&;
+
+  Portable() = default;
+
+private:
+  struct Code
+  {
+    std::shared_ptr<FunctionDeclarationStatement const> declaration;
+  };
+
+  // owned by the Portable, copying it clones the value once more
+  struct Cloned
+  {
+    std::unique_ptr<NativeObject> value;
+
+    Cloned(std::unique_ptr<NativeObject> value) noexcept
+      : value(std::move(value))
+    {}
+    Cloned(Cloned const& orig);
+    Cloned(Cloned&&) noexcept = default;
+    Cloned& operator=(Cloned const& orig);
+    Cloned& operator=(Cloned&&) noexcept = default;
+  };
+
+  struct MapEntries
+  {
+    std::vector<Portable> keys;
+    std::vector<Portable> values;
+  };
+
+  struct Materialize;
+
+  std::variant<std::monostate,
+               bool,
+               double,
+               std::int64_t,
+               std::string,
+               Code,
+               std::shared_ptr<Callable>,
+               std::shared_ptr<NativeObject>,
+               Cloned,
+               MapEntries>
+    value;
+};
+
+} // namespace Lox
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "Statement.hpp"
+
+namespace Lox {
+
+/**
+ * A scanned, parsed and resolved script.
+ *
+ * Nothing writes to the tree of a program once it is built, so any
+ * number of interpreters can run it, one after another or at the same
+ * time on different threads. Functions it declares refer to its tree
+ * instead of copying their declaration and keep the program alive.
+ * */
+class Program
+{
+public:
+  std::vector<Stmt> const& statements() const noexcept { return _statements; }
+
+  /**
+   * Syntax errors are thrown like the Scanner and Parser do.
+   * */
+  static std::shared_ptr<Program const> compile(std::string_view src);
+
+  /**
+   * Resolves and analyzes statements fresh from the Parser.
+   * */
+  explicit Program(std::vector<Stmt> statements);
+  Program(Program const&) = delete;
+  Program& operator=(Program const&) = delete;
+
+private:
+  std::vector<Stmt> _statements;
+};
+
+} // namespace Lox
\ No newline at end of file
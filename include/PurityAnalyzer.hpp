@@ -0,0 +1,90 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "Statement.hpp"
+
+namespace Lox {
+
+/**
+ * Marks top-level functions whose result only depends on their
+ * arguments, so calls of them may be memoized.
+ *
+ * A function is pure if it doesn't print, declares no closures,
+ * assigns only its own locals and reads no other names than its
+ * locals and pure top-level functions. A top-level function which
+ * is redeclared or assigned to anywhere is never pure.
+ * */
+class PurityAnalyzer
+  : public ExpressionVisitor
+  , public StatementVisitor
+{
+public:
+  void analyze(std::vector<Stmt> const& statements);
+
+  virtual void visitBlockStatement(BlockStatement const& stmt) override;
+
+  virtual void visitExpressionStatement(
+    ExpressionStatement const& stmt) override;
+
+  virtual void visitPrintStatement(PrintStatement const& stmt) override;
+
+  virtual void visitVarDeclarationStatement(
+    VarDeclarationStatement const& stmt) override;
+
+  virtual void visitIfStatement(IfStatement const&) override;
+
+  virtual void visitWhileStatement(WhileStatement const&) override;
+
+  virtual void visitFunctionDeclarationStatement(
+    FunctionDeclarationStatement const&) override;
+
+  virtual void visitReturnStatement(ReturnStatement const&) override;
+
+  virtual void visitYieldStatement(YieldStatement const&) override;
+
+  virtual std::any visitAssignmentExpression(
+    AssignmentExpression const& expr) override;
+
+  virtual std::any visitBinaryExpression(BinaryExpression const& expr) override;
+
+  virtual std::any visitGroupingExpression(
+    GroupingExpression const& expr) override;
+
+  virtual std::any visitLiteralExpression(
+    LiteralExpression const& expr) override;
+
+  virtual std::any visitVariableExpression(
+    VariableExpression const& expr) override;
+
+  virtual std::any visitUnaryExpression(UnaryExpression const& expr) override;
+
+  virtual std::any visitCallExpression(CallExpression const&) override;
+
+  PurityAnalyzer() = default;
+
+private:
+  struct Facts
+  {
+    bool impure = false;
+    std::set<std::string> free_names;
+  };
+
+  void analyze(FunctionDeclarationStatement const& fn, Facts& facts);
+
+  void analyze(Statement const& stmt);
+  void analyze(Expression const& expr);
+
+  bool isLocal(std::string const& name) const;
+
+private:
+  // names declared so far, per scope of the function being analyzed
+  std::vector<std::set<std::string>> scopes;
+  std::set<std::string> assigned;
+  Facts* facts = nullptr;
+};
+
+} // namespace Lox
\ No newline at end of file
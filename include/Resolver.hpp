@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "Statement.hpp"
+
+namespace Lox {
+
+/**
+ * Static pass run between parsing and interpreting.
+ *
+ * Marks every variable access that can only ever refer to a global,
+ * i.e. whose name isn't declared anywhere in an enclosing block or
+ * function. Declarations later in the same scope count as well, since
+ * the interpreter looks names up at runtime and a closure may see them.
+ *
+ * Also marks which blocks need an environment of their own, which
+ * functions are generators and checks which counted loops keep their
+ * counter to themselves.
+ * */
+class Resolver
+  : public ExpressionVisitor
+  , public StatementVisitor
+{
+public:
+  void resolve(std::vector<Stmt> const& statements);
+
+  virtual void visitBlockStatement(BlockStatement const& stmt) override;
+
+  virtual void visitExpressionStatement(
+    ExpressionStatement const& stmt) override;
+
+  virtual void visitPrintStatement(PrintStatement const& stmt) override;
+
+  virtual void visitVarDeclarationStatement(
+    VarDeclarationStatement const& stmt) override;
+
+  virtual void visitIfStatement(IfStatement const&) override;
+
+  virtual void visitWhileStatement(WhileStatement const&) override;
+
+  virtual void visitFunctionDeclarationStatement(
+    FunctionDeclarationStatement const&) override;
+
+  virtual void visitReturnStatement(ReturnStatement const&) override;
+
+  virtual void visitYieldStatement(YieldStatement const&) override;
+
+  virtual std::any visitAssignmentExpression(
+    AssignmentExpression const& expr) override;
+
+  virtual std::any visitBinaryExpression(BinaryExpression const& expr) override;
+
+  virtual std::any visitGroupingExpression(
+    GroupingExpression const& expr) override;
+
+  virtual std::any visitLiteralExpression(
+    LiteralExpression const& expr) override;
+
+  virtual std::any visitVariableExpression(
+    VariableExpression const& expr) override;
+
+  virtual std::any visitUnaryExpression(UnaryExpression const& expr) override;
+
+  virtual std::any visitCallExpression(CallExpression const&) override;
+
+  Resolver();
+
+private:
+  void resolve(Statement const& stmt);
+  void resolve(Expression const& expr);
+
+  void beginScope(std::vector<Stmt> const& statements,
+                  std::vector<Token> const& params = {});
+  void endScope();
+
+  void resolveSite(Token const& name, GlobalSite& site);
+
+private:
+  std::vector<std::set<std::string>> scopes;
+  // function declarations resolved so far
+  size_t functions = 0UL;
+  // yields resolved so far in the innermost function
+  size_t yields = 0UL;
+  // counted loops whose body is being resolved
+  std::vector<CountedLoop*> loops;
+  // numbering of the global sites, unique to this resolver
+  std::uint32_t unit;
+  std::uint32_t sites = 0U;
+};
+
+} // namespace Lox
\ No newline at end of file
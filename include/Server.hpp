@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace Lox {
+
+class Interpreter;
+class Program;
+
+/**
+ * Exit statuses of scripts run by a Server, as in sysexits.h.
+ * */
+enum class ScriptStatus : int
+{
+  ok = 0,
+  bad_request = 64,
+  syntax_error = 65,
+  unreadable = 66,
+  runtime_error = 70,
+};
+
+/**
+ * A script to run on a Server, either a path the server reads
+ * or the source itself.
+ * */
+struct ScriptRequest
+{
+  enum class Kind
+  {
+    path,
+    source,
+  };
+
+  Kind kind;
+  std::string_view text;
+};
+
+struct ServerOptions
+{
+  // Unix domain socket to listen on, replaced if a stale one exists
+  std::string path;
+  // scripts run at the same time, each worker owns an interpreter
+  size_t workers = 1UL;
+  // programs kept parsed, least recently used ones are dropped
+  size_t cache_entries = 256UL;
+  // time a client has to send its request, a slower one is a bad request
+  std::chrono::milliseconds request_timeout = std::chrono::seconds{ 10 };
+  // applied to every interpreter once before its snapshot is taken,
+  // e.g. setting the call depth, loading modules or running a prelude
+  std::function<void(Interpreter&)> configure = nullptr;
+};
+
+/**
+ * Runs scripts sent over a Unix domain socket.
+ *
+ * Every connection carries one script, a "path <path>\n" or a
+ * "source <bytes>\n" header followed by the source. The reply is a
+ * stream of "out <bytes>\n" and "err <bytes>\n" frames as the script
+ * prints, ended by "exit <status>\n".
+ *
+ * Workers keep their interpreter between scripts and reset it to the
+ * snapshot taken after configuring it, and programs are parsed once
+ * per distinct source.
+ * */
+class Server
+{
+public:
+  /**
+   * Serves until stop() is called.
+   * */
+  void run();
+
+  /**
+   * Stops accepting scripts, run() returns once running ones are done.
+   * Requests still being read are answered as bad requests. Safe to
+   * call from any thread.
+   * */
+  void stop() noexcept;
+
+  size_t cachedPrograms() const;
+
+  explicit Server(ServerOptions options);
+  Server(Server const&) = delete;
+  Server& operator=(Server const&) = delete;
+  ~Server();
+
+private:
+  void work();
+
+  void serve(int client, Interpreter& interpreter);
+
+  /**
+   * The parsed program of source, compiled on the first request.
+   * */
+  std::shared_ptr<Program const> program(std::string_view source);
+
+private:
+  struct Entry
+  {
+    std::string source;
+    std::shared_ptr<Program const> program;
+    std::uint64_t used;
+  };
+
+  ServerOptions options;
+  int listener;
+  std::atomic<bool> stopping;
+  mutable std::mutex mutex;
+  std::unordered_map<std::size_t, Entry> programs;
+  std::uint64_t ticks;
+};
+
+/**
+ * Runs a script on the server listening at socket, writing its output
+ * to out and errors to err as they arrive. Returns the script's exit
+ * status, throws if the server can't be reached.
+ * */
+int
+runOnServer(std::string const& socket,
+            ScriptRequest request,
+            std::ostream& out,
+            std::ostream& err);
+
+} // namespace Lox
\ No newline at end of file
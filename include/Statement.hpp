@@ -1,5 +1,10 @@
 #pragma once
 
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
 #include "Expression.hpp"
 
 namespace Lox {
@@ -19,6 +24,31 @@ public:
 
   virtual void accept(StatementVisitor&) const = 0;
   virtual Stmt clone() const = 0;
+
+  /**
+   * A function is called or returned from somewhere inside, not counting
+   * nested declarations. The Interpreter steps through such statements on
+   * its frame stack, others it visits directly.
+   * */
+  bool stepped() const { return _stepped; }
+
+protected:
+  explicit Statement(bool in_stepped)
+    : _stepped(in_stepped)
+  {}
+
+  static bool anyStepped(std::vector<std::unique_ptr<Statement>> const& stmts)
+  {
+    for (auto const& stmt : stmts) {
+      if (stmt->stepped()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+private:
+  bool _stepped = false;
 };
 
 class BlockStatement;
@@ -29,6 +59,7 @@ class IfStatement;
 class WhileStatement;
 class FunctionDeclarationStatement;
 class ReturnStatement;
+class YieldStatement;
 
 class StatementVisitor
 {
@@ -42,6 +73,7 @@ public:
   virtual void visitFunctionDeclarationStatement(
     FunctionDeclarationStatement const&) = 0;
   virtual void visitReturnStatement(ReturnStatement const&) = 0;
+  virtual void visitYieldStatement(YieldStatement const&) = 0;
 
   StatementVisitor() = default;
   StatementVisitor(StatementVisitor const&) = delete;
@@ -65,7 +97,8 @@ public:
   }
 
   PrintStatement(Expr expr)
-    : expr(std::move(expr))
+    : Statement(expr->stepped())
+    , expr(std::move(expr))
   {}
 
 private:
@@ -77,6 +110,19 @@ class BlockStatement : public Statement
 public:
   std::vector<Stmt> const& statements() const { return _statements; }
 
+  /**
+   * Set by the Resolver. A block without declarations of its own can run
+   * in the enclosing environment, one without functions declared anywhere
+   * inside can't have its environment captured by a closure.
+   * */
+  bool hasLocals() const { return locals; }
+  bool hasClosures() const { return closures; }
+  void markScope(bool in_locals, bool in_closures) const
+  {
+    locals = in_locals;
+    closures = in_closures;
+  }
+
   virtual void accept(StatementVisitor& visitor) const override
   {
     visitor.visitBlockStatement(*this);
@@ -89,15 +135,23 @@ public:
       cloned_statements.push_back(stmt->clone());
     }
 
-    return std::make_unique<BlockStatement>(std::move(cloned_statements));
+    auto cloned =
+      std::make_unique<BlockStatement>(std::move(cloned_statements));
+    cloned->markScope(locals, closures);
+    return cloned;
   }
 
   BlockStatement(std::vector<Stmt> in_statements)
-    : _statements(std::move(in_statements))
+    : Statement(anyStepped(in_statements))
+    , _statements(std::move(in_statements))
+    , locals(true)
+    , closures(true)
   {}
 
 private:
   std::vector<Stmt> _statements;
+  mutable bool locals;
+  mutable bool closures;
 };
 
 class ExpressionStatement : public Statement
@@ -116,7 +170,8 @@ public:
   }
 
   ExpressionStatement(Expr&& expr)
-    : expr(std::move(expr))
+    : Statement(expr->stepped())
+    , expr(std::move(expr))
   {}
 
 private:
@@ -138,14 +193,16 @@ public:
 
   virtual Stmt clone() const override
   {
-    return std::make_unique<IfStatement>(_condition->clone(),
-                                         then_branch->clone(),
-                                         else_branch ? else_branch->clone()
-                                                     : nullptr);
+    return std::make_unique<IfStatement>(
+      _condition->clone(),
+      then_branch->clone(),
+      else_branch ? else_branch->clone() : nullptr);
   }
 
   IfStatement(Expr in_condition, Stmt in_then_branch, Stmt in_else_branch)
-    : _condition(std::move(in_condition))
+    : Statement(in_condition->stepped() || in_then_branch->stepped() ||
+                (in_else_branch && in_else_branch->stepped()))
+    , _condition(std::move(in_condition))
     , then_branch(std::move(in_then_branch))
     , else_branch(std::move(in_else_branch))
   {}
@@ -156,12 +213,46 @@ private:
   Stmt else_branch;
 };
 
+/**
+ * A `for (var i = ...; i < bound; i = i + step)` loop recognized by the
+ * Parser. The Resolver checks that the body never assigns the counter,
+ * only then the Interpreter may count natively.
+ * */
+struct CountedLoop
+{
+  std::string counter;
+  bool inclusive = false;
+  std::int64_t step = 1;
+  // set by the Resolver
+  bool checked = false;
+  bool body_reads_counter = false;
+};
+
 class WhileStatement : public Statement
 {
 public:
   Expression const& condition() const { return *_condition; }
   Statement const& body() const { return *_body; }
 
+  /**
+   * nullptr unless the loop is a desugared counted for loop. Its bound
+   * is the rhs of the condition, its body is the block of the original
+   * body followed by the increment.
+   * */
+  CountedLoop* countedLoop() const { return counted ? &*counted : nullptr; }
+  Expression const& bound() const
+  {
+    return static_cast<BinaryExpression const&>(*_condition).rhs();
+  }
+  Statement const& loopBody() const
+  {
+    return *static_cast<BlockStatement const&>(*_body).statements().front();
+  }
+  Statement const& increment() const
+  {
+    return *static_cast<BlockStatement const&>(*_body).statements().back();
+  }
+
   virtual void accept(StatementVisitor& visitor) const override
   {
     visitor.visitWhileStatement(*this);
@@ -169,18 +260,23 @@ public:
 
   virtual Stmt clone() const override
   {
-    return std::make_unique<WhileStatement>(_condition->clone(),
-                                            _body->clone());
+    return std::make_unique<WhileStatement>(
+      _condition->clone(), _body->clone(), counted);
   }
 
-  WhileStatement(Expr in_condition, Stmt in_body)
-    : _condition(std::move(in_condition))
+  WhileStatement(Expr in_condition,
+                 Stmt in_body,
+                 std::optional<CountedLoop> in_counted = std::nullopt)
+    : Statement(in_condition->stepped() || in_body->stepped())
+    , _condition(std::move(in_condition))
     , _body(std::move(in_body))
+    , counted(std::move(in_counted))
   {}
 
 private:
   Expr _condition;
   Stmt _body;
+  mutable std::optional<CountedLoop> counted;
 };
 
 class VarDeclarationStatement : public Statement
@@ -201,7 +297,8 @@ public:
   }
 
   VarDeclarationStatement(Token in_name, Expr in_initializer)
-    : _name(in_name)
+    : Statement(in_initializer->stepped())
+    , _name(in_name)
     , _initializer(std::move(in_initializer))
   {}
 
@@ -217,6 +314,32 @@ public:
   std::vector<Token> const& params() const { return _params; }
   std::vector<Stmt> const& body() const { return _body; }
 
+  /**
+   * Set by the PurityAnalyzer for functions whose result only
+   * depends on their arguments.
+   * */
+  bool isPure() const { return pure; }
+  void markPure(bool in_pure, std::vector<std::string> in_dependencies = {})
+    const
+  {
+    pure = in_pure;
+    dependencies = std::move(in_dependencies);
+  }
+
+  /**
+   * Sorted names of the top-level functions a pure function calls,
+   * directly or through others. Its memoized results are stale once
+   * one of them is redefined.
+   * */
+  std::vector<std::string> const& dependsOn() const { return dependencies; }
+
+  /**
+   * Set by the Resolver for functions with a yield in their body,
+   * calling them returns a Generator.
+   * */
+  bool isGenerator() const { return generator; }
+  void markGenerator(bool in_generator) const { generator = in_generator; }
+
   virtual void accept(StatementVisitor& visitor) const override
   {
     visitor.visitFunctionDeclarationStatement(*this);
@@ -229,8 +352,12 @@ public:
       cloned_body.push_back(stmt->clone());
     }
 
-    return std::make_unique<FunctionDeclarationStatement>(
+    auto cloned = std::make_unique<FunctionDeclarationStatement>(
       _name, _params, std::move(cloned_body));
+    cloned->pure = pure;
+    cloned->dependencies = dependencies;
+    cloned->generator = generator;
+    return cloned;
   }
 
   FunctionDeclarationStatement(Token in_name,
@@ -239,12 +366,18 @@ public:
     : _name(std::move(in_name))
     , _params(in_params)
     , _body(std::move(in_body))
+    , pure(false)
+    , dependencies()
+    , generator(false)
   {}
 
 private:
   Token _name;
   std::vector<Token> _params;
   std::vector<Stmt> _body;
+  mutable bool pure;
+  mutable std::vector<std::string> dependencies;
+  mutable bool generator;
 };
 
 class ReturnStatement : public Statement
@@ -263,7 +396,32 @@ public:
   }
 
   ReturnStatement(Expr&& val)
-    : val(std::move(val))
+    : Statement(true)
+    , val(std::move(val))
+  {}
+
+private:
+  Expr val;
+};
+
+class YieldStatement : public Statement
+{
+public:
+  Expression const& value() const { return *val; }
+
+  virtual void accept(StatementVisitor& visitor) const override
+  {
+    visitor.visitYieldStatement(*this);
+  }
+
+  virtual Stmt clone() const override
+  {
+    return std::make_unique<YieldStatement>(val->clone());
+  }
+
+  YieldStatement(Expr&& val)
+    : Statement(true)
+    , val(std::move(val))
   {}
 
 private:
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "NativeModule.hpp"
+#include "NativeObject.hpp"
+
+namespace Lox {
+
+/**
+ * Mutable text buffer for building strings piece by piece.
+ *
+ * `s = s + part` copies everything built so far, so assembling a string
+ * in a loop is quadratic. Appending to a builder is amortized constant,
+ * numbers are formatted straight into its buffer the way print shows them.
+ * */
+class StringBuilder : public NativeObject
+{
+public:
+  static constexpr char const* type_name = "a StringBuilder";
+
+  void append(std::string_view str);
+  void append(double num);
+  void append(std::int64_t num);
+
+  /**
+   * Appends obj as print would show it.
+   * */
+  void append(Object const& obj);
+
+  void reserve(std::size_t size);
+
+  std::size_t length() const noexcept { return buffer.size(); }
+
+  std::string const& str() const noexcept { return buffer; }
+
+  // heap memory of the buffer
+  std::size_t bytes() const noexcept { return buffer.capacity(); }
+
+  virtual std::string toString() const override;
+
+  virtual std::unique_ptr<NativeObject> clone() const override;
+  virtual void restore(NativeObject& saved) override;
+
+  StringBuilder() = default;
+
+private:
+  std::string buffer;
+};
+
+/**
+ * Adds StringBuilder() and the natives over builders to module.
+ * */
+void
+addStringBuilder(NativeModule& module);
+
+} // namespace Lox
\ No newline at end of file
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "NativeModule.hpp"
+#include "NativeObject.hpp"
+
+namespace Lox {
+
+struct TaskState;
+
+/**
+ * Handle of a spawned task, a Lox value joined with join(task).
+ * */
+class TaskHandle : public NativeObject
+{
+public:
+  static constexpr char const* type_name = "a task";
+
+  virtual std::string toString() const override { return "<task>"; }
+
+  virtual bool shareable() const noexcept override { return true; }
+
+  explicit TaskHandle(std::shared_ptr<TaskState> state)
+    : state(std::move(state))
+  {}
+
+private:
+  friend class TaskPool;
+
+  std::shared_ptr<TaskState> state;
+};
+
+/**
+ * Runs Lox functions on a fixed set of worker threads.
+ *
+ * Every worker has an interpreter of its own and a deque of tasks. A
+ * worker takes its newest task first and, when out of work, steals the
+ * oldest one of another worker. Joining on a worker runs other tasks
+ * until the awaited one is done, so recursive spawns can't starve the
+ * pool.
+ *
+ * Interpreters don't share values, functions and arguments are copied
+ * into the worker as Portable values. Tasks see a copy of the spawning
+ * interpreter's globals as they were at the spawn and no others, globals
+ * that can't be copied are undefined. The copy of globals holding
+ * immutable values is reused by spawns until a global is written, only
+ * native values like maps are copied at every spawn.
+ * */
+class TaskPool
+{
+public:
+  /**
+   * Calls fn with args on some worker, values that can't be
+   * copied are a LoxRuntimeError.
+   * */
+  std::shared_ptr<TaskHandle> spawn(Interpreter& from,
+                                    Object const& fn,
+                                    Arguments args);
+
+  /**
+   * Result of task copied into interpreter, an error of
+   * the task is rethrown as a LoxRuntimeError.
+   * */
+  Object join(Interpreter& interpreter, TaskHandle const& task);
+
+  std::size_t workers() const noexcept { return queues.size(); }
+
+  explicit TaskPool(std::size_t workers);
+  TaskPool(TaskPool const&) = delete;
+  TaskPool& operator=(TaskPool const&) = delete;
+  ~TaskPool();
+
+  /**
+   * The pool of the "task" module, started on first use.
+   * */
+  static TaskPool& shared();
+
+  /**
+   * Workers of the shared pool, only effective before it is started.
+   * Defaults to the number of hardware threads.
+   * */
+  static void setSharedWorkers(std::size_t workers) noexcept;
+
+private:
+  struct Queue
+  {
+    std::mutex mutex;
+    std::deque<std::shared_ptr<TaskState>> tasks;
+  };
+
+  void work(std::size_t index);
+  std::shared_ptr<TaskState> take(std::size_t index);
+  void run(Interpreter& interpreter, TaskState& task);
+  void push(std::shared_ptr<TaskState> task);
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::atomic<std::size_t> queued;
+  std::atomic<std::size_t> next_queue;
+  std::mutex mutex;
+  std::condition_variable changed;
+  bool stopping;
+  std::vector<std::jthread> threads;
+};
+
+/**
+ * The "task" module: spawn(fn, args...), join(task), workers()
+ * and the natives of Channel.
+ * */
+NativeModule
+taskModule();
+
+} // namespace Lox
\ No newline at end of file
@@ -50,6 +50,7 @@ enum class TokenType
   TRUE,
   VAR,
   WHILE,
+  YIELD,
   END_OF_FILE
 };
 
@@ -0,0 +1,69 @@
+#include <algorithm>
+
+#include <ArgumentStack.hpp>
+
+namespace Lox {
+
+ArgumentStack::Frame::Frame(ArgumentStack& stack,
+                            Object* slots,
+                            std::size_t count,
+                            std::size_t chunk,
+                            std::size_t top) noexcept
+  : stack(stack)
+  , slots(slots)
+  , count(count)
+  , chunk(chunk)
+  , top(top)
+{}
+
+ArgumentStack::Frame::~Frame()
+{
+  stack.pop(*this);
+}
+
+ArgumentStack::Frame
+ArgumentStack::push(std::size_t count)
+{
+  auto chunk = current;
+  auto old_top = top;
+
+  if (top + count > chunks[current].size) {
+    // continue in the next chunk that is large enough
+    ++current;
+    while (current < chunks.size() && chunks[current].size < count) {
+      ++current;
+    }
+    if (current == chunks.size()) {
+      auto size = std::max(chunk_size, count);
+      chunks.push_back(Chunk{ std::make_unique<Object[]>(size), size });
+    }
+    top = 0UL;
+  }
+
+  auto* slots = chunks[current].slots.get() + top;
+  top += count;
+  return Frame{ *this, slots, count, chunk, old_top };
+}
+
+ArgumentStack::ArgumentStack()
+  : chunks()
+  , current(0UL)
+  , top(0UL)
+{
+  chunks.push_back(
+    Chunk{ std::make_unique<Object[]>(chunk_size), chunk_size });
+}
+
+void
+ArgumentStack::pop(Frame const& frame) noexcept
+{
+  // don't keep strings and closures alive longer than the call
+  for (auto i = 0UL; i < frame.count; ++i) {
+    frame.slots[i] = Object{};
+  }
+
+  current = frame.chunk;
+  top = frame.top;
+}
+
+} // namespace Lox
\ No newline at end of file
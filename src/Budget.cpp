@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <limits>
+
+#include <Budget.hpp>
+#include <LoxRuntimeError.hpp>
+
+namespace Lox {
+
+void
+Budget::start()
+{
+  burned = 0UL;
+  batch = check_interval;
+  if (options.fuel > 0UL) {
+    // the tick after the last unit of fuel checks
+    batch = std::min(batch, options.fuel + 1UL);
+  }
+  countdown = batch;
+
+  deadline = std::chrono::steady_clock::now() + options.time;
+  allocated = 0UL;
+}
+
+Budget::Budget(BudgetOptions options)
+  : options(options)
+  , countdown(0UL)
+  , batch(0UL)
+  , burned(0UL)
+  , deadline()
+  , allocated(0UL)
+  , quota(options.heap_bytes > 0UL ? options.heap_bytes
+                                   : std::numeric_limits<std::size_t>::max())
+{
+  start();
+}
+
+void
+Budget::refill()
+{
+  burned += batch;
+
+  if (options.fuel > 0UL && burned > options.fuel) {
+    exhaust();
+    throw LoxRuntimeError{ "fuel", "Out of fuel." };
+  }
+  checkTime();
+
+  batch = check_interval;
+  if (options.fuel > 0UL) {
+    batch = std::min(batch, options.fuel + 1UL - burned);
+  }
+  countdown = batch;
+}
+
+void
+Budget::checkTime()
+{
+  if (options.time.count() > 0 &&
+      std::chrono::steady_clock::now() >= deadline) {
+    timeUp();
+  }
+}
+
+void
+Budget::overQuota() const
+{
+  throw LoxRuntimeError{ "heap", "Heap quota exceeded." };
+}
+
+void
+Budget::timeUp()
+{
+  exhaust();
+  throw LoxRuntimeError{ "time", "Deadline exceeded." };
+}
+
+void
+Budget::exhaust() noexcept
+{
+  batch = 1UL;
+  countdown = 1UL;
+}
+
+} // namespace Lox
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include <Callable.hpp>
+#include <Generator.hpp>
 
 namespace Lox {
 
@@ -11,28 +12,36 @@ NativeFunction::arity() const
 }
 
 Object
-NativeFunction::call(Interpreter&, std::vector<Object> const& args) const
+NativeFunction::call(Interpreter& interpreter, Arguments args) const
 {
-  if (fn)
-    return fn(args);
-  else
+  if (!fn && !bound) {
     return Object::null();
+  }
+
+  auto result = bound ? bound(interpreter, _name, args) : fn(interpreter, args);
+  if (result.isString()) {
+    interpreter.budget().allocate(result.string().size());
+  }
+  return result;
 }
 
 std::string
 NativeFunction::toString() const
 {
-  return "<raw callable>";
+  return "<native " + _name + ">";
 }
 
-std::unique_ptr<Callable>
-NativeFunction::clone() const
-{
-  return std::make_unique<NativeFunction>(fn, _arity);
-}
+NativeFunction::NativeFunction(std::string name, NativeFn fn, size_t in_arity)
+  : _name(std::move(name))
+  , fn(fn)
+  , bound(nullptr)
+  , _arity(in_arity)
+{}
 
-NativeFunction::NativeFunction(CallableFn fn, size_t in_arity)
-  : fn(fn)
+NativeFunction::NativeFunction(std::string name, Bound bound, size_t in_arity)
+  : _name(std::move(name))
+  , fn(nullptr)
+  , bound(bound)
   , _arity(in_arity)
 {}
 
@@ -47,21 +56,10 @@ LoxFunction::arity() const
 }
 
 Object
-LoxFunction::call(Interpreter& interpreter,
-                  std::vector<Object> const& args) const
+LoxFunction::call(Interpreter& interpreter, Arguments args) const
 {
-  auto env = std::make_shared<Environment>(closure);
-  for (auto i = 0; i < declaration->params().size(); ++i) {
-    env->define(declaration->params().at(i).lexeme(), args.at(i));
-  }
-
-  try {
-    interpreter.executeBlock(declaration->body(), env);
-  } catch (ReturnValue& v) {
-    return v.value();
-  }
-
-  return Object::null();
+  // whoever calls this keeps the function alive
+  return interpreter.callFunction(*this, args, Object::null());
 }
 
 std::string
@@ -70,29 +68,77 @@ LoxFunction::toString() const
   return "<fn " + declaration->name().lexeme() + ">";
 }
 
-std::unique_ptr<Callable>
-LoxFunction::clone() const
-{
-  return std::make_unique<LoxFunction>(
-    std::unique_ptr<FunctionDeclarationStatement>{
-      dynamic_cast<FunctionDeclarationStatement*>(
-        declaration->clone().release()),
-    },
-    closure);
-}
-
 LoxFunction::LoxFunction(
-  std::unique_ptr<FunctionDeclarationStatement>&& declaration)
+  std::shared_ptr<FunctionDeclarationStatement const> declaration)
   : declaration(std::move(declaration))
+  , owner(this->declaration)
 {}
 
 LoxFunction::LoxFunction(
-  std::unique_ptr<FunctionDeclarationStatement>&& declaration,
+  std::shared_ptr<FunctionDeclarationStatement const> declaration,
   SharedEnv closure)
   : declaration(std::move(declaration))
+  , owner(this->declaration)
   , closure(closure)
 {}
 
+std::optional<Object>
+LoxFunction::shortcut(Interpreter& interpreter,
+                      Arguments args,
+                      std::optional<std::string>& key) const
+{
+  if (declaration->isGenerator()) {
+    return Object{ std::shared_ptr<NativeObject>{
+      std::make_shared<Generator>(declaration, owner, bind(interpreter, args)) } };
+  }
+
+  auto* memo = declaration->isPure() ? interpreter.memoizer() : nullptr;
+  if (auto k = std::string{}; memo && Memoizer::makeKey(args, k)) {
+    if (auto const* hit = memo->lookup(declaration, k)) {
+      return *hit;
+    }
+    key = std::move(k);
+  }
+
+  // native code can't be stopped by the budget
+  if (auto* jit = interpreter.jit(); jit && !interpreter.budget().metered()) {
+    if (auto res = jit->call(interpreter, *this, args)) {
+      if (key) {
+        memoize(interpreter, std::move(*key), *res);
+      }
+      return res;
+    }
+  }
+
+  return std::nullopt;
+}
+
+SharedEnv
+LoxFunction::bind(Interpreter& interpreter, Arguments args) const
+{
+  auto env = interpreter.makeEnvironment(closure);
+  for (auto i = 0UL; i < declaration->params().size(); ++i) {
+    env->define(declaration->params()[i].lexeme(), args[i]);
+  }
+  return env;
+}
+
+void
+LoxFunction::memoize(Interpreter& interpreter,
+                     std::string key,
+                     Object const& result) const
+{
+  if (auto* memo = interpreter.memoizer()) {
+    memo->store(declaration, std::move(key), result);
+  }
+}
+
+Object
+LoxFunction::interpret(Interpreter& interpreter, Arguments args) const
+{
+  return interpreter.interpretBody(*this, args);
+}
+
 #pragma endregion // lox_function
 
 } // namespace Lox
\ No newline at end of file
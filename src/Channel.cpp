@@ -0,0 +1,269 @@
+#include <bit>
+#include <climits>
+#include <ctime>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <Channel.hpp>
+#include <LoxRuntimeError.hpp>
+
+namespace Lox {
+
+bool
+Channel::trySend(Portable& value)
+{
+  auto pos = send_pos.load(std::memory_order_relaxed);
+  while (true) {
+    auto& cell = cells[pos & mask];
+    auto seq = cell.sequence.load(std::memory_order_acquire);
+    auto diff = static_cast<std::intptr_t>(seq - pos);
+    if (diff == 0) {
+      // sequentially consistent with close(), see receive()
+      if (send_pos.compare_exchange_weak(pos, pos + 1UL)) {
+        break;
+      }
+    } else if (diff < 0) {
+      // the cell still holds the value of the previous round
+      return false;
+    } else {
+      pos = send_pos.load(std::memory_order_relaxed);
+    }
+  }
+
+  // claimed after the close, receivers skip the cell
+  auto& cell = cells[pos & mask];
+  auto dropped = is_closed.load();
+  cell.dropped = dropped;
+  if (!dropped) {
+    cell.value = std::move(value);
+  }
+  cell.sequence.store(pos + 1UL, std::memory_order_release);
+
+  bump(sent);
+  return !dropped;
+}
+
+void
+Channel::send(Portable value, Budget* budget)
+{
+  while (true) {
+    if (is_closed) {
+      throw LoxRuntimeError{ "channelSend", "Channel is closed." };
+    }
+    // read before trying, so a receive in between ends the wait
+    auto seen = received.load();
+    if (trySend(value)) {
+      return;
+    }
+    wait(received, seen, budget);
+  }
+}
+
+std::optional<Portable>
+Channel::tryReceive()
+{
+  auto pos = receive_pos.load(std::memory_order_relaxed);
+  auto res = Portable{};
+  while (true) {
+    auto& cell = cells[pos & mask];
+    auto seq = cell.sequence.load(std::memory_order_acquire);
+    auto diff = static_cast<std::intptr_t>(seq - (pos + 1UL));
+    if (diff == 0) {
+      if (receive_pos.compare_exchange_weak(
+            pos, pos + 1UL, std::memory_order_relaxed)) {
+        auto dropped = cell.dropped;
+        res = std::move(cell.value);
+        cell.value = Portable{};
+        cell.sequence.store(pos + mask + 1UL, std::memory_order_release);
+        if (!dropped) {
+          break;
+        }
+        ++pos;
+      }
+    } else if (diff < 0) {
+      return std::nullopt;
+    } else {
+      pos = receive_pos.load(std::memory_order_relaxed);
+    }
+  }
+
+  bump(received);
+  return res;
+}
+
+std::optional<Portable>
+Channel::receive(Budget* budget)
+{
+  while (true) {
+    auto seen = sent.load();
+    if (auto res = tryReceive()) {
+      return res;
+    }
+    /**
+     * A send that claimed its cell before the close may not have
+     * filled it yet. Every claimed cell gets filled or dropped, so
+     * the channel is drained once all claimed ones are received.
+     * */
+    if (is_closed.load() && receive_pos.load() == send_pos.load()) {
+      return std::nullopt;
+    }
+    wait(sent, seen, budget);
+  }
+}
+
+void
+Channel::close() noexcept
+{
+  is_closed = true;
+  bump(sent);
+  bump(received);
+}
+
+void
+Channel::wait(std::atomic<std::uint32_t>& counter,
+              std::uint32_t seen,
+              Budget* budget)
+{
+  auto timeout = timespec{};
+  auto* until = static_cast<timespec*>(nullptr);
+  if (auto limit = budget ? budget->waitLimit() : std::nullopt) {
+    auto left = *limit - std::chrono::steady_clock::now();
+    if (left <= left.zero()) {
+      budget->checkTime();
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(left);
+    timeout.tv_sec = static_cast<std::time_t>(ns.count() / 1'000'000'000);
+    timeout.tv_nsec = static_cast<long>(ns.count() % 1'000'000'000);
+    until = &timeout;
+  }
+
+  // counted before the kernel compares the counter with seen, so
+  // either a bump sees the waiter or the kernel sees the bump
+  waiting.fetch_add(1U);
+  syscall(SYS_futex,
+          reinterpret_cast<std::uint32_t*>(&counter),
+          FUTEX_WAIT_PRIVATE,
+          seen,
+          until,
+          nullptr,
+          0);
+  waiting.fetch_sub(1U);
+
+  if (budget) {
+    budget->checkTime();
+  }
+}
+
+void
+Channel::bump(std::atomic<std::uint32_t>& counter) noexcept
+{
+  counter.fetch_add(1U);
+  if (waiting.load() > 0U) {
+    syscall(SYS_futex,
+            reinterpret_cast<std::uint32_t*>(&counter),
+            FUTEX_WAKE_PRIVATE,
+            INT_MAX,
+            nullptr,
+            nullptr,
+            0);
+  }
+}
+
+std::string
+Channel::toString() const
+{
+  return "<channel " + std::to_string(capacity()) + ">";
+}
+
+Channel::Channel(std::size_t capacity)
+  : cells()
+  , mask(std::bit_ceil(std::max(capacity, 2UL)) - 1UL)
+  , is_closed(false)
+  , send_pos(0UL)
+  , receive_pos(0UL)
+  , sent(0U)
+  , received(0U)
+  , waiting(0U)
+{
+  cells = std::make_unique<Cell[]>(mask + 1UL);
+  for (auto i = 0UL; i <= mask; ++i) {
+    cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+namespace {
+
+#pragma region natives
+
+// all cells are allocated up front, this many take some 48 MB
+constexpr auto max_capacity = 1UL << 20;
+
+std::shared_ptr<Channel>
+newChannel(double capacity)
+{
+  // written so that NaN fails as well
+  if (!(capacity >= 1.0 && capacity <= static_cast<double>(max_capacity))) {
+    throw LoxRuntimeError{ "Channel",
+                           "Capacity must be between 1 and " +
+                             std::to_string(max_capacity) + "." };
+  }
+  return std::make_shared<Channel>(static_cast<std::size_t>(capacity));
+}
+
+Channel&
+channelArgument(Arguments args, std::string const& name)
+{
+  auto* channel = args[0].native<Channel>();
+  if (!channel) {
+    throw LoxRuntimeError{ name, "Argument 1 must be a Channel." };
+  }
+  return *channel;
+}
+
+Object
+channelSend(Interpreter& interpreter, Arguments args)
+{
+  auto& channel = channelArgument(args, "channelSend");
+  channel.send(Portable::from(interpreter, args[1], "Argument 2"),
+               &interpreter.budget());
+  return Object::null();
+}
+
+Object
+channelReceive(Interpreter& interpreter, Arguments args)
+{
+  auto res =
+    channelArgument(args, "channelReceive").receive(&interpreter.budget());
+  return res ? std::move(*res).toObject(interpreter) : Object::null();
+}
+
+Object
+channelTryReceive(Interpreter& interpreter, Arguments args)
+{
+  auto res = channelArgument(args, "channelTryReceive").tryReceive();
+  return res ? std::move(*res).toObject(interpreter) : Object::null();
+}
+
+void
+channelClose(Channel& channel)
+{
+  channel.close();
+}
+
+#pragma endregion
+
+} // namespace
+
+void
+addChannel(NativeModule& module)
+{
+  module.function<&newChannel>("Channel")
+    .function("channelSend", &channelSend, 2UL)
+    .function("channelReceive", &channelReceive, 1UL)
+    .function("channelTryReceive", &channelTryReceive, 1UL)
+    .function<&channelClose>("channelClose");
+}
+
+} // namespace Lox
\ No newline at end of file
@@ -1,61 +1,351 @@
+#include <new>
+
+#include <Callable.hpp>
 #include <Environment.hpp>
+#include <NativeObject.hpp>
 
 namespace Lox {
 
 void
 Environment::define(std::string name, Object value)
 {
-  if (!values.contains(name)) {
-    values.emplace(name, value);
-  } else {
-    values.at(name) = value;
+  ++_generation;
+  if (table && journal) {
+    auto [it, added] = table->try_emplace(name);
+    if (added) {
+      journal->cells.try_emplace(&it->second, Saved{ std::move(name), {} });
+    } else {
+      preserve(&it->second);
+    }
+    it->second = std::move(value);
+    return;
+  }
+
+  if (table) {
+    (*table)[std::move(name)] = std::move(value);
+    return;
+  }
+
+  for (auto i = 0UL; i < count; ++i) {
+    if (slot(i)->name == name) {
+      slot(i)->value = std::move(value);
+      return;
+    }
   }
+
+  if (count == inline_slots) {
+    // outgrown the slots, everything moves to the table
+    useTable();
+    table->emplace(std::move(name), std::move(value));
+    return;
+  }
+
+  new (slot(count)) Slot{ std::move(name), std::move(value) };
+  ++count;
 }
 
 void
-Environment::assign(Token name, Object value)
+Environment::assign(Token const& name, Object value)
+{
+  for (auto* env = this; env; env = env->parent.get()) {
+    if (auto* var = env->cell(name.lexeme())) {
+      if (env->journal) {
+        env->preserve(var);
+      }
+      ++env->_generation;
+      *var = std::move(value);
+      return;
+    }
+  }
+  throw LoxRuntimeError{ name, "Undefined variable '" + name.lexeme() + "'" };
+}
+
+Object const&
+Environment::get(Token const& name) const
 {
-  if (!values.contains(name.lexeme())) {
-    if (parent) {
-      parent->assign(name, value);
+  for (auto const* env = this; env; env = env->parent.get()) {
+    if (auto const* var = env->find(name.lexeme())) {
+      return *var;
+    }
+  }
+  throw LoxRuntimeError{ name.lexeme(), "Undefined variable " + name.lexeme() };
+}
+
+Object*
+Environment::cell(std::string const& name)
+{
+  return const_cast<Object*>(find(name));
+}
+
+void
+Environment::clear() noexcept
+{
+  for (auto i = 0UL; i < count; ++i) {
+    slot(i)->~Slot();
+  }
+  count = 0UL;
+  ++_generation;
+
+  untrack();
+  journal.reset();
+  if (table) {
+    table->clear();
+  }
+}
+
+void
+Environment::snapshot()
+{
+  untrack();
+  if (!journal) {
+    journal = std::make_unique<Journal>();
+  }
+  journal->cells.clear();
+  for (auto const& [name, value] : *table) {
+    track(value);
+  }
+}
+
+bool
+Environment::restore()
+{
+  if (!journal) {
+    return false;
+  }
+
+  ++_generation;
+  for (auto& [cell, saved] : journal->cells) {
+    if (saved.value) {
+      *cell = std::move(*saved.value);
     } else {
-      throw LoxRuntimeError{ name,
-                             "Undefined variable '" + name.lexeme() + "'" };
+      table->erase(saved.name);
+    }
+  }
+  journal->cells.clear();
+  for (auto const& native : journal->natives) {
+    native->rollback();
+  }
+  for (auto const& closure : journal->closures) {
+    closure->restore();
+  }
+  return true;
+}
+
+void
+Environment::preserve(Object* cell)
+{
+  // a cell saved before keeps its older value
+  if (journal && !journal->cells.contains(cell)) {
+    journal->cells.emplace(cell, Saved{ {}, *cell });
+  }
+}
+
+void
+Environment::track(Object const& value)
+{
+  if (value.isNative()) {
+    track(value.sharedNative());
+  } else if (value.isCallable()) {
+    if (auto const* fn = dynamic_cast<LoxFunction const*>(&value.callable())) {
+      track(fn->closureEnvironment());
     }
-  } else {
-    values.at(name.lexeme()) = value;
   }
 }
 
-Object
-Environment::get(Token name) const
+void
+Environment::track(std::shared_ptr<NativeObject> const& native)
 {
-  return get(name.lexeme());
+  // shared ones are used by other threads, tracked ones were seen
+  if (native->shareable() || native->isTracked()) {
+    return;
+  }
+  native->track(true);
+  journal->natives.push_back(native);
+  native->forEachNative(
+    [this](std::shared_ptr<NativeObject> const& held) { track(held); });
+}
+
+void
+Environment::untrack() noexcept
+{
+  if (!journal) {
+    return;
+  }
+  for (auto const& native : journal->natives) {
+    native->track(false);
+  }
+  journal->natives.clear();
+  for (auto const& closure : journal->closures) {
+    closure->journal.reset();
+  }
+  journal->closures.clear();
+}
+
+void
+Environment::track(SharedEnv const& closure)
+{
+  // up to the root, an environment with a journal was seen
+  for (auto env = closure; env && !env->journal; env = env->parent) {
+    env->useTable();
+    env->journal = std::make_unique<Journal>();
+    journal->closures.push_back(env);
+    for (auto const& [name, value] : *env->table) {
+      track(value);
+    }
+  }
+}
+
+void
+Environment::useTable()
+{
+  if (table) {
+    return;
+  }
+  table = std::make_unique<std::unordered_map<std::string, Object>>();
+  for (auto i = 0UL; i < count; ++i) {
+    table->emplace(std::move(slot(i)->name), std::move(slot(i)->value));
+    slot(i)->~Slot();
+  }
+  count = 0UL;
 }
 
 Environment::Environment()
   : parent(nullptr)
-  , values()
+  , count(0UL)
+  , table(std::make_unique<std::unordered_map<std::string, Object>>())
+  , _generation(0UL)
 {}
 Environment::Environment(SharedEnv parent)
   : parent(parent)
-  , values()
-{}
-Environment::Environment(SharedEnv parent, std::map<std::string, Object> values)
-  : parent(parent)
-  , values(values)
+  , count(0UL)
+  , table(nullptr)
+  , _generation(0UL)
 {}
 
-Object
-Environment::get(std::string name) const
+Environment::~Environment()
+{
+  clear();
+}
+
+Object const*
+Environment::find(std::string const& name) const
+{
+  if (table) {
+    auto it = table->find(name);
+    return it != table->end() ? &it->second : nullptr;
+  }
+
+  for (auto i = 0UL; i < count; ++i) {
+    if (slot(i)->name == name) {
+      return &slot(i)->value;
+    }
+  }
+  return nullptr;
+}
+
+Environment::Slot*
+Environment::slot(std::size_t i) noexcept
+{
+  return std::launder(reinterpret_cast<Slot*>(slots) + i);
+}
+
+Environment::Slot const*
+Environment::slot(std::size_t i) const noexcept
+{
+  return std::launder(reinterpret_cast<Slot const*>(slots) + i);
+}
+
+#pragma region EnvironmentPool
+
+/**
+ * Hands the pool's blocks to std::allocate_shared. Holds on to the pool,
+ * so it lives as long as any environment allocated from it.
+ * */
+template<typename T>
+class PoolAllocator
+{
+public:
+  using value_type = T;
+
+  T* allocate(std::size_t n)
+  {
+    return static_cast<T*>(pool->allocate(n * sizeof(T)));
+  }
+
+  void deallocate(T* block, std::size_t n) noexcept
+  {
+    pool->deallocate(block, n * sizeof(T));
+  }
+
+  template<typename U>
+  bool operator==(PoolAllocator<U> const& other) const noexcept
+  {
+    return pool == other.pool;
+  }
+
+  explicit PoolAllocator(std::shared_ptr<EnvironmentPool> pool)
+    : pool(std::move(pool))
+  {}
+  template<typename U>
+  PoolAllocator(PoolAllocator<U> const& other)
+    : pool(other.pool)
+  {}
+
+private:
+  template<typename U>
+  friend class PoolAllocator;
+
+  std::shared_ptr<EnvironmentPool> pool;
+};
+
+SharedEnv
+EnvironmentPool::make(SharedEnv parent)
+{
+  return std::allocate_shared<Environment>(
+    PoolAllocator<Environment>{ shared_from_this() }, std::move(parent));
+}
+
+EnvironmentPool::~EnvironmentPool()
 {
-  if (values.contains(name)) {
-    return values.at(name);
-  } else if (parent) {
-    return parent->get(name);
-  } else {
-    throw LoxRuntimeError{ name, "Undefined variable " + name };
+  for (auto* block : free) {
+    ::operator delete(block);
   }
 }
 
+void*
+EnvironmentPool::allocate(std::size_t bytes)
+{
+  if (bytes == block_size && !free.empty()) {
+    auto* block = free.back();
+    free.pop_back();
+    ++recycled;
+    return block;
+  }
+
+  ++fresh;
+  return ::operator new(bytes);
+}
+
+void
+EnvironmentPool::deallocate(void* block, std::size_t bytes) noexcept
+{
+  // only one block size is ever pooled, allocate_shared asks for the same
+  if (block_size == 0UL) {
+    block_size = bytes;
+  }
+
+  if (bytes != block_size || free.size() >= max_free) {
+    ::operator delete(block);
+    return;
+  }
+
+  try {
+    free.push_back(block);
+  } catch (std::bad_alloc&) {
+    ::operator delete(block);
+  }
+}
+
+#pragma endregion
+
 } // namespace Lox
\ No newline at end of file
@@ -0,0 +1,527 @@
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <system_error>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <Callable.hpp>
+#include <EventLoop.hpp>
+#include <Interpreter.hpp>
+#include <NativeModule.hpp>
+
+namespace Lox {
+
+namespace {
+
+std::string
+errorText(std::string const& path)
+{
+  // unlike strerror safe on the I/O threads
+  return path + ": " + std::generic_category().message(errno);
+}
+
+bool
+readAll(int fd, std::string& out)
+{
+  auto buf = std::array<char, 64UL * 1024UL>{};
+  while (true) {
+    auto n = read(fd, buf.data(), buf.size());
+    if (n > 0) {
+      out.append(buf.data(), static_cast<std::size_t>(n));
+    } else if (n == 0) {
+      return true;
+    } else if (errno != EINTR) {
+      return false;
+    }
+  }
+}
+
+/**
+ * write() failing with EPIPE when the reader went away, without
+ * changing how the process handles SIGPIPE. The signal is blocked
+ * on this thread for the write and taken back if it raised one.
+ * */
+ssize_t
+writeQuietly(int fd, char const* data, std::size_t size)
+{
+  auto pipe = sigset_t{};
+  auto old = sigset_t{};
+  sigemptyset(&pipe);
+  sigaddset(&pipe, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &pipe, &old);
+
+  auto n = write(fd, data, size);
+  auto error = errno;
+  if (n < 0 && error == EPIPE && !sigismember(&old, SIGPIPE)) {
+    auto now = timespec{};
+    sigtimedwait(&pipe, nullptr, &now);
+  }
+
+  pthread_sigmask(SIG_SETMASK, &old, nullptr);
+  errno = error;
+  return n;
+}
+
+bool
+writeAll(int fd, std::string const& data)
+{
+  auto written = 0UL;
+  while (written < data.size()) {
+    auto n = writeQuietly(fd, data.data() + written, data.size() - written);
+    if (n >= 0) {
+      written += static_cast<std::size_t>(n);
+    } else if (errno != EINTR) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+std::size_t
+EventLoop::setTimer(Object fn, std::chrono::milliseconds delay)
+{
+  auto id = add(std::move(fn));
+  live_timers.insert(id);
+  timers.push_back(Timer{ Clock::now() + delay, id });
+  std::push_heap(timers.begin(), timers.end(), std::greater<>{});
+  return id;
+}
+
+bool
+EventLoop::cancelTimer(std::size_t id)
+{
+  if (live_timers.erase(id) == 0UL) {
+    return false;
+  }
+  // due or not, a timer without its callback doesn't run
+  callbacks.erase(id);
+
+  // heap entries of cancelled timers stay until they reach the top,
+  // or until they make up half of the heap
+  if (timers.size() > 2UL * live_timers.size()) {
+    std::erase_if(timers,
+                  [&](auto& timer) { return !live_timers.contains(timer.id); });
+    std::make_heap(timers.begin(), timers.end(), std::greater<>{});
+  }
+  dropCancelled();
+  return true;
+}
+
+void
+EventLoop::readFile(std::string const& path, Object fn)
+{
+  auto id = add(std::move(fn));
+  auto fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0) {
+    complete(Completion{ id, false, std::nullopt, errorText(path) });
+    return;
+  }
+  transfer(fd, Watch{ id, false, path, {}, 0UL });
+}
+
+void
+EventLoop::writeFile(std::string const& path, std::string data, Object fn)
+{
+  auto id = add(std::move(fn));
+  auto fd =
+    open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NONBLOCK | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    complete(Completion{ id, true, std::nullopt, errorText(path) });
+    return;
+  }
+  transfer(fd, Watch{ id, true, path, std::move(data), 0UL });
+}
+
+void
+EventLoop::run(Interpreter& interpreter)
+{
+  auto events = std::array<epoll_event, 64UL>{};
+  auto& budget = interpreter.budget();
+
+  while (pending()) {
+    auto count = epoll_wait(epoll_fd,
+                            events.data(),
+                            static_cast<int>(events.size()),
+                            timeout(budget.waitLimit()));
+    if (count < 0 && errno != EINTR) {
+      throw LoxRuntimeError{ "event loop", errorText("epoll_wait") };
+    }
+    budget.checkTime();
+
+    for (auto i = 0; i < count; ++i) {
+      if (events[i].data.fd == wake_fd) {
+        auto wakeups = std::uint64_t{};
+        (void)!read(wake_fd, &wakeups, sizeof(wakeups));
+        collectCompletions();
+      } else {
+        collectWatch(events[i].data.fd);
+      }
+    }
+    collectTimers();
+
+    while (!due.empty()) {
+      auto [id, args] = std::move(due.front());
+      due.pop_front();
+      live_timers.erase(id);
+      // a callback run before may have cancelled it
+      auto callback = callbacks.extract(id);
+      if (callback) {
+        // callbacks don't run past the deadline, even ones due before it
+        budget.checkTime();
+        interpreter.call(callback.mapped(), args);
+      }
+    }
+  }
+}
+
+EventLoop::EventLoop()
+  : epoll_fd(epoll_create1(EPOLL_CLOEXEC))
+  , wake_fd(eventfd(0U, EFD_NONBLOCK | EFD_CLOEXEC))
+  , next_id(1UL)
+  , callbacks()
+  , timers()
+  , live_timers()
+  , watches()
+  , due()
+  , mutex()
+  , ready()
+  , jobs()
+  , completions()
+  , threads()
+{
+  if (epoll_fd < 0 || wake_fd < 0) {
+    throw std::system_error{ errno, std::generic_category(), "event loop" };
+  }
+
+  auto event = epoll_event{};
+  event.events = EPOLLIN;
+  event.data.fd = wake_fd;
+  epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &event);
+}
+
+EventLoop::~EventLoop()
+{
+  // before closing the eventfd the I/O threads report to
+  threads.clear();
+
+  for (auto const& [fd, io] : watches) {
+    close(fd);
+  }
+  close(wake_fd);
+  close(epoll_fd);
+}
+
+std::size_t
+EventLoop::add(Object fn)
+{
+  auto id = next_id++;
+  callbacks.emplace(id, std::move(fn));
+  return id;
+}
+
+void
+EventLoop::transfer(int fd, Watch io)
+{
+  struct stat info{};
+  fstat(fd, &info);
+
+  auto event = epoll_event{};
+  event.events = io.writing ? EPOLLOUT : EPOLLIN;
+  event.data.fd = fd;
+
+  if (!S_ISREG(info.st_mode) &&
+      epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0) {
+    watches.emplace(fd, std::move(io));
+    return;
+  }
+
+  // regular files and others epoll refuses, e.g. /dev/null
+  submit([fd, io = std::move(io)]() mutable {
+    auto done = Completion{ io.id, io.writing, std::nullopt, std::nullopt };
+    auto flags = fcntl(fd, F_GETFL);
+    fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+
+    if (io.writing) {
+      if (!writeAll(fd, io.data)) {
+        done.error = errorText(io.path);
+      }
+    } else {
+      auto data = std::string{};
+      if (readAll(fd, data)) {
+        done.data = std::move(data);
+      } else {
+        done.error = errorText(io.path);
+      }
+    }
+
+    close(fd);
+    return done;
+  });
+}
+
+void
+EventLoop::submit(std::function<Completion()> job)
+{
+  {
+    auto lock = std::lock_guard{ mutex };
+    jobs.push_back(std::move(job));
+  }
+  ready.notify_one();
+
+  // started on first use, most scripts never touch a file
+  while (threads.size() < io_threads) {
+    threads.emplace_back([this](std::stop_token stop) { work(stop); });
+  }
+}
+
+void
+EventLoop::complete(Completion done)
+{
+  {
+    auto lock = std::lock_guard{ mutex };
+    completions.push_back(std::move(done));
+  }
+  auto one = std::uint64_t{ 1U };
+  (void)!write(wake_fd, &one, sizeof(one));
+}
+
+void
+EventLoop::work(std::stop_token stop)
+{
+  while (true) {
+    auto job = std::function<Completion()>{};
+    {
+      auto lock = std::unique_lock{ mutex };
+      if (!ready.wait(lock, stop, [&]() { return !jobs.empty(); })) {
+        return;
+      }
+      job = std::move(jobs.front());
+      jobs.pop_front();
+    }
+    complete(job());
+  }
+}
+
+void
+EventLoop::collectTimers()
+{
+  auto now = Clock::now();
+  while (!timers.empty() && timers.front().deadline <= now) {
+    std::pop_heap(timers.begin(), timers.end(), std::greater<>{});
+    due.emplace_back(timers.back().id, std::vector<Object>{});
+    timers.pop_back();
+    dropCancelled();
+  }
+}
+
+void
+EventLoop::dropCancelled()
+{
+  while (!timers.empty() && !live_timers.contains(timers.front().id)) {
+    std::pop_heap(timers.begin(), timers.end(), std::greater<>{});
+    timers.pop_back();
+  }
+}
+
+void
+EventLoop::collectWatch(int fd)
+{
+  auto& io = watches.at(fd);
+  auto finished = false;
+  auto error = std::optional<std::string>{};
+
+  if (io.writing) {
+    while (io.written < io.data.size()) {
+      auto n = writeQuietly(
+        fd, io.data.data() + io.written, io.data.size() - io.written);
+      if (n >= 0) {
+        io.written += static_cast<std::size_t>(n);
+      } else if (errno == EAGAIN) {
+        break;
+      } else if (errno != EINTR) {
+        error = errorText(io.path);
+        break;
+      }
+    }
+    finished = error || io.written == io.data.size();
+  } else {
+    auto buf = std::array<char, 64UL * 1024UL>{};
+    while (true) {
+      auto n = read(fd, buf.data(), buf.size());
+      if (n > 0) {
+        io.data.append(buf.data(), static_cast<std::size_t>(n));
+      } else if (n == 0) {
+        finished = true;
+        break;
+      } else if (errno == EAGAIN) {
+        break;
+      } else if (errno != EINTR) {
+        error = errorText(io.path);
+        finished = true;
+        break;
+      }
+    }
+  }
+
+  if (!finished) {
+    return;
+  }
+
+  epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+  close(fd);
+  auto data = error || io.writing ? std::nullopt
+                                  : std::optional{ std::move(io.data) };
+  schedule(io.id, io.writing, std::move(data), std::move(error));
+  watches.erase(fd);
+}
+
+void
+EventLoop::collectCompletions()
+{
+  auto done = std::vector<Completion>{};
+  {
+    auto lock = std::lock_guard{ mutex };
+    done.swap(completions);
+  }
+  for (auto& completion : done) {
+    schedule(completion.id,
+             completion.writing,
+             std::move(completion.data),
+             std::move(completion.error));
+  }
+}
+
+void
+EventLoop::schedule(std::size_t id,
+                    bool writing,
+                    std::optional<std::string> data,
+                    std::optional<std::string> error)
+{
+  auto value = [](std::optional<std::string>& str) {
+    return str ? Object{ std::move(*str) } : Object::null();
+  };
+
+  auto args = std::vector<Object>{};
+  if (!writing) {
+    args.push_back(value(data));
+  }
+  args.push_back(value(error));
+  due.emplace_back(id, std::move(args));
+}
+
+int
+EventLoop::timeout(std::optional<Clock::time_point> limit) const
+{
+  if (!due.empty()) {
+    return 0;
+  }
+  if (!timers.empty()) {
+    limit = limit ? std::min(*limit, timers.front().deadline)
+                  : timers.front().deadline;
+  }
+  if (!limit) {
+    return -1;
+  }
+
+  auto left = *limit - Clock::now();
+  auto ms = std::chrono::ceil<std::chrono::milliseconds>(left).count();
+  // a limit days away still has to fit epoll_wait's int
+  return static_cast<int>(std::clamp(ms, 0L, static_cast<long>(INT_MAX)));
+}
+
+namespace {
+
+#pragma region natives
+
+Object const&
+callback(Arguments args, std::size_t index, std::size_t arity)
+{
+  auto const& fn = args[index];
+  if (!fn.isCallable() || fn.callable().arity() != arity) {
+    throw LoxRuntimeError{ Interpreter::stringify(fn),
+                           "Argument " + std::to_string(index + 1UL) +
+                             " must be a function taking " +
+                             std::to_string(arity) + " arguments." };
+  }
+  return fn;
+}
+
+std::string const&
+string(Arguments args, std::size_t index, std::string const& name)
+{
+  if (!args[index].isString()) {
+    throw LoxRuntimeError{ name,
+                           "Argument " + std::to_string(index + 1UL) +
+                             " must be a string." };
+  }
+  return args[index].string();
+}
+
+Object
+setTimeout(Interpreter& interpreter, Arguments args)
+{
+  auto const& fn = callback(args, 0UL, 0UL);
+  if (!args[1].isNumber() || !(args[1].number() >= 0.0)) {
+    throw LoxRuntimeError{ "setTimeout",
+                           "Argument 2 must be a number of milliseconds." };
+  }
+  auto delay = std::chrono::milliseconds{
+    static_cast<std::int64_t>(std::min(args[1].number(), 1e12))
+  };
+  auto id = interpreter.eventLoop().setTimer(fn, delay);
+  return Object{ static_cast<double>(id) };
+}
+
+Object
+clearTimeout(Interpreter& interpreter, Arguments args)
+{
+  if (!args[0].isNumber()) {
+    throw LoxRuntimeError{ "clearTimeout", "Argument 1 must be a timer." };
+  }
+  auto id = static_cast<std::size_t>(args[0].number());
+  return Object{ interpreter.eventLoop().cancelTimer(id) };
+}
+
+Object
+readFile(Interpreter& interpreter, Arguments args)
+{
+  auto const& path = string(args, 0UL, "readFile");
+  interpreter.eventLoop().readFile(path, callback(args, 1UL, 2UL));
+  return Object::null();
+}
+
+Object
+writeFile(Interpreter& interpreter, Arguments args)
+{
+  auto const& path = string(args, 0UL, "writeFile");
+  auto const& data = string(args, 1UL, "writeFile");
+  interpreter.eventLoop().writeFile(path, data, callback(args, 2UL, 1UL));
+  return Object::null();
+}
+
+#pragma endregion
+
+} // namespace
+
+NativeModule
+eventModule()
+{
+  auto module = NativeModule{ "event" };
+  module.function("setTimeout", &setTimeout, 2UL)
+    .function("clearTimeout", &clearTimeout, 1UL)
+    .function("readFile", &readFile, 2UL)
+    .function("writeFile", &writeFile, 3UL);
+  return module;
+}
+
+} // namespace Lox
\ No newline at end of file
@@ -0,0 +1,303 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csetjmp>
+#include <csignal>
+#include <cstring>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <File.hpp>
+#include <LoxRuntimeError.hpp>
+
+namespace Lox {
+
+namespace {
+
+LoxRuntimeError
+systemError(std::string const& path)
+{
+  return LoxRuntimeError{ path,
+                         path + ": " + std::generic_category().message(errno) };
+}
+
+// where a SIGBUS during a guarded read of this thread jumps to
+thread_local sigjmp_buf* reading = nullptr;
+
+// what handled SIGBUS before, faults outside of guarded reads go there
+struct sigaction previous = {};
+
+void
+onBusError(int number, siginfo_t* info, void* context)
+{
+  // faults raised by the kernel, not a SIGBUS sent by kill()
+  auto fault = info->si_code > 0;
+  if (reading && fault) {
+    siglongjmp(*reading, 1);
+  }
+
+  if (previous.sa_flags & SA_SIGINFO) {
+    previous.sa_sigaction(number, info, context);
+  } else if (previous.sa_handler != SIG_DFL &&
+             previous.sa_handler != SIG_IGN) {
+    previous.sa_handler(number);
+  } else if (fault || previous.sa_handler == SIG_DFL) {
+    // the fault repeats, or the signal comes again, and meets the
+    // disposition from before as usual
+    sigaction(SIGBUS, &previous, nullptr);
+    if (!fault) {
+      raise(SIGBUS);
+    }
+  }
+}
+
+/**
+ * Chains to the handler there was, installed by the
+ * first guarded read. False if that failed.
+ * */
+bool
+installHandler()
+{
+  static auto const installed = []() {
+    struct sigaction action
+    {};
+    action.sa_sigaction = &onBusError;
+    action.sa_flags = SA_SIGINFO | SA_NODEFER;
+    sigemptyset(&action.sa_mask);
+    return sigaction(SIGBUS, &action, &previous) == 0;
+  }();
+  return installed;
+}
+
+/**
+ * Runs fn, which reads the mapping of path. SIGBUS stays unblocked in
+ * the handler, so jumping out of it needs no signal mask to be saved.
+ * */
+template<typename F>
+void
+guarded(std::string const& path, F&& fn)
+{
+  if (!installHandler()) {
+    fn();
+    return;
+  }
+
+  sigjmp_buf env;
+  if (sigsetjmp(env, 0) != 0) {
+    reading = nullptr;
+    throw LoxRuntimeError{ path, path + ": File was truncated while open." };
+  }
+  // the stores must not move across the reads of fn
+  reading = &env;
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+  fn();
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+  reading = nullptr;
+}
+
+} // namespace
+
+#pragma region mapped_file
+
+std::string
+MappedFile::read(std::size_t pos, std::size_t len) const
+{
+  pos = std::min(pos, sz);
+  len = std::min(len, sz - pos);
+  // allocated up front, nothing is left to unwind when the read faults
+  auto res = std::string(len, '\0');
+  guarded(_path, [&]() { std::memcpy(res.data(), data + pos, len); });
+  return res;
+}
+
+std::size_t
+MappedFile::find(char ch, std::size_t pos) const
+{
+  if (pos >= sz) {
+    return std::string::npos;
+  }
+  auto const* found = static_cast<void const*>(nullptr);
+  guarded(_path, [&]() { found = std::memchr(data + pos, ch, sz - pos); });
+  return found ? static_cast<std::size_t>(static_cast<char const*>(found) -
+                                          data)
+               : std::string::npos;
+}
+
+std::string
+MappedFile::toString() const
+{
+  return "<file " + _path + ">";
+}
+
+MappedFile::MappedFile(std::string path)
+  : _path(std::move(path))
+  , data(nullptr)
+  , sz(0UL)
+{
+  auto fd = open(_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw systemError(_path);
+  }
+
+  struct stat info
+  {};
+  if (fstat(fd, &info) != 0) {
+    auto err = systemError(_path);
+    ::close(fd);
+    throw err;
+  }
+
+  sz = static_cast<std::size_t>(info.st_size);
+  if (sz > 0UL) {
+    auto* mem = mmap(nullptr, sz, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mem == MAP_FAILED) {
+      auto err = systemError(_path);
+      ::close(fd);
+      throw err;
+    }
+    madvise(mem, sz, MADV_SEQUENTIAL);
+    data = static_cast<char const*>(mem);
+  }
+
+  // the mapping keeps the file open
+  ::close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+  if (data) {
+    munmap(const_cast<char*>(data), sz);
+  }
+}
+
+#pragma endregion mapped_file
+
+#pragma region line_iterator
+
+bool
+LineIterator::hasNext(Interpreter&)
+{
+  return pos < file->size();
+}
+
+Object
+LineIterator::next(Interpreter&)
+{
+  if (pos >= file->size()) {
+    return Object::null();
+  }
+
+  auto end = file->find('\n', pos);
+  auto line = file->read(pos, end == std::string::npos ? end : end - pos);
+
+  pos += end == std::string::npos ? line.size() : line.size() + 1UL;
+  if (!line.empty() && line.back() == '\r') {
+    line.pop_back();
+  }
+  return Object{ std::move(line) };
+}
+
+std::string
+LineIterator::toString() const
+{
+  return "<lines " + file->path() + ">";
+}
+
+LineIterator::LineIterator(std::shared_ptr<MappedFile const> file)
+  : file(std::move(file))
+  , pos(0UL)
+{}
+
+#pragma endregion line_iterator
+
+#pragma region file_writer
+
+void
+FileWriter::write(std::string_view data)
+{
+  if (fd < 0) {
+    throw LoxRuntimeError{ path, "File is closed." };
+  }
+
+  if (buffer.size() + data.size() > buffer_size) {
+    writeOut(buffer);
+    buffer.clear();
+  }
+  if (data.size() >= buffer_size) {
+    // no point in copying it through the buffer
+    writeOut(data);
+    return;
+  }
+  buffer.append(data);
+}
+
+void
+FileWriter::close()
+{
+  if (fd < 0) {
+    return;
+  }
+
+  auto pending = std::exchange(buffer, std::string{});
+  try {
+    writeOut(pending);
+  } catch (LoxRuntimeError const&) {
+    ::close(std::exchange(fd, -1));
+    throw;
+  }
+  if (::close(std::exchange(fd, -1)) != 0) {
+    throw systemError(path);
+  }
+}
+
+std::string
+FileWriter::toString() const
+{
+  return "<file writer " + path + ">";
+}
+
+FileWriter::FileWriter(std::string path)
+  : path(std::move(path))
+  , fd(open(this->path.c_str(),
+            O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+            0644))
+  , buffer()
+{
+  if (fd < 0) {
+    throw systemError(this->path);
+  }
+  buffer.reserve(buffer_size);
+}
+
+FileWriter::~FileWriter()
+{
+  try {
+    close();
+  } catch (LoxRuntimeError const&) {
+    // nobody left to tell
+  }
+}
+
+void
+FileWriter::writeOut(std::string_view data)
+{
+  while (!data.empty()) {
+    auto n = ::write(fd, data.data(), data.size());
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw systemError(path);
+    }
+    data.remove_prefix(static_cast<std::size_t>(n));
+  }
+}
+
+#pragma endregion file_writer
+
+} // namespace Lox
\ No newline at end of file
@@ -0,0 +1,106 @@
+#include <iterator>
+
+#include <Callable.hpp>
+#include <Generator.hpp>
+
+namespace Lox {
+
+bool
+Generator::hasNext(Interpreter& interpreter)
+{
+  if (!ahead) {
+    ahead = resume(interpreter);
+  }
+  return ahead.has_value();
+}
+
+Object
+Generator::next(Interpreter& interpreter)
+{
+  if (!ahead) {
+    ahead = resume(interpreter);
+  }
+  auto res = ahead ? std::move(*ahead) : Object::null();
+  ahead.reset();
+  return res;
+}
+
+std::optional<Object>
+Generator::resume(Interpreter& interpreter)
+{
+  if (running) {
+    throw LoxRuntimeError{ toString(), "Generator is already running." };
+  }
+  if (tasks.empty()) {
+    return std::nullopt;
+  }
+
+  /**
+   * Resumed like a call whose frame the body's tasks go on top of.
+   * A return leaves it with its value dropped, like that of a
+   * statement, a yield with the value and the rest of the body.
+   * */
+  auto mark = interpreter.mark();
+  interpreter.operands.emplace_back();
+  interpreter.frames.push_back(Interpreter::CallFrame{
+    nullptr,
+    mark.operands,
+    mark.tasks,
+    std::exchange(interpreter.env, std::move(env)),
+    std::exchange(interpreter.code_owner, &owner),
+    std::nullopt,
+    this });
+  interpreter.tasks.insert(interpreter.tasks.end(),
+                           std::make_move_iterator(tasks.begin()),
+                           std::make_move_iterator(tasks.end()));
+  tasks.clear();
+
+  running = true;
+  try {
+    interpreter.run(mark);
+  } catch (...) {
+    interpreter.unwind(mark);
+    tasks.clear();
+    env = nullptr;
+    running = false;
+    throw;
+  }
+  running = false;
+
+  auto value = interpreter.pop();
+  if (tasks.empty()) {
+    env = nullptr;
+    return std::nullopt;
+  }
+  return value;
+}
+
+void
+Generator::suspend(std::vector<Interpreter::Task> rest, SharedEnv at)
+{
+  tasks = std::move(rest);
+  env = std::move(at);
+}
+
+std::string
+Generator::toString() const
+{
+  return "<generator " + declaration->name().lexeme() + ">";
+}
+
+Generator::Generator(
+  std::shared_ptr<FunctionDeclarationStatement const> declaration,
+  std::shared_ptr<void const> owner,
+  SharedEnv env)
+  : declaration(std::move(declaration))
+  , owner(std::move(owner))
+  , tasks()
+  , env(std::move(env))
+  , ahead()
+  , running(false)
+{
+  tasks.push_back(Interpreter::Task{
+    Interpreter::Task::Op::BODY, 0U, &this->declaration->body() });
+}
+
+} // namespace Lox
\ No newline at end of file
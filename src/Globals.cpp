@@ -1,25 +1,148 @@
 #include <chrono>
 
-#include <Callable.hpp>
+#include <File.hpp>
 #include <Globals.hpp>
+#include <Interpreter.hpp>
+#include <Iterator.hpp>
+#include <NativeBinding.hpp>
 #include <Statement.hpp>
 
 namespace Lox {
 
+namespace {
+
+double
+clock()
+{
+  using namespace std::chrono;
+
+  return static_cast<double>(
+    duration_cast<milliseconds>(system_clock::now().time_since_epoch())
+      .count());
+}
+
+Object
+load(Interpreter& interpreter, Arguments args)
+{
+  if (!args[0].isString()) {
+    throw LoxRuntimeError{ "load", "Argument 1 must be a string." };
+  }
+  interpreter.load(args[0].string());
+  return Object::null();
+}
+
+Iterator&
+iteratorArgument(Arguments args, std::string const& name)
+{
+  auto* iterator = args[0].native<Iterator>();
+  if (!iterator) {
+    throw LoxRuntimeError{ name, "Argument 1 must be an iterator." };
+  }
+  return *iterator;
+}
+
+Object
+hasNext(Interpreter& interpreter, Arguments args)
+{
+  return Object{ iteratorArgument(args, "hasNext").hasNext(interpreter) };
+}
+
+Object
+next(Interpreter& interpreter, Arguments args)
+{
+  return iteratorArgument(args, "next").next(interpreter);
+}
+
+std::shared_ptr<MappedFile>
+openFile(std::string const& path)
+{
+  return std::make_shared<MappedFile>(path);
+}
+
+std::string
+fileText(MappedFile& file)
+{
+  return file.read(0UL, file.size());
+}
+
+double
+fileSize(MappedFile& file)
+{
+  return static_cast<double>(file.size());
+}
+
+Object
+fileLines(Interpreter&, Arguments args)
+{
+  if (!args[0].native<MappedFile>()) {
+    throw LoxRuntimeError{ "fileLines", "Argument 1 must be a file." };
+  }
+  // the lines keep the mapping alive
+  auto file = std::static_pointer_cast<MappedFile const>(args[0].sharedNative());
+  return Object{ std::shared_ptr<NativeObject>{
+    std::make_shared<LineIterator>(std::move(file)) } };
+}
+
+std::shared_ptr<FileWriter>
+createFile(std::string const& path)
+{
+  return std::make_shared<FileWriter>(path);
+}
+
+void
+fileWrite(FileWriter& file, Object const& value)
+{
+  if (value.isString()) {
+    file.write(value.string());
+  } else {
+    file.write(Interpreter::stringify(value));
+  }
+}
+
+void
+fileWriteLine(FileWriter& file, Object const& value)
+{
+  fileWrite(file, value);
+  file.write("\n");
+}
+
+void
+fileClose(FileWriter& file)
+{
+  file.close();
+}
+
+} // namespace
+
 void
 defineGlobals(Environment& env)
 {
-  using namespace std::chrono;
+  env.define("clock", Object{ NativeFunction::bind<&clock>("clock") });
+  env.define("load",
+             Object{ std::make_unique<NativeFunction>("load", &load, 1UL) });
+  env.define(
+    "hasNext",
+    Object{ std::make_unique<NativeFunction>("hasNext", &hasNext, 1UL) });
+  env.define("next",
+             Object{ std::make_unique<NativeFunction>("next", &next, 1UL) });
 
+  env.define("openFile",
+             Object{ NativeFunction::bind<&openFile>("openFile") });
+  env.define("fileText",
+             Object{ NativeFunction::bind<&fileText>("fileText") });
+  env.define("fileSize",
+             Object{ NativeFunction::bind<&fileSize>("fileSize") });
   env.define(
-    "clock",
-    Object{ std::make_unique<NativeFunction>(
-      [](std::vector<Object> const&) {
-        return Object{ static_cast<double>(
-          duration_cast<milliseconds>(system_clock::now().time_since_epoch())
-            .count()) };
-      },
-      0UL) });
+    "fileLines",
+    Object{ std::make_unique<NativeFunction>("fileLines", &fileLines, 1UL) });
+  env.define("createFile",
+             Object{ NativeFunction::bind<&createFile>("createFile") });
+  env.define("fileWrite",
+             Object{ NativeFunction::bind<&fileWrite>("fileWrite") });
+  env.define("fileWriteLine",
+             Object{ NativeFunction::bind<&fileWriteLine>("fileWriteLine") });
+  env.define("fileClose",
+             Object{ NativeFunction::bind<&fileClose>("fileClose") });
 }
 
 } // namespace Lox
\ No newline at end of file
@@ -1,32 +1,365 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
 #include <Globals.hpp>
 #include <Interpreter.hpp>
+#include <NativeModule.hpp>
 
 #include <Callable.hpp>
+#include <Generator.hpp>
+#include <NativeObject.hpp>
+#include <NativeStack.hpp>
+#include <Program.hpp>
 
 namespace Lox {
 
+namespace {
+
+// where a counted loop is at, see Interpreter::stepCountedLoop()
+enum CountedStep : std::uint32_t
+{
+  COUNTED_START,
+  COUNTED_CHECK,
+  COUNTED_BOUND,
+  COUNTED_NEXT
+};
+
+} // namespace
+
+/**
+ * Enters nodes that are stepped: pushes the tasks of what is left to
+ * do of them and enters their first operand.
+ * */
+class Interpreter::Stepper
+  : public ExpressionVisitor
+  , public StatementVisitor
+{
+public:
+  virtual void visitBlockStatement(BlockStatement const& stmt) override
+  {
+    auto const& statements = stmt.statements();
+    if (!stmt.hasLocals() && statements.size() == 1UL) {
+      // like loop bodies of a single call, nothing to come back to
+      interpreter.enter(*statements.front());
+      return;
+    }
+
+    auto outer = SharedEnv{};
+    if (stmt.hasLocals()) {
+      auto block_env = interpreter.makeEnvironment(interpreter.env);
+      outer = std::exchange(interpreter.env, std::move(block_env));
+    }
+    interpreter.tasks.push_back(
+      Task{ Task::Op::BLOCK, 0U, &statements, std::move(outer) });
+  }
+
+  virtual void visitExpressionStatement(
+    ExpressionStatement const& stmt) override
+  {
+    auto& tasks = interpreter.tasks;
+    push(Task::Op::DISCARD, &stmt);
+    interpreter.enter(stmt.expression());
+
+    // finished right away, like calls of natives do
+    if (tasks.back().node == &stmt) {
+      tasks.pop_back();
+      interpreter.operands.pop_back();
+    }
+  }
+
+  virtual void visitPrintStatement(PrintStatement const& stmt) override
+  {
+    push(Task::Op::PRINT, &stmt);
+    interpreter.enter(stmt.expression());
+  }
+
+  virtual void visitVarDeclarationStatement(
+    VarDeclarationStatement const& stmt) override
+  {
+    push(Task::Op::DEFINE, &stmt);
+    interpreter.enter(stmt.initializer());
+  }
+
+  virtual void visitIfStatement(IfStatement const& stmt) override
+  {
+    if (stmt.condition().stepped()) {
+      push(Task::Op::IF, &stmt);
+      interpreter.enter(stmt.condition());
+      return;
+    }
+
+    if (isTruthy(interpreter.evaluate(stmt.condition()))) {
+      interpreter.enter(stmt.thenBranch());
+    } else if (stmt.hasElseBranch()) {
+      interpreter.enter(stmt.elseBranch());
+    }
+  }
+
+  virtual void visitWhileStatement(WhileStatement const& stmt) override
+  {
+    auto const* loop = stmt.countedLoop();
+    push(loop && loop->checked ? Task::Op::COUNTED : Task::Op::WHILE, &stmt);
+  }
+
+  virtual void visitFunctionDeclarationStatement(
+    FunctionDeclarationStatement const& stmt) override
+  {
+    interpreter.visitFunctionDeclarationStatement(stmt);
+  }
+
+  virtual void visitReturnStatement(ReturnStatement const& stmt) override
+  {
+    push(Task::Op::RETURN, &stmt);
+    interpreter.enter(stmt.value());
+  }
+
+  virtual void visitYieldStatement(YieldStatement const& stmt) override
+  {
+    push(Task::Op::YIELD, &stmt);
+    interpreter.enter(stmt.value());
+  }
+
+  virtual std::any visitAssignmentExpression(
+    AssignmentExpression const& expr) override
+  {
+    push(Task::Op::ASSIGN, &expr);
+    interpreter.enter(expr.value());
+    return {};
+  }
+
+  virtual std::any visitBinaryExpression(BinaryExpression const& expr) override
+  {
+    auto op_type = expr.op().type();
+    if (op_type == TokenType::AND || op_type == TokenType::OR) {
+      push(Task::Op::LOGICAL, &expr);
+    } else {
+      push(Task::Op::BINARY, &expr);
+      // an rhs that isn't stepped is evaluated by the task itself
+      if (expr.rhs().stepped()) {
+        push(Task::Op::EVALUATE, &expr.rhs());
+      }
+    }
+    interpreter.enter(expr.lhs());
+    return {};
+  }
+
+  virtual std::any visitGroupingExpression(
+    GroupingExpression const& expr) override
+  {
+    interpreter.enter(expr.expr());
+    return {};
+  }
+
+  virtual std::any visitLiteralExpression(
+    LiteralExpression const& expr) override
+  {
+    interpreter.operands.push_back(expr.value());
+    return {};
+  }
+
+  virtual std::any visitVariableExpression(
+    VariableExpression const& expr) override
+  {
+    interpreter.operands.push_back(interpreter.evaluate(expr));
+    return {};
+  }
+
+  virtual std::any visitUnaryExpression(UnaryExpression const& expr) override
+  {
+    push(Task::Op::UNARY, &expr);
+    interpreter.enter(expr.rhs());
+    return {};
+  }
+
+  virtual std::any visitCallExpression(CallExpression const& expr) override
+  {
+    if (expr.steppedOperands()) {
+      // the task enters the arguments one after the other
+      push(Task::Op::CALL, &expr);
+      interpreter.enter(expr.callee());
+      return {};
+    }
+
+    // nothing to step through before the call itself
+    auto count = expr.arguments().size();
+    auto callee = interpreter.evaluate(expr.callee());
+    auto args = interpreter.arg_stack.push(count);
+    interpreter.evaluateArguments(expr, args);
+    auto const& callable = checkCall(callee, count);
+    auto const* fn = callable.function();
+    if (!fn) {
+      interpreter.operands.push_back(
+        interpreter.callNative(callable, args.arguments()));
+      return {};
+    }
+
+    auto slot = interpreter.operands.size();
+    interpreter.operands.push_back(std::move(callee));
+    for (auto i = 0UL; i < count; ++i) {
+      interpreter.operands.push_back(std::move(args[i]));
+    }
+    interpreter.startCall(
+      *fn, Arguments{ interpreter.operands.data() + slot + 1UL, count }, slot);
+    return {};
+  }
+
+  explicit Stepper(Interpreter& interpreter)
+    : interpreter(interpreter)
+  {}
+
+private:
+  void push(Task::Op op, void const* node)
+  {
+    interpreter.tasks.push_back(Task{ op, 0U, node });
+  }
+
+private:
+  Interpreter& interpreter;
+};
+
 Environment&
 Interpreter::environment()
 {
   return *env;
 }
 
-void
+bool
 Interpreter::interpret(std::vector<Stmt> const& statements)
 {
+  _budget.start();
   try {
     for (auto& stmt : statements) {
       execute(*stmt);
     }
+    if (events && events->pending()) {
+      events->run(*this);
+    }
   } catch (LoxRuntimeError err) {
-    std::cout << err.what() << std::endl;
+    *out << err.what() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool
+Interpreter::interpret(std::shared_ptr<Program const> const& program)
+{
+  auto owner = std::shared_ptr<void const>{ program };
+  auto scope = CodeScope{ *this, owner };
+  return interpret(program->statements());
+}
+
+void
+Interpreter::snapshot()
+{
+  globals->snapshot();
+  forgetSiteCells();
+}
+
+void
+Interpreter::reset()
+{
+  events.reset();
+  env = globals;
+  out = &std::cout;
+  resetGlobals();
+
+  // results of the script's functions keep its programs alive
+  if (memo) {
+    memo->clear();
+  }
+}
+
+void
+Interpreter::resetGlobals()
+{
+  if (!globals->restore()) {
+    globals->clear();
+    defineGlobals(*globals);
+  }
+  forgetSiteCells();
+}
+
+void
+Interpreter::withOwnGlobals(std::function<void()> const& fn)
+{
+  auto outer = std::exchange(env, nullptr);
+  auto outer_globals = globals;
+  if (spare_globals.empty()) {
+    spare_globals.push_back(std::make_shared<Environment>());
+    defineGlobals(*spare_globals.back());
+    spare_globals.back()->snapshot();
+  }
+  globals = std::move(spare_globals.back());
+  spare_globals.pop_back();
+  env = globals;
+  forgetSiteCells();
+
+  auto leave = [&]() {
+    // the values fn left behind go now rather than on the next use
+    resetGlobals();
+    spare_globals.push_back(std::exchange(globals, outer_globals));
+    env = std::move(outer);
+    forgetSiteCells();
+  };
+  try {
+    fn();
+  } catch (...) {
+    leave();
+    throw;
+  }
+  leave();
+}
+
+void
+Interpreter::setMaxCallDepth(size_t depth)
+{
+  if (depth > limit_max_call_depth) {
+    throw std::invalid_argument{ "Call depth must be at most " +
+                                 std::to_string(limit_max_call_depth) + "." };
+  }
+  max_call_depth = depth;
+  frames.reserve(std::min(depth, 1024UL));
+}
+
+void
+Interpreter::enableMemoization(MemoOptions options)
+{
+  memo = std::make_unique<Memoizer>(options);
+}
+
+void
+Interpreter::enableJit(JitOptions options)
+{
+  _jit = std::make_unique<Jit>(options);
+}
+
+EventLoop&
+Interpreter::eventLoop()
+{
+  if (!events) {
+    events = std::make_unique<EventLoop>();
   }
+  return *events;
 }
 
 void
 Interpreter::visitBlockStatement(BlockStatement const& stmt)
 {
-  executeBlock(stmt.statements(), std::make_shared<Environment>(env));
+  if (!stmt.hasLocals()) {
+    // nothing would ever be defined in a new environment
+    for (auto& inner : stmt.statements()) {
+      execute(*inner);
+    }
+    return;
+  }
+
+  executeBlock(stmt.statements(), makeEnvironment(env));
 }
 
 void
@@ -39,13 +372,13 @@ void
 Interpreter::visitPrintStatement(PrintStatement const& stmt)
 {
   auto val = evaluate(stmt.expression());
-  std::cout << stringify(val) << std::endl;
+  *out << stringify(val) << std::endl;
 }
 
 void
 Interpreter::visitVarDeclarationStatement(VarDeclarationStatement const& stmt)
 {
-  env->define(stmt.name().lexeme(), evaluate(stmt.initializer()));
+  define(stmt, evaluate(stmt.initializer()));
 }
 
 void
@@ -61,8 +394,16 @@ Interpreter::visitIfStatement(IfStatement const& stmt)
 void
 Interpreter::visitWhileStatement(WhileStatement const& stmt)
 {
+  auto frame = SharedEnv{};
+
+  auto const* loop = stmt.countedLoop();
+  if (loop && loop->checked && runCountedLoop(stmt, *loop, frame)) {
+    return;
+  }
+
   while (isTruthy(evaluate(stmt.condition()))) {
-    execute(stmt.body());
+    _budget.tick();
+    executeLoopBody(stmt.body(), frame);
   }
 }
 
@@ -70,10 +411,23 @@ void
 Interpreter::visitFunctionDeclarationStatement(
   FunctionDeclarationStatement const& stmt)
 {
-  auto func = std::make_unique<LoxFunction>(
-    std::unique_ptr<FunctionDeclarationStatement>{
-      dynamic_cast<FunctionDeclarationStatement*>(stmt.clone().release()) },
-    env);
+  /**
+   * Bare statements may be gone by the time the function is called,
+   * so it gets a copy unless something keeps the tree alive.
+   * */
+  auto declaration =
+    code_owner
+      ? std::shared_ptr<FunctionDeclarationStatement const>{ *code_owner,
+                                                             &stmt }
+      : std::shared_ptr<FunctionDeclarationStatement const>{
+          dynamic_cast<FunctionDeclarationStatement*>(stmt.clone().release())
+        };
+  _budget.allocate(sizeof(LoxFunction));
+  auto func = std::make_unique<LoxFunction>(std::move(declaration), env);
+  if (memo && env == globals) {
+    replacingGlobal(stmt.name().lexeme(),
+                    globals->cell(stmt.name().lexeme()));
+  }
   env->define(stmt.name().lexeme(), Object{ std::move(func) });
 }
 
@@ -83,12 +437,20 @@ Interpreter::visitReturnStatement(ReturnStatement const& stmt)
   throw ReturnValue{ evaluate(stmt.value()) };
 }
 
+void
+Interpreter::visitYieldStatement(YieldStatement const&)
+{
+  // the yields of generator bodies are stepped, see Generator
+  throw LoxRuntimeError{ "yield", "Can't yield outside of a function." };
+}
+
 std::any
 Interpreter::visitAssignmentExpression(AssignmentExpression const& expr)
 {
+  // the value is both stored and the result, one copy is needed
   auto val = evaluate(expr.value());
-  env->assign(expr.name(), val);
-  return val;
+  assign(expr, val);
+  return produce(std::move(val));
 }
 
 std::any
@@ -101,88 +463,190 @@ Interpreter::visitBinaryExpression(BinaryExpression const& expr)
 
     if (expr.op().type() == TokenType::OR) {
       if (isTruthy(lhs))
-        return lhs;
+        return produce(std::move(lhs));
     } else {
       if (!isTruthy(lhs)) {
-        return lhs;
+        return produce(std::move(lhs));
       }
     }
 
-    return evaluate(expr.rhs());
-
-  } else {
-
-    auto lhs = evaluate(expr.lhs());
-    auto rhs = evaluate(expr.rhs());
-
-    switch (expr.op().type()) {
-      case TokenType::BANG_EQUAL:
-        return Object{ !isEqual(lhs, rhs) };
-      case TokenType::EQUAL_EQUAL:
-        return Object{ isEqual(lhs, rhs) };
-      case TokenType::GREATER:
-        checkNumberOperands(expr.op(), lhs, rhs);
-        return Object{ lhs.number() > rhs.number() };
-      case TokenType::GREATER_EQUAL:
-        checkNumberOperands(expr.op(), lhs, rhs);
-        return Object{ lhs.number() >= rhs.number() };
-      case TokenType::LESS:
-        checkNumberOperands(expr.op(), lhs, rhs);
-        return Object{ lhs.number() < rhs.number() };
-      case TokenType::LESS_EQUAL:
-        checkNumberOperands(expr.op(), lhs, rhs);
-        return Object{ lhs.number() <= rhs.number() };
-      case TokenType::MINUS:
-        checkNumberOperands(expr.op(), lhs, rhs);
-        return Object{ lhs.number() - rhs.number() };
-      case TokenType::PLUS:
-        if (lhs.isNumber() && rhs.isNumber()) {
-          return Object{ lhs.number() + rhs.number() };
-        } else if (lhs.isString() && rhs.isString()) {
-          return Object{ lhs.string() + rhs.string() };
-        } else {
-          throw LoxRuntimeError{
-            expr.op(), "Operands must be two numbers or two strings"
-          };
-        }
-      case TokenType::SLASH:
-        checkNumberOperands(expr.op(), lhs, rhs);
-        return Object{ lhs.number() / rhs.number() };
-      case TokenType::STAR:
-        checkNumberOperands(expr.op(), lhs, rhs);
-        return Object{ lhs.number() * rhs.number() };
-      default:
-        return Object::null();
-    }
+    return expr.rhs().accept(*this);
   }
+
+  auto lhs = evaluate(expr.lhs());
+  auto rhs = evaluate(expr.rhs());
+  return produce(binary(expr, lhs, rhs));
 }
 
 std::any
 Interpreter::visitGroupingExpression(GroupingExpression const& expr)
 {
-  return evaluate(expr.expr());
+  return expr.expr().accept(*this);
 }
 
 std::any
 Interpreter::visitLiteralExpression(LiteralExpression const& expr)
 {
-  return expr.value();
+  return produce(expr.value());
 }
 
 std::any
 Interpreter::visitVariableExpression(VariableExpression const& expr)
 {
-  return env->get(expr.name());
+  if (expr.site().global) {
+    if (auto* cell = globalCell(expr.name(), expr.site())) {
+      return produce(*cell);
+    }
+    throw LoxRuntimeError{ expr.name(),
+                           "Undefined variable " + expr.name().lexeme() };
+  }
+
+  return produce(env->get(expr.name()));
 }
 
 std::any
 Interpreter::visitUnaryExpression(UnaryExpression const& expr)
 {
-  auto rhs = evaluate(expr.rhs());
+  return produce(unary(expr, evaluate(expr.rhs())));
+}
+
+std::any
+Interpreter::visitCallExpression(CallExpression const& expr)
+{
+  /**
+   * Reached from visits outside of the frame stack only, calls of Lox
+   * functions run on it. Inside, stepped nodes are entered instead.
+   * */
+  if (expr.steppedOperands()) {
+    return produce(step(expr));
+  }
+
+  // evaluated in place, the callee gets a view of the slots
+  auto callee = evaluate(expr.callee());
+  auto args = arg_stack.push(expr.arguments().size());
+  evaluateArguments(expr, args);
+  return produce(call(callee, args.arguments()));
+}
 
+void
+Interpreter::evaluateArguments(CallExpression const& expr,
+                               ArgumentStack::Frame& args)
+{
+  auto const& arguments = expr.arguments();
+  for (auto i = 0UL; i < arguments.size(); ++i) {
+    args[i] = evaluate(*arguments[i]);
+  }
+}
+
+Object
+Interpreter::call(Object const& callee, Arguments args)
+{
+  auto const& callable = checkCall(callee, args.size());
+  if (auto const* fn = callable.function()) {
+    return callFunction(*fn, args, callee);
+  }
+  return callNative(callable, args);
+}
+
+void
+Interpreter::define(VarDeclarationStatement const& stmt, Object value)
+{
+  if (memo && env == globals) {
+    replacingGlobal(stmt.name().lexeme(),
+                    globals->cell(stmt.name().lexeme()));
+  }
+  env->define(stmt.name().lexeme(), std::move(value));
+}
+
+void
+Interpreter::assign(AssignmentExpression const& expr, Object const& value)
+{
+  if (expr.site().global) {
+    if (auto& global = siteCell(expr.name(), expr.site()); global.cell) {
+      if (!global.preserved) {
+        globals->preserve(global.cell);
+        global.preserved = true;
+      }
+      if (memo) {
+        replacingGlobal(expr.name().lexeme(), global.cell);
+      }
+      globals->written();
+      *global.cell = value;
+      return;
+    }
+    throw LoxRuntimeError{ expr.name(),
+                           "Undefined variable '" + expr.name().lexeme() +
+                             "'" };
+  }
+
+  env->assign(expr.name(), value);
+}
+
+Object
+Interpreter::binary(BinaryExpression const& expr,
+                    Object const& lhs,
+                    Object const& rhs)
+{
+  auto op_type = expr.op().type();
+
+  if (lhs.isInteger() && rhs.isInteger()) {
+    if (auto res = integerArithmetic(op_type, lhs.integer(), rhs.integer())) {
+      return std::move(*res);
+    }
+  }
+
+  switch (expr.op().type()) {
+    case TokenType::BANG_EQUAL:
+      return Object{ !isEqual(lhs, rhs) };
+    case TokenType::EQUAL_EQUAL:
+      return Object{ isEqual(lhs, rhs) };
+    case TokenType::GREATER:
+      checkNumberOperands(expr.op(), lhs, rhs);
+      return Object{ lhs.number() > rhs.number() };
+    case TokenType::GREATER_EQUAL:
+      checkNumberOperands(expr.op(), lhs, rhs);
+      return Object{ lhs.number() >= rhs.number() };
+    case TokenType::LESS:
+      checkNumberOperands(expr.op(), lhs, rhs);
+      return Object{ lhs.number() < rhs.number() };
+    case TokenType::LESS_EQUAL:
+      checkNumberOperands(expr.op(), lhs, rhs);
+      return Object{ lhs.number() <= rhs.number() };
+    case TokenType::MINUS:
+      checkNumberOperands(expr.op(), lhs, rhs);
+      return Object{ lhs.number() - rhs.number() };
+    case TokenType::PLUS:
+      if (lhs.isNumber() && rhs.isNumber()) {
+        return Object{ lhs.number() + rhs.number() };
+      } else if (lhs.isString() && rhs.isString()) {
+        _budget.allocate(lhs.string().size() + rhs.string().size());
+        return Object{ lhs.string() + rhs.string() };
+      } else {
+        throw LoxRuntimeError{
+          expr.op(), "Operands must be two numbers or two strings"
+        };
+      }
+    case TokenType::SLASH:
+      checkNumberOperands(expr.op(), lhs, rhs);
+      return Object{ lhs.number() / rhs.number() };
+    case TokenType::STAR:
+      checkNumberOperands(expr.op(), lhs, rhs);
+      return Object{ lhs.number() * rhs.number() };
+    default:
+      return Object::null();
+  }
+}
+
+Object
+Interpreter::unary(UnaryExpression const& expr, Object const& rhs)
+{
   switch (expr.op().type()) {
     case TokenType::MINUS:
       checkNumberOperand(expr.op(), rhs);
+      // -0 only exists as a double
+      if (rhs.isInteger() && rhs.integer() != 0) {
+        return Object::fromInteger(-rhs.integer());
+      }
       return Object{ -rhs.number() };
     case TokenType::BANG:
       return Object{ !isTruthy(rhs) };
@@ -191,24 +655,122 @@ Interpreter::visitUnaryExpression(UnaryExpression const& expr)
   }
 }
 
-std::any
-Interpreter::visitCallExpression(CallExpression const& expr)
+void
+Interpreter::load(NativeModule const& module)
 {
-  auto callee = evaluate(expr.callee());
-  auto args = std::vector<Object>{};
-  for (auto& arg : expr.arguments()) {
-    args.push_back(evaluate(*arg));
+  module.load(*globals);
+}
+
+void
+Interpreter::load(std::string_view module)
+{
+  auto found = NativeModule::find(module);
+  if (!found) {
+    throw LoxRuntimeError{ std::string{ module },
+                           "Unknown module '" + std::string{ module } + "'." };
   }
+  load(*found);
+}
 
-  return callee.callable().call(*this, args);
+SharedEnv
+Interpreter::makeEnvironment(SharedEnv parent)
+{
+  _budget.allocate(sizeof(Environment));
+  return pool->make(std::move(parent));
 }
 
 Interpreter::Interpreter()
-  : env(std::make_unique<Environment>())
+  : pool(std::make_shared<EnvironmentPool>())
+  , env(std::make_unique<Environment>())
+  , globals(env)
+  , spare_globals()
+  , arg_stack()
+  , evaluated()
+  , site_cells()
+  , cached_unit(0U)
+  , cached_cells(nullptr)
+  , out(&std::cout)
+  , code_owner(nullptr)
+  , frames()
+  , tasks()
+  , operands()
+  , max_call_depth(default_max_call_depth)
+  , _budget()
+  , memo()
+  , _jit()
+  , events()
+  , task_snapshot()
 {
+  frames.reserve(1024UL);
   defineGlobals(*env);
 }
 
+Object*
+Interpreter::globalCell(Token const& name, GlobalSite const& site)
+{
+  return siteCell(name, site).cell;
+}
+
+Interpreter::SiteCell&
+Interpreter::siteCell(Token const& name, GlobalSite const& site)
+{
+  /**
+   * Cells of the global environment never move, so once a site has
+   * found its cell it can keep using it. The cache lives here rather
+   * than in the site, other interpreters may run the same tree.
+   * */
+  if (site.unit != cached_unit) {
+    cached_cells = &site_cells[site.unit];
+    cached_unit = site.unit;
+  }
+
+  auto& cells = *cached_cells;
+  if (site.index >= cells.size()) {
+    cells.resize(site.index + 1U);
+  }
+  if (!cells[site.index].cell) {
+    cells[site.index].cell = globals->cell(name.lexeme());
+  }
+
+  return cells[site.index];
+}
+
+void
+Interpreter::forgetSiteCells() noexcept
+{
+  site_cells.clear();
+  cached_unit = 0U;
+  cached_cells = nullptr;
+}
+
+void
+Interpreter::replacingGlobal(std::string const& name,
+                             Object const* global) noexcept
+{
+  // even an impure function may have been called by a pure one of
+  // an earlier unit, whose purity was decided when it was declared
+  if (global && global->isCallable() &&
+      dynamic_cast<LoxFunction const*>(&global->callable())) {
+    memo->invalidate(name);
+  }
+}
+
+void
+Interpreter::pushFrame(Callable const& callee)
+{
+  if (frames.size() >= max_call_depth) {
+    throw LoxRuntimeError{ callee.toString(), "Stack overflow." };
+  }
+  _budget.tick();
+  frames.push_back(CallFrame{ &callee });
+}
+
+void
+Interpreter::popFrame() noexcept
+{
+  frames.pop_back();
+}
+
 void
 Interpreter::execute(Statement const& stmt)
 {
@@ -233,10 +795,571 @@ Interpreter::executeBlock(std::vector<Stmt> const& statements,
   env.swap(block_env);
 }
 
+bool
+Interpreter::runCountedLoop(WhileStatement const& stmt,
+                            CountedLoop const& loop,
+                            SharedEnv& frame)
+{
+  // the loop runs in the block that declared the counter
+  auto* cell = env->cell(loop.counter);
+  if (!cell || !cell->isInteger()) {
+    return false;
+  }
+  if (env->hasSnapshot()) {
+    env->preserve(cell);
+  }
+  env->written();
+
+  auto const* literal = dynamic_cast<LiteralExpression const*>(&stmt.bound());
+  auto counter = cell->integer();
+  auto evaluated = Object{};
+
+  for (;;) {
+    auto const& limit =
+      literal ? literal->value() : (evaluated = evaluate(stmt.bound()));
+    if (!limit.isNumber()) {
+      // the regular loop reports the error
+      *cell = Object::fromInteger(counter);
+      return false;
+    }
+
+    auto more = limit.isInteger() ? (loop.inclusive ? counter <= limit.integer()
+                                                    : counter < limit.integer())
+                                  : (loop.inclusive ? counter <= limit.number()
+                                                    : counter < limit.number());
+    if (!more) {
+      break;
+    }
+
+    _budget.tick();
+
+    // nothing but the body can see the counter
+    if (loop.body_reads_counter) {
+      *cell = Object::fromInteger(counter);
+    }
+    executeLoopBody(stmt.loopBody(), frame);
+
+    if (counter > Object::max_integer - loop.step) {
+      // beyond exact integers, continue with doubles
+      *cell = Object::fromInteger(counter);
+      execute(stmt.increment());
+      return false;
+    }
+    counter += loop.step;
+  }
+
+  *cell = Object::fromInteger(counter);
+  return true;
+}
+
+void
+Interpreter::executeLoopBody(Statement const& body, SharedEnv& frame)
+{
+  auto const* block = dynamic_cast<BlockStatement const*>(&body);
+  if (!block || !block->hasLocals() || block->hasClosures()) {
+    execute(body);
+    return;
+  }
+
+  /**
+   * No closure can hold on to the environment of the block,
+   * so every iteration can start over in the same one.
+   * */
+  if (!frame) {
+    frame = makeEnvironment(env);
+  } else {
+    frame->clear();
+  }
+  executeBlock(block->statements(), frame);
+}
+
 Object
 Interpreter::evaluate(Expression const& expr)
 {
-  return std::any_cast<Object>(expr.accept(*this));
+  expr.accept(*this);
+  return std::move(evaluated);
+}
+
+Object
+Interpreter::step(Expression const& expr)
+{
+  auto mark = this->mark();
+  try {
+    enter(expr);
+    run(mark);
+  } catch (...) {
+    unwind(mark);
+    throw;
+  }
+  return pop();
+}
+
+Interpreter::Mark
+Interpreter::mark() const
+{
+  return Mark{ tasks.size(), operands.size(), frames.size(), env, code_owner };
+}
+
+Object
+Interpreter::pop()
+{
+  auto value = std::move(operands.back());
+  operands.pop_back();
+  return value;
+}
+
+void
+Interpreter::run(Mark const& mark)
+{
+  using Op = Task::Op;
+
+  while (tasks.size() > mark.tasks) {
+    // invalidated by whatever pushes tasks
+    auto& task = tasks.back();
+
+    switch (task.op) {
+      case Op::BLOCK:
+      case Op::BODY: {
+        auto const& statements =
+          *static_cast<std::vector<Stmt> const*>(task.node);
+        if (task.index < statements.size()) {
+          enter(*statements[task.index++]);
+        } else if (task.op == Op::BODY) {
+          // ran off the end without a return
+          tasks.pop_back();
+          leave(Object::null());
+        } else {
+          if (task.env) {
+            env = std::move(task.env);
+          }
+          tasks.pop_back();
+        }
+        break;
+      }
+      case Op::DISCARD:
+        tasks.pop_back();
+        operands.pop_back();
+        break;
+      case Op::PRINT:
+        tasks.pop_back();
+        *out << stringify(operands.back()) << std::endl;
+        operands.pop_back();
+        break;
+      case Op::DEFINE: {
+        auto const& stmt =
+          *static_cast<VarDeclarationStatement const*>(task.node);
+        tasks.pop_back();
+        define(stmt, pop());
+        break;
+      }
+      case Op::IF: {
+        auto const& stmt = *static_cast<IfStatement const*>(task.node);
+        tasks.pop_back();
+        if (isTruthy(pop())) {
+          enter(stmt.thenBranch());
+        } else if (stmt.hasElseBranch()) {
+          enter(stmt.elseBranch());
+        }
+        break;
+      }
+      case Op::WHILE: {
+        auto const& stmt = *static_cast<WhileStatement const*>(task.node);
+        auto const& condition = stmt.condition();
+        if (condition.stepped() && task.index == 0U) {
+          // back here with its value
+          task.index = 1U;
+          enter(condition);
+          break;
+        }
+
+        auto more = condition.stepped() ? isTruthy(pop())
+                                        : isTruthy(evaluate(condition));
+        if (!more) {
+          tasks.pop_back();
+          break;
+        }
+        task.index = 0U;
+        _budget.tick();
+        enterLoopBody(stmt.body(), task.env);
+        break;
+      }
+      case Op::COUNTED:
+        stepCountedLoop();
+        break;
+      case Op::RETURN: {
+        tasks.pop_back();
+        leave(pop());
+        break;
+      }
+      case Op::YIELD: {
+        tasks.pop_back();
+        // the generator takes what is left of its body along
+        auto& frame = frames.back();
+        frame.generator->suspend(
+          std::vector<Task>{
+            std::make_move_iterator(tasks.begin() +
+                                    static_cast<std::ptrdiff_t>(frame.tasks)),
+            std::make_move_iterator(tasks.end()) },
+          env);
+        leave(pop());
+        break;
+      }
+      case Op::EVALUATE: {
+        auto const& expr = *static_cast<Expression const*>(task.node);
+        tasks.pop_back();
+        enter(expr);
+        break;
+      }
+      case Op::ASSIGN: {
+        auto const& expr = *static_cast<AssignmentExpression const*>(task.node);
+        tasks.pop_back();
+        assign(expr, operands.back());
+        break;
+      }
+      case Op::LOGICAL: {
+        auto const& expr = *static_cast<BinaryExpression const*>(task.node);
+        tasks.pop_back();
+        auto decided = expr.op().type() == TokenType::OR
+                         ? isTruthy(operands.back())
+                         : !isTruthy(operands.back());
+        if (!decided) {
+          operands.pop_back();
+          enter(expr.rhs());
+        }
+        break;
+      }
+      case Op::BINARY: {
+        auto const& expr = *static_cast<BinaryExpression const*>(task.node);
+        tasks.pop_back();
+        auto rhs = expr.rhs().stepped() ? pop() : evaluate(expr.rhs());
+        operands.back() = binary(expr, operands.back(), rhs);
+        break;
+      }
+      case Op::UNARY: {
+        auto const& expr = *static_cast<UnaryExpression const*>(task.node);
+        tasks.pop_back();
+        operands.back() = unary(expr, operands.back());
+        break;
+      }
+      case Op::CALL: {
+        auto const& expr = *static_cast<CallExpression const*>(task.node);
+        auto const& arguments = expr.arguments();
+        if (task.index < arguments.size()) {
+          enter(*arguments[task.index++]);
+          break;
+        }
+        tasks.pop_back();
+        callOperands(arguments.size());
+        break;
+      }
+    }
+  }
+}
+
+void
+Interpreter::unwind(Mark const& mark) noexcept
+{
+  tasks.erase(tasks.begin() + static_cast<std::ptrdiff_t>(mark.tasks),
+              tasks.end());
+  operands.erase(operands.begin() + static_cast<std::ptrdiff_t>(mark.operands),
+                 operands.end());
+  frames.erase(frames.begin() + static_cast<std::ptrdiff_t>(mark.frames),
+               frames.end());
+  env = mark.env;
+  code_owner = mark.code_owner;
+}
+
+void
+Interpreter::enter(Statement const& stmt)
+{
+  if (!stmt.stepped()) {
+    stmt.accept(*this);
+    return;
+  }
+
+  auto stepper = Stepper{ *this };
+  stmt.accept(stepper);
+}
+
+void
+Interpreter::enter(Expression const& expr)
+{
+  if (!expr.stepped()) {
+    expr.accept(*this);
+    operands.push_back(std::move(evaluated));
+    return;
+  }
+
+  auto stepper = Stepper{ *this };
+  expr.accept(stepper);
+}
+
+void
+Interpreter::enterLoopBody(Statement const& body, SharedEnv& frame)
+{
+  if (!body.stepped()) {
+    executeLoopBody(body, frame);
+    return;
+  }
+
+  auto const* block = dynamic_cast<BlockStatement const*>(&body);
+  if (!block || !block->hasLocals() || block->hasClosures()) {
+    enter(body);
+    return;
+  }
+
+  // see executeLoopBody()
+  if (!frame) {
+    frame = makeEnvironment(env);
+  } else {
+    frame->clear();
+  }
+  auto block_env = frame;
+  tasks.push_back(Task{ Task::Op::BLOCK,
+                        0U,
+                        &block->statements(),
+                        std::exchange(env, std::move(block_env)) });
+}
+
+void
+Interpreter::stepCountedLoop()
+{
+  auto& task = tasks.back();
+  auto const& stmt = *static_cast<WhileStatement const*>(task.node);
+  auto const& loop = *stmt.countedLoop();
+
+  // the regular loop takes over where the counted one leaves off
+  auto fallBack = [&task]() {
+    task.op = Task::Op::WHILE;
+    task.index = 0U;
+  };
+
+  auto limit = Object{};
+  switch (task.index) {
+    case COUNTED_START: {
+      // the loop runs in the block that declared the counter
+      auto* cell = env->cell(loop.counter);
+      if (!cell || !cell->isInteger()) {
+        fallBack();
+        return;
+      }
+      if (env->hasSnapshot()) {
+        env->preserve(cell);
+      }
+      env->written();
+      task.cell = cell;
+      task.counter = cell->integer();
+      task.index = COUNTED_CHECK;
+      return;
+    }
+    case COUNTED_NEXT:
+      // back from the body
+      if (task.counter > Object::max_integer - loop.step) {
+        // beyond exact integers, continue with doubles
+        *task.cell = Object::fromInteger(task.counter);
+        fallBack();
+        enter(stmt.increment());
+        return;
+      }
+      task.counter += loop.step;
+      [[fallthrough]];
+    case COUNTED_CHECK:
+      if (stmt.bound().stepped()) {
+        task.index = COUNTED_BOUND;
+        enter(stmt.bound());
+        return;
+      }
+      limit = evaluate(stmt.bound());
+      break;
+    case COUNTED_BOUND:
+      limit = pop();
+      break;
+  }
+
+  auto counter = task.counter;
+  if (!limit.isNumber()) {
+    // the regular loop reports the error
+    *task.cell = Object::fromInteger(counter);
+    fallBack();
+    return;
+  }
+
+  auto more = limit.isInteger() ? (loop.inclusive ? counter <= limit.integer()
+                                                  : counter < limit.integer())
+                                : (loop.inclusive ? counter <= limit.number()
+                                                  : counter < limit.number());
+  if (!more) {
+    *task.cell = Object::fromInteger(counter);
+    tasks.pop_back();
+    return;
+  }
+
+  _budget.tick();
+
+  // nothing but the body can see the counter
+  if (loop.body_reads_counter) {
+    *task.cell = Object::fromInteger(counter);
+  }
+  task.index = COUNTED_NEXT;
+  enterLoopBody(stmt.loopBody(), task.env);
+}
+
+void
+Interpreter::callOperands(std::size_t count)
+{
+  auto slot = operands.size() - count - 1UL;
+  auto const& callable = checkCall(operands[slot], count);
+
+  if (auto const* fn = callable.function()) {
+    startCall(*fn, Arguments{ operands.data() + slot + 1UL, count }, slot);
+    return;
+  }
+
+  // natives may call back into Lox, pushing operands, so their
+  // arguments move to slots that stay where they are
+  auto args = arg_stack.push(count);
+  for (auto i = 0UL; i < count; ++i) {
+    args[i] = std::move(operands[slot + 1UL + i]);
+  }
+  operands.resize(slot + 1UL);
+  auto res = callNative(callable, args.arguments());
+  operands[slot] = std::move(res);
+}
+
+void
+Interpreter::startCall(LoxFunction const& fn, Arguments args, std::size_t slot)
+{
+  pushFrame(fn);
+
+  auto key = std::optional<std::string>{};
+  if (auto res = fn.shortcut(*this, args, key)) {
+    popFrame();
+    operands.resize(slot + 1UL);
+    operands[slot] = std::move(*res);
+    return;
+  }
+
+  enterBody(fn, fn.bind(*this, args), slot, std::move(key));
+}
+
+void
+Interpreter::enterBody(LoxFunction const& fn,
+                       SharedEnv callee_env,
+                       std::size_t slot,
+                       std::optional<std::string> key)
+{
+  // the callee stays in its slot, it keeps the body alive
+  operands.resize(slot + 1UL);
+
+  auto& frame = frames.back();
+  frame.slot = slot;
+  frame.tasks = tasks.size();
+  frame.env = std::exchange(env, std::move(callee_env));
+  frame.code_owner = std::exchange(code_owner, &fn.owner);
+  frame.key = std::move(key);
+
+  tasks.push_back(Task{ Task::Op::BODY, 0U, &fn.declaration->body() });
+}
+
+void
+Interpreter::leave(Object result)
+{
+  auto& frame = frames.back();
+  tasks.erase(tasks.begin() + static_cast<std::ptrdiff_t>(frame.tasks),
+              tasks.end());
+  env = std::move(frame.env);
+  code_owner = frame.code_owner;
+  if (frame.key) {
+    static_cast<LoxFunction const*>(frame.callee)
+      ->memoize(*this, std::move(*frame.key), result);
+  }
+
+  operands.resize(frame.slot + 1UL);
+  operands[frame.slot] = std::move(result);
+  frames.pop_back();
+}
+
+Object
+Interpreter::callFunction(LoxFunction const& fn,
+                          Arguments args,
+                          Object callee)
+{
+  auto mark = this->mark();
+  operands.push_back(std::move(callee));
+  try {
+    startCall(fn, args, mark.operands);
+    run(mark);
+  } catch (...) {
+    unwind(mark);
+    throw;
+  }
+  return pop();
+}
+
+Object
+Interpreter::interpretBody(LoxFunction const& fn, Arguments args)
+{
+  // args may be operands, bound before any are pushed
+  auto callee_env = fn.bind(*this, args);
+
+  auto mark = this->mark();
+  operands.emplace_back();
+  try {
+    pushFrame(fn);
+    enterBody(fn, std::move(callee_env), mark.operands, std::nullopt);
+    run(mark);
+  } catch (...) {
+    unwind(mark);
+    throw;
+  }
+  return pop();
+}
+
+Object
+Interpreter::callNative(Callable const& callable, Arguments args)
+{
+  /**
+   * Natives calling back into Lox, like iterating over a generator,
+   * are the only calls that recurse natively.
+   * */
+  if (nativeStackLeft() == 0UL) {
+    throw LoxRuntimeError{ callable.toString(), "Stack overflow." };
+  }
+
+  pushFrame(callable);
+  try {
+    auto res = callable.call(*this, args);
+    popFrame();
+    return res;
+  } catch (...) {
+    popFrame();
+    throw;
+  }
+}
+
+Callable const&
+Interpreter::checkCall(Object const& callee, std::size_t count)
+{
+  if (!callee.isCallable()) {
+    throw LoxRuntimeError{ stringify(callee),
+                           "Can only call functions and classes." };
+  }
+
+  auto const& callable = callee.callable();
+  if (callable.arity() != Callable::variadic && count != callable.arity()) {
+    throw LoxRuntimeError{ callable.toString(),
+                           "Expected " + std::to_string(callable.arity()) +
+                             " arguments but got " + std::to_string(count) +
+                             "." };
+  }
+  return callable;
+}
+
+std::any
+Interpreter::produce(Object value)
+{
+  evaluated = std::move(value);
+  return {};
 }
 
 bool
@@ -257,12 +1380,21 @@ Interpreter::stringify(Object const& obj)
 {
   if (obj.isNull())
     return "nil";
-  else if (obj.isNumber()) {
+  else if (obj.isInteger()) {
+    // same as std::to_string(double) would print, without the printf
+    auto buf = std::array<char, 32>{};
+    auto res = std::to_chars(buf.data(), buf.data() + buf.size(), obj.integer());
+    auto str = std::string(buf.data(), res.ptr);
+    str += ".000000";
+    return str;
+  } else if (obj.isNumber()) {
     return std::to_string(obj.number());
   } else if (obj.isBoolean()) {
     return obj.boolean() == true ? "true" : "false";
   } else if (obj.isCallable()) {
     return obj.callable().toString();
+  } else if (obj.isNative()) {
+    return obj.native().toString();
   } else {
     // string assumed
     return obj.string();
@@ -283,8 +1415,12 @@ Interpreter::isEqual(Object const& lhs, Object const& rhs)
       return true;
     else if (lhs.isBoolean()) {
       return lhs.boolean() == rhs.boolean();
+    } else if (lhs.isInteger() && rhs.isInteger()) {
+      return lhs.integer() == rhs.integer();
     } else if (lhs.isNumber()) {
       return lhs.number() == rhs.number();
+    } else if (lhs.isNative()) {
+      return &lhs.native() == &rhs.native();
     } else {
       // string assumed
       return lhs.string() == rhs.string();
@@ -292,6 +1428,44 @@ Interpreter::isEqual(Object const& lhs, Object const& rhs)
   }
 }
 
+std::optional<Object>
+Interpreter::integerArithmetic(TokenType op, std::int64_t lhs, std::int64_t rhs)
+{
+  /**
+   * Both operands are within +-2^53, so sums and differences can't
+   * overflow and are rounded exactly like the doubles would be.
+   * */
+  switch (op) {
+    case TokenType::PLUS:
+      return Object::fromInteger(lhs + rhs);
+    case TokenType::MINUS:
+      return Object::fromInteger(lhs - rhs);
+    case TokenType::STAR: {
+      auto res = std::int64_t{};
+      if (__builtin_mul_overflow(lhs, rhs, &res) || !Object::fitsInteger(res) ||
+          (res == 0 && (lhs < 0 || rhs < 0))) {
+        // too large or -0, leave it to double arithmetic
+        return std::nullopt;
+      }
+      return Object::fromInteger(res);
+    }
+    case TokenType::GREATER:
+      return Object{ lhs > rhs };
+    case TokenType::GREATER_EQUAL:
+      return Object{ lhs >= rhs };
+    case TokenType::LESS:
+      return Object{ lhs < rhs };
+    case TokenType::LESS_EQUAL:
+      return Object{ lhs <= rhs };
+    case TokenType::EQUAL_EQUAL:
+      return Object{ lhs == rhs };
+    case TokenType::BANG_EQUAL:
+      return Object{ lhs != rhs };
+    default:
+      return std::nullopt;
+  }
+}
+
 void
 Interpreter::checkNumberOperand(Token const& op, Object const& operand)
 {
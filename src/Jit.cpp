@@ -0,0 +1,826 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <Callable.hpp>
+#include <Jit.hpp>
+#include <NativeStack.hpp>
+
+namespace Lox {
+
+namespace {
+
+constexpr size_t max_params = 8UL;
+
+/**
+ * Shared with the generated code, which addresses the
+ * fields at fixed offsets.
+ * */
+struct NativeContext
+{
+  // calls left before the interpreter would overflow
+  std::int64_t depth_budget;
+  std::int64_t bailed;
+};
+
+static_assert(offsetof(NativeContext, bailed) == 8UL);
+
+using NativeEntry = double (*)(NativeContext*,
+                               double,
+                               double,
+                               double,
+                               double,
+                               double,
+                               double,
+                               double,
+                               double);
+
+struct Unsupported
+{
+  std::string reason;
+};
+
+enum Condition : unsigned char
+{
+  BELOW = 0x2,
+  ABOVE_EQUAL = 0x3,
+  EQUAL = 0x4,
+  NOT_EQUAL = 0x5,
+  BELOW_EQUAL = 0x6,
+  ABOVE = 0x7,
+  SIGN = 0x8,
+  PARITY = 0xA
+};
+
+class Assembler
+{
+public:
+  using Label = size_t;
+
+  Label label()
+  {
+    labels.push_back(npos);
+    return labels.size() - 1UL;
+  }
+
+  void bind(Label l) { labels.at(l) = code.size(); }
+
+  void jmp(Label l)
+  {
+    bytes({ 0xE9 });
+    rel32(l);
+  }
+
+  void jcc(Condition cc, Label l)
+  {
+    bytes({ 0x0F, static_cast<unsigned char>(0x80 | cc) });
+    rel32(l);
+  }
+
+  void call(Label l)
+  {
+    bytes({ 0xE8 });
+    rel32(l);
+  }
+
+  void bytes(std::initializer_list<unsigned char> bs)
+  {
+    code.insert(code.end(), bs);
+  }
+
+  void imm32(std::int32_t v) { raw(&v, sizeof(v)); }
+  void imm64(std::uint64_t v) { raw(&v, sizeof(v)); }
+
+  // movsd xmm, [rbp + disp]
+  void loadFrame(int xmm, std::int32_t disp)
+  {
+    bytes({ 0xF2, 0x0F, 0x10, static_cast<unsigned char>(0x85 | xmm << 3) });
+    imm32(disp);
+  }
+
+  // movsd [rbp + disp], xmm
+  void storeFrame(std::int32_t disp, int xmm)
+  {
+    bytes({ 0xF2, 0x0F, 0x11, static_cast<unsigned char>(0x85 | xmm << 3) });
+    imm32(disp);
+  }
+
+  // movsd xmm, [rsp + disp]
+  void loadStack(int xmm, std::int32_t disp)
+  {
+    bytes(
+      { 0xF2, 0x0F, 0x10, static_cast<unsigned char>(0x84 | xmm << 3), 0x24 });
+    imm32(disp);
+  }
+
+  // movsd [rsp + disp], xmm
+  void storeStack(std::int32_t disp, int xmm)
+  {
+    bytes(
+      { 0xF2, 0x0F, 0x11, static_cast<unsigned char>(0x84 | xmm << 3), 0x24 });
+    imm32(disp);
+  }
+
+  // mov rax, bits; movq xmm, rax
+  void loadConstant(int xmm, double value)
+  {
+    auto bits = std::uint64_t{};
+    std::memcpy(&bits, &value, sizeof(bits));
+    bytes({ 0x48, 0xB8 });
+    imm64(bits);
+    bytes({ 0x66, 0x48, 0x0F, 0x6E, static_cast<unsigned char>(0xC0 | xmm << 3) });
+  }
+
+  void subRsp(std::int32_t v)
+  {
+    bytes({ 0x48, 0x81, 0xEC });
+    imm32(v);
+  }
+
+  void addRsp(std::int32_t v)
+  {
+    bytes({ 0x48, 0x81, 0xC4 });
+    imm32(v);
+  }
+
+  // mov rdi, [rbp - 8]
+  void loadContext() { bytes({ 0x48, 0x8B, 0x7D, 0xF8 }); }
+
+  /**
+   * Resolves jumps to labels. Returns the finished code.
+   * */
+  std::vector<unsigned char> finish()
+  {
+    for (auto [at, l] : fixups) {
+      auto target = static_cast<std::int64_t>(labels.at(l));
+      auto rel = static_cast<std::int32_t>(target - (at + 4L));
+      std::memcpy(code.data() + at, &rel, sizeof(rel));
+    }
+    return code;
+  }
+
+private:
+  void raw(void const* data, size_t sz)
+  {
+    auto const* b = static_cast<unsigned char const*>(data);
+    code.insert(code.end(), b, b + sz);
+  }
+
+  void rel32(Label l)
+  {
+    fixups.emplace_back(static_cast<std::int64_t>(code.size()), l);
+    imm32(0);
+  }
+
+private:
+  static constexpr size_t npos = ~0UL;
+
+  std::vector<unsigned char> code;
+  std::vector<size_t> labels;
+  std::vector<std::pair<std::int64_t, Label>> fixups;
+};
+
+/**
+ * Template compiler: every expression leaves its value in xmm0,
+ * intermediate values live on the machine stack.
+ *
+ * Frame layout:
+ *   [rbp - 8]           NativeContext*
+ *   [rbp - 16 - 8 * i]  parameter i
+ * */
+class Codegen
+  : public ExpressionVisitor
+  , public StatementVisitor
+{
+public:
+  std::vector<unsigned char> compile()
+  {
+    auto const& params = fn.params();
+    if (params.size() > max_params) {
+      throw Unsupported{ "more than 8 parameters" };
+    }
+    if (!alwaysReturns(fn.body())) {
+      throw Unsupported{ "may finish without return" };
+    }
+
+    entry = as.label();
+    ret = as.label();
+    unwind = as.label();
+    bail = as.label();
+
+    as.bind(entry);
+    // push rbp; mov rbp, rsp; push rdi
+    as.bytes({ 0x55, 0x48, 0x89, 0xE5, 0x57 });
+
+    // keep rsp 16-byte aligned once the parameters are spilled
+    auto frame = 8L * params.size();
+    if ((frame + 8L) % 16L != 0L) {
+      frame += 8L;
+    }
+    if (frame > 0) {
+      as.subRsp(static_cast<std::int32_t>(frame));
+    }
+    // return address, rbp and rdi
+    frame_bytes = 24UL + static_cast<size_t>(frame);
+    for (auto i = 0UL; i < params.size(); ++i) {
+      as.storeFrame(slot(i), static_cast<int>(i));
+    }
+
+    // dec qword [rdi]; js bail
+    as.bytes({ 0x48, 0xFF, 0x0F });
+    as.jcc(SIGN, bail);
+
+    for (auto& stmt : fn.body()) {
+      stmt->accept(*this);
+    }
+
+    as.bind(ret);
+    as.loadContext();
+    // inc qword [rdi]
+    as.bytes({ 0x48, 0xFF, 0x07 });
+
+    as.bind(unwind);
+    // mov rsp, rbp; pop rbp; ret
+    as.bytes({ 0x48, 0x89, 0xEC, 0x5D, 0xC3 });
+
+    as.bind(bail);
+    as.loadContext();
+    // mov qword [rdi + 8], 1
+    as.bytes({ 0x48, 0xC7, 0x47, 0x08, 0x01, 0x00, 0x00, 0x00 });
+    as.jmp(unwind);
+
+    return as.finish();
+  }
+
+  VariableExpression const* selfCall() const noexcept { return self_call; }
+
+  /**
+   * Native stack a call uses at most, known once compiled.
+   * */
+  size_t frameBytes() const noexcept
+  {
+    // one more for the padding of calls
+    return frame_bytes + 8UL * (max_temps + 1UL);
+  }
+
+  virtual void visitBlockStatement(BlockStatement const& stmt) override
+  {
+    for (auto& inner : stmt.statements()) {
+      inner->accept(*this);
+    }
+  }
+
+  virtual void visitExpressionStatement(ExpressionStatement const&) override
+  {
+    throw Unsupported{ "expression statement" };
+  }
+
+  virtual void visitPrintStatement(PrintStatement const&) override
+  {
+    throw Unsupported{ "print statement" };
+  }
+
+  virtual void visitVarDeclarationStatement(
+    VarDeclarationStatement const&) override
+  {
+    throw Unsupported{ "variable declaration" };
+  }
+
+  virtual void visitIfStatement(IfStatement const& stmt) override
+  {
+    auto otherwise = as.label();
+    auto end = as.label();
+
+    branch(stmt.condition(), false, otherwise);
+    stmt.thenBranch().accept(*this);
+    as.jmp(end);
+
+    as.bind(otherwise);
+    if (stmt.hasElseBranch()) {
+      stmt.elseBranch().accept(*this);
+    }
+    as.bind(end);
+  }
+
+  virtual void visitWhileStatement(WhileStatement const&) override
+  {
+    throw Unsupported{ "while loop" };
+  }
+
+  virtual void visitFunctionDeclarationStatement(
+    FunctionDeclarationStatement const&) override
+  {
+    throw Unsupported{ "nested function" };
+  }
+
+  virtual void visitReturnStatement(ReturnStatement const& stmt) override
+  {
+    value(stmt.value());
+    as.jmp(ret);
+  }
+
+  virtual void visitYieldStatement(YieldStatement const&) override
+  {
+    throw Unsupported{ "yield" };
+  }
+
+  virtual std::any visitAssignmentExpression(
+    AssignmentExpression const&) override
+  {
+    throw Unsupported{ "assignment" };
+  }
+
+  virtual std::any visitBinaryExpression(BinaryExpression const& expr) override
+  {
+    switch (expr.op().type()) {
+      case TokenType::PLUS:
+        operands(expr);
+        as.bytes({ 0xF2, 0x0F, 0x58, 0xC1 });
+        break;
+      case TokenType::MINUS:
+        operands(expr);
+        as.bytes({ 0xF2, 0x0F, 0x5C, 0xC1 });
+        break;
+      case TokenType::STAR:
+        operands(expr);
+        as.bytes({ 0xF2, 0x0F, 0x59, 0xC1 });
+        break;
+      case TokenType::SLASH:
+        operands(expr);
+        as.bytes({ 0xF2, 0x0F, 0x5E, 0xC1 });
+        break;
+      default:
+        throw Unsupported{ "'" + expr.op().lexeme() + "' as a value" };
+    }
+    return {};
+  }
+
+  virtual std::any visitGroupingExpression(
+    GroupingExpression const& expr) override
+  {
+    value(expr.expr());
+    return {};
+  }
+
+  virtual std::any visitLiteralExpression(
+    LiteralExpression const& expr) override
+  {
+    if (!expr.value().isNumber()) {
+      throw Unsupported{ "non-number literal" };
+    }
+    as.loadConstant(0, expr.value().number());
+    return {};
+  }
+
+  virtual std::any visitVariableExpression(
+    VariableExpression const& expr) override
+  {
+    as.loadFrame(0, slot(param(expr)));
+    return {};
+  }
+
+  virtual std::any visitUnaryExpression(UnaryExpression const& expr) override
+  {
+    if (expr.op().type() != TokenType::MINUS) {
+      throw Unsupported{ "'" + expr.op().lexeme() + "' as a value" };
+    }
+
+    value(expr.rhs());
+    // flip the sign bit: xorpd xmm0, xmm1
+    as.loadConstant(1, -0.0);
+    as.bytes({ 0x66, 0x0F, 0x57, 0xC1 });
+    return {};
+  }
+
+  virtual std::any visitCallExpression(CallExpression const& expr) override
+  {
+    auto const* callee =
+      dynamic_cast<VariableExpression const*>(&expr.callee());
+    if (!callee || !callee->site().global ||
+        callee->name().lexeme() != fn.name().lexeme()) {
+      throw Unsupported{ "calls other than to itself" };
+    }
+    auto const& args = expr.arguments();
+    if (args.size() != fn.params().size()) {
+      throw Unsupported{ "call with wrong number of arguments" };
+    }
+    self_call = callee;
+
+    for (auto& arg : args) {
+      value(*arg);
+      push();
+    }
+    for (auto i = 0UL; i < args.size(); ++i) {
+      as.loadStack(static_cast<int>(i),
+                   static_cast<std::int32_t>(8UL * (args.size() - 1UL - i)));
+    }
+    if (!args.empty()) {
+      as.addRsp(static_cast<std::int32_t>(8UL * args.size()));
+      temps -= args.size();
+    }
+
+    auto pad = temps % 2UL == 1UL;
+    if (pad) {
+      as.subRsp(8);
+    }
+    as.loadContext();
+    as.call(entry);
+    if (pad) {
+      as.addRsp(8);
+    }
+
+    // the callee ran out of depth: cmp qword [rdi + 8], 0; jne unwind
+    as.loadContext();
+    as.bytes({ 0x48, 0x83, 0x7F, 0x08, 0x00 });
+    as.jcc(NOT_EQUAL, unwind);
+    return {};
+  }
+
+  explicit Codegen(FunctionDeclarationStatement const& fn)
+    : fn(fn)
+    , as()
+    , temps(0UL)
+    , max_temps(0UL)
+    , frame_bytes(0UL)
+    , self_call(nullptr)
+  {}
+
+private:
+  void value(Expression const& expr) { expr.accept(*this); }
+
+  /**
+   * Jumps to target if the truthiness of cond equals when.
+   * */
+  void branch(Expression const& cond, bool when, Assembler::Label target)
+  {
+    if (auto* group = dynamic_cast<GroupingExpression const*>(&cond)) {
+      branch(group->expr(), when, target);
+      return;
+    }
+
+    if (auto* unary = dynamic_cast<UnaryExpression const*>(&cond)) {
+      if (unary->op().type() != TokenType::BANG) {
+        throw Unsupported{ "number as condition" };
+      }
+      branch(unary->rhs(), !when, target);
+      return;
+    }
+
+    auto* binary = dynamic_cast<BinaryExpression const*>(&cond);
+    if (!binary) {
+      throw Unsupported{ "condition other than a comparison" };
+    }
+
+    auto op = binary->op().type();
+    if (op == TokenType::AND || op == TokenType::OR) {
+      // short-circuit: the lhs alone decides if it's falsy for 'and'
+      auto decisive = op == TokenType::OR;
+      if (when == decisive) {
+        branch(binary->lhs(), when, target);
+        branch(binary->rhs(), when, target);
+      } else {
+        auto skip = as.label();
+        branch(binary->lhs(), decisive, skip);
+        branch(binary->rhs(), when, target);
+        as.bind(skip);
+      }
+      return;
+    }
+
+    operands(*binary);
+
+    /**
+     * ucomisd sets ZF, PF and CF on unordered (NaN) operands, the
+     * conditions are picked so that every comparison with NaN is false.
+     * 'a < b' is tested as 'b > a', which is false for NaN.
+     * */
+    auto const swapped =
+      std::initializer_list<unsigned char>{ 0x66, 0x0F, 0x2E, 0xC8 };
+    auto const straight =
+      std::initializer_list<unsigned char>{ 0x66, 0x0F, 0x2E, 0xC1 };
+
+    switch (op) {
+      case TokenType::LESS:
+        as.bytes(swapped);
+        as.jcc(when ? ABOVE : BELOW_EQUAL, target);
+        break;
+      case TokenType::LESS_EQUAL:
+        as.bytes(swapped);
+        as.jcc(when ? ABOVE_EQUAL : BELOW, target);
+        break;
+      case TokenType::GREATER:
+        as.bytes(straight);
+        as.jcc(when ? ABOVE : BELOW_EQUAL, target);
+        break;
+      case TokenType::GREATER_EQUAL:
+        as.bytes(straight);
+        as.jcc(when ? ABOVE_EQUAL : BELOW, target);
+        break;
+      case TokenType::EQUAL_EQUAL:
+      case TokenType::BANG_EQUAL: {
+        as.bytes(straight);
+        // equal means ZF set and PF clear
+        if (when == (op == TokenType::EQUAL_EQUAL)) {
+          auto skip = as.label();
+          as.jcc(PARITY, skip);
+          as.jcc(EQUAL, target);
+          as.bind(skip);
+        } else {
+          as.jcc(PARITY, target);
+          as.jcc(NOT_EQUAL, target);
+        }
+        break;
+      }
+      default:
+        throw Unsupported{ "condition other than a comparison" };
+    }
+  }
+
+  /**
+   * Evaluates lhs into xmm0 and rhs into xmm1.
+   * */
+  void operands(BinaryExpression const& expr)
+  {
+    value(expr.lhs());
+
+    if (auto* literal = dynamic_cast<LiteralExpression const*>(&expr.rhs());
+        literal && literal->value().isNumber()) {
+      as.loadConstant(1, literal->value().number());
+    } else if (auto* var =
+                 dynamic_cast<VariableExpression const*>(&expr.rhs())) {
+      as.loadFrame(1, slot(param(*var)));
+    } else {
+      push();
+      value(expr.rhs());
+      // movapd xmm1, xmm0
+      as.bytes({ 0x66, 0x0F, 0x28, 0xC8 });
+      as.loadStack(0, 0);
+      as.addRsp(8);
+      --temps;
+    }
+  }
+
+  void push()
+  {
+    as.subRsp(8);
+    as.storeStack(0, 0);
+    max_temps = std::max(max_temps, ++temps);
+  }
+
+  size_t param(VariableExpression const& expr) const
+  {
+    auto const& params = fn.params();
+    for (auto i = 0UL; i < params.size(); ++i) {
+      if (params.at(i).lexeme() == expr.name().lexeme()) {
+        return i;
+      }
+    }
+    throw Unsupported{ "reads '" + expr.name().lexeme() + "'" };
+  }
+
+  static std::int32_t slot(size_t param)
+  {
+    return static_cast<std::int32_t>(-16L - 8L * static_cast<long>(param));
+  }
+
+  static bool alwaysReturns(std::vector<Stmt> const& statements)
+  {
+    return !statements.empty() && alwaysReturns(*statements.back());
+  }
+
+  static bool alwaysReturns(Statement const& stmt)
+  {
+    if (dynamic_cast<ReturnStatement const*>(&stmt)) {
+      return true;
+    } else if (auto* block = dynamic_cast<BlockStatement const*>(&stmt)) {
+      return alwaysReturns(block->statements());
+    } else if (auto* branch = dynamic_cast<IfStatement const*>(&stmt)) {
+      return branch->hasElseBranch() && alwaysReturns(branch->thenBranch()) &&
+             alwaysReturns(branch->elseBranch());
+    }
+    return false;
+  }
+
+private:
+  FunctionDeclarationStatement const& fn;
+  Assembler as;
+  Assembler::Label entry;
+  Assembler::Label ret;
+  Assembler::Label unwind;
+  Assembler::Label bail;
+  // 8-byte values currently pushed on top of the frame
+  size_t temps;
+  size_t max_temps;
+  size_t frame_bytes;
+  VariableExpression const* self_call;
+};
+
+} // namespace
+
+#pragma region compiled_function
+
+double
+CompiledFunction::operator()(void* context, Arguments args) const
+{
+  double a[max_params] = {};
+  for (auto i = 0UL; i < args.size(); ++i) {
+    a[i] = args[i].number();
+  }
+
+  auto entry = reinterpret_cast<NativeEntry>(mapping);
+  return entry(static_cast<NativeContext*>(context),
+               a[0],
+               a[1],
+               a[2],
+               a[3],
+               a[4],
+               a[5],
+               a[6],
+               a[7]);
+}
+
+CompiledFunction::CompiledFunction(std::vector<unsigned char> const& code,
+                                   VariableExpression const* self_call,
+                                   size_t frame_bytes)
+  : mapping(nullptr)
+  , sz(code.size())
+  , self_call(self_call)
+  , frame_bytes(frame_bytes)
+{
+  auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  auto mapped = (sz + page - 1UL) / page * page;
+
+  auto* mem = mmap(nullptr,
+                   mapped,
+                   PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS,
+                   -1,
+                   0);
+  if (mem == MAP_FAILED) {
+    throw Unsupported{ "no executable memory" };
+  }
+
+  std::memcpy(mem, code.data(), sz);
+  if (mprotect(mem, mapped, PROT_READ | PROT_EXEC) != 0) {
+    munmap(mem, mapped);
+    throw Unsupported{ "no executable memory" };
+  }
+  mapping = mem;
+}
+
+CompiledFunction::~CompiledFunction()
+{
+  auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  munmap(mapping, (sz + page - 1UL) / page * page);
+}
+
+#pragma endregion compiled_function
+
+#pragma region jit
+
+std::optional<Object>
+Jit::call(Interpreter& interpreter, LoxFunction const& fn, Arguments args)
+{
+  /**
+   * Native code below a call that ran out of depth would
+   * run out as well, leave these calls to the interpreter.
+   * */
+  if (suspended || interpreter.callDepth() > bailed_at) {
+    return std::nullopt;
+  }
+  bailed_at = no_bailout;
+
+  auto& profile = fn.jit_profile;
+  if (!profile.attempted && ++profile.calls > options.threshold) {
+    compile(fn);
+  }
+  if (!profile.code) {
+    return std::nullopt;
+  }
+
+  auto& stats = _stats.at(profile.stats_index);
+  if (!options.measure || stats.speedup) {
+    return run(interpreter, fn, args);
+  }
+
+  /**
+   * Side effect free, so the first call can
+   * be repeated in the interpreter for comparison.
+   * */
+  using clock = std::chrono::steady_clock;
+  auto start = clock::now();
+  auto res = run(interpreter, fn, args);
+  auto native = clock::now() - start;
+  if (!res) {
+    return res;
+  }
+
+  suspended = true;
+  start = clock::now();
+  try {
+    fn.interpret(interpreter, args);
+  } catch (...) {
+    suspended = false;
+    throw;
+  }
+  auto interpreted = clock::now() - start;
+  suspended = false;
+
+  stats.speedup = std::chrono::duration<double>(interpreted).count() /
+                  std::chrono::duration<double>(native).count();
+  return res;
+}
+
+bool
+Jit::isSupportedPlatform() noexcept
+{
+#if defined(__x86_64__) && defined(__linux__)
+  return true;
+#else
+  return false;
+#endif
+}
+
+Jit::Jit(JitOptions options)
+  : options(options)
+  , _stats()
+  , suspended(false)
+  , bailed_at(no_bailout)
+{}
+
+void
+Jit::compile(LoxFunction const& fn)
+{
+  auto& profile = fn.jit_profile;
+  auto const& declaration = *fn.declaration;
+
+  profile.attempted = true;
+  profile.stats_index = _stats.size();
+
+  auto& stats = _stats.emplace_back();
+  stats.function = declaration.name().lexeme();
+
+  auto start = std::chrono::steady_clock::now();
+  try {
+    if (!isSupportedPlatform()) {
+      throw Unsupported{ "platform isn't x86-64 Linux" };
+    }
+
+    auto codegen = Codegen{ declaration };
+    auto code = codegen.compile();
+    profile.code = std::make_unique<CompiledFunction>(
+      code, codegen.selfCall(), codegen.frameBytes());
+    stats.code_bytes = code.size();
+  } catch (Unsupported& e) {
+    stats.unsupported = e.reason;
+  }
+  stats.compile_time = std::chrono::steady_clock::now() - start;
+}
+
+std::optional<Object>
+Jit::run(Interpreter& interpreter, LoxFunction const& fn, Arguments args)
+{
+  auto const& code = *fn.jit_profile.code;
+  auto& stats = _stats.at(fn.jit_profile.stats_index);
+
+  // type guards
+  for (auto const& arg : args) {
+    if (!arg.isNumber()) {
+      return std::nullopt;
+    }
+  }
+
+  // recursive calls jump straight to this code, the name has to be ours
+  if (auto const* self = code.selfCall()) {
+    auto const* cell = interpreter.globalCell(self->name(), self->site());
+    if (!cell || !cell->isCallable() || &cell->callable() != &fn) {
+      return std::nullopt;
+    }
+  }
+
+  /**
+   * Calls are frames on the heap in the interpreter, but recurse
+   * natively here, so the native stack may be used up first.
+   * */
+  auto depth = std::min(interpreter.maxCallDepth() - interpreter.callDepth() + 1UL,
+                        nativeStackLeft() / code.frameBytes());
+  auto context = NativeContext{ static_cast<std::int64_t>(depth), 0L };
+  auto res = code(&context, args);
+
+  if (context.bailed) {
+    ++stats.bailouts;
+    bailed_at = interpreter.callDepth();
+    return std::nullopt;
+  }
+
+  ++stats.native_calls;
+  return Object{ res };
+}
+
+#pragma endregion jit
+
+} // namespace Lox
\ No newline at end of file
@@ -0,0 +1,551 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <functional>
+#include <sstream>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <Interpreter.hpp>
+#include <Map.hpp>
+
+namespace Lox {
+
+namespace {
+
+#pragma region hashing
+
+constexpr std::int8_t empty = -128;
+constexpr std::int8_t deleted = -2;
+
+std::uint64_t
+mix(std::uint64_t h) noexcept
+{
+  // splitmix64 finalizer, spreads every input bit over the 7 control bits
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebULL;
+  h ^= h >> 31;
+  return h;
+}
+
+double
+normalized(double num)
+{
+  if (std::isnan(num)) {
+    throw LoxRuntimeError{ "map", "Map keys can't be NaN." };
+  }
+  // -0 == 0 in Lox
+  return num == 0.0 ? 0.0 : num;
+}
+
+std::uint64_t
+hashOf(Object const& key)
+{
+  switch (key.type()) {
+    case ObjectType::NIL:
+      return mix(0x6e696cULL);
+    case ObjectType::BOOLEAN:
+      return mix(key.boolean() ? 0x74ULL : 0x66ULL);
+    case ObjectType::NUMBER:
+      return mix(std::bit_cast<std::uint64_t>(normalized(key.number())));
+    case ObjectType::STRING:
+      return mix(std::hash<std::string_view>{}(key.string()));
+    default:
+      throw LoxRuntimeError{
+        "map", "Map keys must be strings, numbers, booleans or nil."
+      };
+  }
+}
+
+bool
+matches(Map::Value const& lhs, Object const& rhs)
+{
+  switch (rhs.type()) {
+    case ObjectType::NIL:
+      return std::holds_alternative<std::monostate>(lhs);
+    case ObjectType::BOOLEAN:
+      return std::holds_alternative<bool>(lhs) &&
+             std::get<bool>(lhs) == rhs.boolean();
+    case ObjectType::NUMBER:
+      return std::holds_alternative<double>(lhs) &&
+             std::get<double>(lhs) == rhs.number();
+    case ObjectType::STRING:
+      return std::holds_alternative<std::string>(lhs) &&
+             std::get<std::string>(lhs) == rhs.string();
+    default:
+      return false;
+  }
+}
+
+Map::Value
+toKey(Object const& key)
+{
+  if (key.isNumber()) {
+    return normalized(key.number());
+  }
+  return Map::toValue(key);
+}
+
+#pragma endregion
+
+#pragma region groups
+
+/**
+ * Control bytes of the 16 slots probed together, as bit masks
+ * with bit i set for slot i of the group.
+ * */
+class Group
+{
+public:
+  std::uint32_t match(std::int8_t h2) const noexcept
+  {
+#if defined(__SSE2__)
+    return static_cast<std::uint32_t>(
+      _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(h2))));
+#else
+    auto res = 0U;
+    for (auto i = 0U; i < 16U; ++i) {
+      res |= static_cast<std::uint32_t>(bytes[i] == h2) << i;
+    }
+    return res;
+#endif
+  }
+
+  std::uint32_t matchEmpty() const noexcept { return match(empty); }
+
+  /**
+   * Only empty and deleted have the sign bit set.
+   * */
+  std::uint32_t matchFree() const noexcept
+  {
+#if defined(__SSE2__)
+    return static_cast<std::uint32_t>(_mm_movemask_epi8(bytes));
+#else
+    auto res = 0U;
+    for (auto i = 0U; i < 16U; ++i) {
+      res |= static_cast<std::uint32_t>(bytes[i] < 0) << i;
+    }
+    return res;
+#endif
+  }
+
+  explicit Group(std::int8_t const* control) noexcept
+#if defined(__SSE2__)
+    : bytes(_mm_loadu_si128(reinterpret_cast<__m128i const*>(control)))
+#endif
+  {
+#if !defined(__SSE2__)
+    std::copy(control, control + 16, bytes.begin());
+#endif
+  }
+
+private:
+#if defined(__SSE2__)
+  __m128i bytes;
+#else
+  std::array<std::int8_t, 16> bytes;
+#endif
+};
+
+/**
+ * Groups visited for a hash, triangular steps reach every
+ * group of a power-of-two sized table.
+ * */
+class ProbeSequence
+{
+public:
+  std::size_t offset() const noexcept { return group * 16UL; }
+
+  void next() noexcept
+  {
+    ++step;
+    group = (group + step) & mask;
+  }
+
+  ProbeSequence(std::uint64_t hash, std::size_t slots) noexcept
+    : mask(slots / 16UL - 1UL)
+    , group((hash >> 7) & mask)
+    , step(0UL)
+  {}
+
+private:
+  std::size_t mask;
+  std::size_t group;
+  std::size_t step;
+};
+
+std::int8_t
+h2(std::uint64_t hash) noexcept
+{
+  return static_cast<std::int8_t>(hash & 0x7fU);
+}
+
+#pragma endregion
+
+} // namespace
+
+std::optional<Object>
+Map::get(Object const& key) const
+{
+  auto res = find(key);
+  if (!res.found) {
+    return std::nullopt;
+  }
+  return toObject(entries[slots[res.slot]].value);
+}
+
+bool
+Map::contains(Object const& key) const
+{
+  return find(key).found;
+}
+
+void
+Map::set(Object const& key, Object value)
+{
+  auto hash = hashOf(key);
+  write();
+  if (!control.empty()) {
+    auto res = probe(key, hash);
+    if (res.found) {
+      entries[slots[res.slot]].value = toValue(value);
+      return;
+    }
+  }
+
+  auto capacity = control.size();
+  if ((entries.size() + tombstones + 1UL) * 8UL > capacity * 7UL) {
+    // plenty of tombstones, cleaning them up makes enough room
+    auto grow = (entries.size() + 1UL) * 16UL > capacity * 7UL;
+    rehash(capacity == 0UL ? group_size : grow ? capacity * 2UL : capacity);
+  }
+
+  auto slot = probe(key, hash).slot;
+  if (control[slot] == deleted) {
+    --tombstones;
+  }
+  control[slot] = h2(hash);
+  slots[slot] = static_cast<std::uint32_t>(entries.size());
+  entries.push_back(Entry{ hash, toKey(key), toValue(value) });
+  ++_generation;
+}
+
+bool
+Map::erase(Object const& key)
+{
+  auto hash = hashOf(key);
+  if (entries.empty()) {
+    return false;
+  }
+  auto res = probe(key, hash);
+  if (!res.found) {
+    return false;
+  }
+  write();
+
+  /**
+   * Lookups only probe past a group that was full. If this group has
+   * an empty slot no lookup depends on the erased one, otherwise it
+   * has to stay a tombstone.
+   * */
+  auto group = Group{ control.data() + res.slot / group_size * group_size };
+  if (group.matchEmpty()) {
+    control[res.slot] = empty;
+  } else {
+    control[res.slot] = deleted;
+    ++tombstones;
+  }
+
+  auto index = slots[res.slot];
+  auto last = entries.size() - 1UL;
+  if (index != last) {
+    slots[slotOf(last, entries[last].hash)] = index;
+    entries[index] = std::move(entries[last]);
+  }
+  entries.pop_back();
+  ++_generation;
+  return true;
+}
+
+std::size_t
+Map::bytes() const noexcept
+{
+  return control.capacity() * sizeof(std::int8_t) +
+         slots.capacity() * sizeof(std::uint32_t) +
+         entries.capacity() * sizeof(Entry);
+}
+
+std::string
+Map::toString() const
+{
+  constexpr auto shown = 16UL;
+  // a map may contain itself
+  thread_local auto printing = std::vector<Map const*>{};
+  if (std::find(printing.begin(), printing.end(), this) != printing.end()) {
+    return "{...}";
+  }
+  printing.push_back(this);
+
+  auto str = std::ostringstream{};
+  str << "{";
+  for (auto i = 0UL; i < entries.size() && i < shown; ++i) {
+    str << (i > 0UL ? ", " : "")
+        << Interpreter::stringify(toObject(entries[i].key)) << ": "
+        << Interpreter::stringify(toObject(entries[i].value));
+  }
+  if (entries.size() > shown) {
+    str << ", ... (" << entries.size() << " entries)";
+  }
+  str << "}";
+
+  printing.pop_back();
+  return str.str();
+}
+
+std::unique_ptr<NativeObject>
+Map::clone() const
+{
+  auto res = std::make_unique<Map>();
+  res->control = control;
+  res->slots = slots;
+  res->entries = entries;
+  res->tombstones = tombstones;
+  return res;
+}
+
+void
+Map::restore(NativeObject& saved)
+{
+  auto& from = static_cast<Map&>(saved);
+  control = std::move(from.control);
+  slots = std::move(from.slots);
+  entries = std::move(from.entries);
+  tombstones = from.tombstones;
+  // iterations started before see the change
+  ++_generation;
+}
+
+void
+Map::forEachNative(
+  std::function<void(std::shared_ptr<NativeObject> const&)> const& fn) const
+{
+  for (auto const& entry : entries) {
+    if (auto const* native =
+          std::get_if<std::shared_ptr<NativeObject>>(&entry.value)) {
+      fn(*native);
+    }
+  }
+}
+
+Object
+Map::toObject(Value const& value)
+{
+  switch (value.index()) {
+    case 1:
+      return Object{ std::get<bool>(value) };
+    case 2:
+      return Object{ std::get<double>(value) };
+    case 3:
+      return Object::fromInteger(std::get<std::int64_t>(value));
+    case 4:
+      return Object{ std::get<std::string>(value) };
+    case 5:
+      return Object{ std::get<std::shared_ptr<Callable>>(value) };
+    case 6:
+      return Object{ std::get<std::shared_ptr<NativeObject>>(value) };
+    default:
+      return Object::null();
+  }
+}
+
+Map::Value
+Map::toValue(Object const& obj)
+{
+  switch (obj.type()) {
+    case ObjectType::BOOLEAN:
+      return obj.boolean();
+    case ObjectType::NUMBER:
+      if (obj.isInteger()) {
+        return obj.integer();
+      }
+      return obj.number();
+    case ObjectType::STRING:
+      return obj.string();
+    case ObjectType::CALLABLE:
+      return obj.sharedCallable();
+    case ObjectType::NATIVE:
+      return obj.sharedNative();
+    default:
+      return std::monostate{};
+  }
+}
+
+Map::Probe
+Map::find(Object const& key) const
+{
+  auto hash = hashOf(key);
+  if (entries.empty()) {
+    return Probe{ 0UL, false };
+  }
+  return probe(key, hash);
+}
+
+Map::Probe
+Map::probe(Object const& key, std::uint64_t hash) const
+{
+  auto free = control.size();
+  for (auto seq = ProbeSequence{ hash, control.size() };; seq.next()) {
+    auto group = Group{ control.data() + seq.offset() };
+    for (auto bits = group.match(h2(hash)); bits != 0U; bits &= bits - 1U) {
+      auto slot = seq.offset() + std::countr_zero(bits);
+      auto const& entry = entries[slots[slot]];
+      if (entry.hash == hash && matches(entry.key, key)) {
+        return Probe{ slot, true };
+      }
+    }
+    if (free == control.size()) {
+      if (auto bits = group.matchFree()) {
+        free = seq.offset() + std::countr_zero(bits);
+      }
+    }
+    // the load factor guarantees an empty slot somewhere
+    if (group.matchEmpty()) {
+      return Probe{ free, false };
+    }
+  }
+}
+
+void
+Map::rehash(std::size_t capacity)
+{
+  control.assign(capacity, empty);
+  slots.assign(capacity, 0U);
+  tombstones = 0UL;
+  for (auto i = 0UL; i < entries.size(); ++i) {
+    place(i, entries[i].hash);
+  }
+}
+
+void
+Map::place(std::size_t index, std::uint64_t hash)
+{
+  for (auto seq = ProbeSequence{ hash, control.size() };; seq.next()) {
+    if (auto bits = Group{ control.data() + seq.offset() }.matchEmpty()) {
+      auto slot = seq.offset() + std::countr_zero(bits);
+      control[slot] = h2(hash);
+      slots[slot] = static_cast<std::uint32_t>(index);
+      return;
+    }
+  }
+}
+
+std::size_t
+Map::slotOf(std::size_t index, std::uint64_t hash) const
+{
+  for (auto seq = ProbeSequence{ hash, control.size() };; seq.next()) {
+    auto group = Group{ control.data() + seq.offset() };
+    for (auto bits = group.match(h2(hash)); bits != 0U; bits &= bits - 1U) {
+      auto slot = seq.offset() + std::countr_zero(bits);
+      if (slots[slot] == index) {
+        return slot;
+      }
+    }
+  }
+}
+
+namespace {
+
+#pragma region natives
+
+std::shared_ptr<Map>
+newMap()
+{
+  return std::make_shared<Map>();
+}
+
+Object
+mapGet(Map& map, Object const& key)
+{
+  auto value = map.get(key);
+  return value ? std::move(*value) : Object::null();
+}
+
+void
+mapSet(Interpreter& interpreter, Map& map, Object const& key, Object const& value)
+{
+  auto before = map.bytes();
+  map.set(key, value);
+  interpreter.budget().allocate(map.bytes() - before);
+}
+
+bool
+mapHas(Map& map, Object const& key)
+{
+  return map.contains(key);
+}
+
+bool
+mapDelete(Map& map, Object const& key)
+{
+  return map.erase(key);
+}
+
+double
+mapSize(Map& map)
+{
+  return static_cast<double>(map.size());
+}
+
+/**
+ * mapEach(map, fn) calls fn(key, value) for every entry.
+ * */
+Object
+mapEach(Interpreter& interpreter, Arguments args)
+{
+  // keeps the map alive even if fn drops the last other reference
+  auto self = args[0];
+  auto* map = self.native<Map>();
+  if (!map) {
+    throw LoxRuntimeError{ "mapEach", "Argument 1 must be a Map." };
+  }
+  if (!args[1].isCallable()) {
+    throw LoxRuntimeError{ "mapEach", "Argument 2 must be a function." };
+  }
+
+  auto generation = map->generation();
+  for (auto i = 0UL; i < map->size(); ++i) {
+    auto const& entry = map->items()[i];
+    auto pair = std::array<Object, 2>{ Map::toObject(entry.key),
+                                       Map::toObject(entry.value) };
+    interpreter.call(args[1], pair);
+    if (map->generation() != generation) {
+      throw LoxRuntimeError{ "mapEach", "Map changed during iteration." };
+    }
+  }
+  return Object::null();
+}
+
+#pragma endregion
+
+} // namespace
+
+NativeModule
+mapModule()
+{
+  auto module = NativeModule{ "map" };
+  module.function<&newMap>("Map")
+    .function<&mapGet>("mapGet")
+    .function<&mapSet>("mapSet")
+    .function<&mapHas>("mapHas")
+    .function<&mapDelete>("mapDelete")
+    .function<&mapSize>("mapSize")
+    .function("mapEach", &mapEach, 2UL);
+  return module;
+}
+
+} // namespace Lox
\ No newline at end of file
@@ -0,0 +1,214 @@
+#include <algorithm>
+
+#include <Memoizer.hpp>
+#include <Statement.hpp>
+
+namespace Lox {
+
+namespace {
+
+// rough per-entry overhead of an unordered_map node and its bucket
+constexpr size_t node_overhead = 64UL;
+
+// rough size of a table without results, its map node and empty map
+constexpr size_t table_overhead = 256UL;
+
+void
+appendBytes(std::string& key, void const* data, size_t sz)
+{
+  key.append(static_cast<char const*>(data), sz);
+}
+
+} // namespace
+
+bool
+Memoizer::makeKey(Arguments args, std::string& key)
+{
+  for (auto const& arg : args) {
+    if (arg.isNumber()) {
+      auto num = arg.number();
+      key += 'n';
+      appendBytes(key, &num, sizeof(num));
+    } else if (arg.isString()) {
+      auto sz = arg.string().size();
+      key += 's';
+      appendBytes(key, &sz, sizeof(sz));
+      key += arg.string();
+    } else if (arg.isBoolean()) {
+      key += arg.boolean() ? 't' : 'f';
+    } else if (arg.type() == ObjectType::NIL) {
+      key += '0';
+    } else {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool
+Memoizer::isMemoizable(Object const& obj) noexcept
+{
+  // native values are mutable
+  return obj.type() != ObjectType::CALLABLE &&
+         obj.type() != ObjectType::NATIVE;
+}
+
+Object const*
+Memoizer::lookup(Declaration const& fn, std::string const& key)
+{
+  auto& t = table(fn);
+  auto it = t.results.find(key);
+  if (it == t.results.end()) {
+    ++t.stats->misses;
+    return nullptr;
+  }
+
+  ++t.stats->hits;
+  return &it->second;
+}
+
+void
+Memoizer::store(Declaration const& fn, std::string key, Object const& result)
+{
+  if (!isMemoizable(result)) {
+    return;
+  }
+
+  auto& t = table(fn);
+  auto sz = entryBytes(key, result);
+
+  if (t.results.size() >= options.max_entries_per_function ||
+      total_bytes + sz > options.max_bytes) {
+    evict(t);
+  }
+  if (total_bytes + sz > options.max_bytes) {
+    return;
+  }
+
+  if (t.results.emplace(std::move(key), result).second) {
+    t.bytes += sz;
+    t.stats->bytes += sz;
+    total_bytes += sz;
+    peak_bytes = std::max(peak_bytes, total_bytes);
+  }
+}
+
+std::vector<MemoStats>
+Memoizer::stats() const
+{
+  auto entries = std::map<std::string, size_t>{};
+  for (auto const& [_, t] : tables) {
+    entries[t.stats->function] += t.results.size();
+  }
+
+  auto res = std::vector<MemoStats>{};
+  for (auto const& [name, s] : statistics) {
+    res.push_back(s);
+    res.back().entries = entries[name];
+  }
+  return res;
+}
+
+void
+Memoizer::invalidate(std::string const& name) noexcept
+{
+  for (auto& [_, t] : tables) {
+    auto const& dependencies = t.fn->dependsOn();
+    if (std::binary_search(dependencies.begin(), dependencies.end(), name)) {
+      drop(t);
+    }
+  }
+}
+
+Memoizer::Memoizer(MemoOptions options)
+  : options(options)
+  , tables()
+  , statistics()
+  , total_bytes(0UL)
+  , peak_bytes(0UL)
+{}
+
+void
+Memoizer::clear() noexcept
+{
+  dropTables();
+  statistics.clear();
+  peak_bytes = 0UL;
+}
+
+Memoizer::Table&
+Memoizer::table(Declaration const& fn)
+{
+  auto it = tables.find(fn.get());
+  if (it == tables.end()) {
+    if (total_bytes + table_overhead > options.max_bytes) {
+      dropEmptyTables();
+    }
+    if (total_bytes + table_overhead > options.max_bytes) {
+      dropTables();
+    }
+    total_bytes += table_overhead;
+    peak_bytes = std::max(peak_bytes, total_bytes);
+
+    auto const& name = fn->name().lexeme();
+    auto& stats = statistics[name];
+    stats.function = name;
+    it = tables.emplace(fn.get(), Table{ fn, {}, 0UL, &stats }).first;
+  }
+  return it->second;
+}
+
+void
+Memoizer::evict(Table& t)
+{
+  if (t.results.empty()) {
+    return;
+  }
+
+  ++t.stats->evictions;
+  drop(t);
+}
+
+void
+Memoizer::drop(Table& t) noexcept
+{
+  total_bytes -= t.bytes;
+  t.stats->bytes -= t.bytes;
+  t.bytes = 0UL;
+  t.results.clear();
+}
+
+void
+Memoizer::dropTables() noexcept
+{
+  for (auto& [_, t] : tables) {
+    t.stats->bytes -= t.bytes;
+  }
+  tables.clear();
+  total_bytes = 0UL;
+}
+
+void
+Memoizer::dropEmptyTables() noexcept
+{
+  std::erase_if(tables, [&](auto const& entry) {
+    if (!entry.second.results.empty()) {
+      return false;
+    }
+    total_bytes -= table_overhead;
+    return true;
+  });
+}
+
+size_t
+Memoizer::entryBytes(std::string const& key, Object const& result)
+{
+  auto sz = node_overhead + sizeof(std::string) + key.size() + sizeof(Object);
+  if (result.isString()) {
+    sz += result.string().size();
+  }
+  return sz;
+}
+
+} // namespace Lox
\ No newline at end of file
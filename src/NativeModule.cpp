@@ -0,0 +1,80 @@
+#include <map>
+#include <mutex>
+
+#include <NativeModule.hpp>
+
+namespace Lox {
+
+namespace {
+
+struct Registry
+{
+  std::mutex mutex;
+  std::map<std::string, std::shared_ptr<NativeModule const>, std::less<>>
+    modules;
+};
+
+Registry&
+registry()
+{
+  static auto* reg = [] {
+    auto* reg = new Registry{};
+    for (auto& module : standardModules()) {
+      auto name = module.name();
+      reg->modules[name] = std::make_shared<NativeModule>(std::move(module));
+    }
+    return reg;
+  }();
+  return *reg;
+}
+
+} // namespace
+
+NativeModule&
+NativeModule::function(std::string name, NativeFn fn, size_t arity)
+{
+  return insert(std::make_unique<NativeFunction>(std::move(name), fn, arity));
+}
+
+void
+NativeModule::load(Environment& env) const
+{
+  for (auto const& fn : functions) {
+    auto const& native = static_cast<NativeFunction const&>(*fn);
+    env.define(native.name(), Object{ fn });
+  }
+}
+
+NativeModule::NativeModule(std::string name)
+  : _name(std::move(name))
+  , functions()
+{}
+
+void
+NativeModule::add(NativeModule module)
+{
+  auto shared = std::make_shared<NativeModule const>(std::move(module));
+
+  auto& reg = registry();
+  auto lock = std::lock_guard{ reg.mutex };
+  reg.modules[shared->name()] = std::move(shared);
+}
+
+std::shared_ptr<NativeModule const>
+NativeModule::find(std::string_view name)
+{
+  auto& reg = registry();
+  auto lock = std::lock_guard{ reg.mutex };
+
+  auto it = reg.modules.find(name);
+  return it != reg.modules.end() ? it->second : nullptr;
+}
+
+NativeModule&
+NativeModule::insert(std::unique_ptr<NativeFunction> fn)
+{
+  functions.push_back(std::move(fn));
+  return *this;
+}
+
+} // namespace Lox
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include <cstdint>
+
+#include <pthread.h>
+
+#include <NativeStack.hpp>
+
+namespace Lox {
+
+namespace {
+
+constexpr std::size_t safety_margin = 256UL * 1024UL;
+
+/**
+ * Lowest address the calling thread may use for its stack plus the
+ * margin, nullptr if unknown. Looked up once per thread; constant
+ * initialized, so reading it needs no guard on every call.
+ * */
+thread_local char const* stack_limit = nullptr;
+thread_local bool stack_limit_known = false;
+
+char const*
+findStackLimit() noexcept
+{
+  auto attr = pthread_attr_t{};
+  if (pthread_getattr_np(pthread_self(), &attr) != 0) {
+    return nullptr;
+  }
+  void* base = nullptr;
+  auto size = std::size_t{};
+  auto found = pthread_attr_getstack(&attr, &base, &size) == 0;
+  pthread_attr_destroy(&attr);
+
+  if (!found || size <= safety_margin) {
+    return nullptr;
+  }
+  return static_cast<char const*>(base) + safety_margin;
+}
+
+} // namespace
+
+std::size_t
+nativeStackLeft() noexcept
+{
+  if (!stack_limit_known) {
+    stack_limit = findStackLimit();
+    stack_limit_known = true;
+  }
+
+  auto const* limit = stack_limit;
+  auto const* frame = static_cast<char const*>(__builtin_frame_address(0));
+  if (!limit) {
+    // nothing to go by, only the call depth limits
+    return SIZE_MAX;
+  }
+
+  return frame > limit ? static_cast<std::size_t>(frame - limit) : 0UL;
+}
+
+} // namespace Lox
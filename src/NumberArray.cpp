@@ -0,0 +1,560 @@
+#include <algorithm>
+#include <cmath>
+#include <new>
+#include <sstream>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include <Interpreter.hpp>
+#include <NumberArray.hpp>
+
+namespace Lox {
+
+namespace {
+
+#pragma region kernels
+
+struct Kernels
+{
+  char const* name;
+  double (*sum)(double const* v, std::size_t n);
+  double (*dot)(double const* a, double const* b, std::size_t n);
+  void (*scale)(double* v, std::size_t n, double factor);
+  void (*add)(double* a, double const* b, std::size_t n);
+  double (*min)(double const* v, std::size_t n);
+  double (*max)(double const* v, std::size_t n);
+};
+
+double
+sumScalar(double const* v, std::size_t n)
+{
+  auto res = 0.0;
+  for (auto i = 0UL; i < n; ++i) {
+    res += v[i];
+  }
+  return res;
+}
+
+double
+dotScalar(double const* a, double const* b, std::size_t n)
+{
+  auto res = 0.0;
+  for (auto i = 0UL; i < n; ++i) {
+    res += a[i] * b[i];
+  }
+  return res;
+}
+
+void
+scaleScalar(double* v, std::size_t n, double factor)
+{
+  for (auto i = 0UL; i < n; ++i) {
+    v[i] *= factor;
+  }
+}
+
+void
+addScalar(double* a, double const* b, std::size_t n)
+{
+  for (auto i = 0UL; i < n; ++i) {
+    a[i] += b[i];
+  }
+}
+
+double
+minScalar(double const* v, std::size_t n)
+{
+  auto res = v[0];
+  for (auto i = 1UL; i < n; ++i) {
+    res = v[i] < res ? v[i] : res;
+  }
+  return res;
+}
+
+double
+maxScalar(double const* v, std::size_t n)
+{
+  auto res = v[0];
+  for (auto i = 1UL; i < n; ++i) {
+    res = v[i] > res ? v[i] : res;
+  }
+  return res;
+}
+
+#if defined(__x86_64__)
+
+/**
+ * The buffers are 64-byte aligned and the loops step in whole vectors
+ * from the start, so all vector loads and stores are aligned. Two
+ * accumulators hide the latency of the additions.
+ * */
+
+double
+sumSse2(double const* v, std::size_t n)
+{
+  auto acc0 = _mm_setzero_pd();
+  auto acc1 = _mm_setzero_pd();
+  auto i = 0UL;
+  for (; i + 4UL <= n; i += 4UL) {
+    acc0 = _mm_add_pd(acc0, _mm_load_pd(v + i));
+    acc1 = _mm_add_pd(acc1, _mm_load_pd(v + i + 2UL));
+  }
+  acc0 = _mm_add_pd(acc0, acc1);
+  auto res = _mm_cvtsd_f64(acc0) + _mm_cvtsd_f64(_mm_unpackhi_pd(acc0, acc0));
+  return res + sumScalar(v + i, n - i);
+}
+
+double
+dotSse2(double const* a, double const* b, std::size_t n)
+{
+  auto acc0 = _mm_setzero_pd();
+  auto acc1 = _mm_setzero_pd();
+  auto i = 0UL;
+  for (; i + 4UL <= n; i += 4UL) {
+    acc0 =
+      _mm_add_pd(acc0, _mm_mul_pd(_mm_load_pd(a + i), _mm_load_pd(b + i)));
+    acc1 = _mm_add_pd(
+      acc1, _mm_mul_pd(_mm_load_pd(a + i + 2UL), _mm_load_pd(b + i + 2UL)));
+  }
+  acc0 = _mm_add_pd(acc0, acc1);
+  auto res = _mm_cvtsd_f64(acc0) + _mm_cvtsd_f64(_mm_unpackhi_pd(acc0, acc0));
+  return res + dotScalar(a + i, b + i, n - i);
+}
+
+void
+scaleSse2(double* v, std::size_t n, double factor)
+{
+  auto f = _mm_set1_pd(factor);
+  auto i = 0UL;
+  for (; i + 2UL <= n; i += 2UL) {
+    _mm_store_pd(v + i, _mm_mul_pd(_mm_load_pd(v + i), f));
+  }
+  scaleScalar(v + i, n - i, factor);
+}
+
+void
+addSse2(double* a, double const* b, std::size_t n)
+{
+  auto i = 0UL;
+  for (; i + 2UL <= n; i += 2UL) {
+    _mm_store_pd(a + i, _mm_add_pd(_mm_load_pd(a + i), _mm_load_pd(b + i)));
+  }
+  addScalar(a + i, b + i, n - i);
+}
+
+double
+minSse2(double const* v, std::size_t n)
+{
+  if (n < 2UL) {
+    return minScalar(v, n);
+  }
+  auto acc = _mm_load_pd(v);
+  auto i = 2UL;
+  for (; i + 2UL <= n; i += 2UL) {
+    acc = _mm_min_pd(acc, _mm_load_pd(v + i));
+  }
+  auto res = std::min(_mm_cvtsd_f64(acc), _mm_cvtsd_f64(_mm_unpackhi_pd(acc, acc)));
+  return i < n ? std::min(res, minScalar(v + i, n - i)) : res;
+}
+
+double
+maxSse2(double const* v, std::size_t n)
+{
+  if (n < 2UL) {
+    return maxScalar(v, n);
+  }
+  auto acc = _mm_load_pd(v);
+  auto i = 2UL;
+  for (; i + 2UL <= n; i += 2UL) {
+    acc = _mm_max_pd(acc, _mm_load_pd(v + i));
+  }
+  auto res = std::max(_mm_cvtsd_f64(acc), _mm_cvtsd_f64(_mm_unpackhi_pd(acc, acc)));
+  return i < n ? std::max(res, maxScalar(v + i, n - i)) : res;
+}
+
+__attribute__((target("avx2,fma"))) double
+horizontalSum(__m256d v)
+{
+  auto pair = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+  return _mm_cvtsd_f64(pair) + _mm_cvtsd_f64(_mm_unpackhi_pd(pair, pair));
+}
+
+__attribute__((target("avx2,fma"))) double
+sumAvx2(double const* v, std::size_t n)
+{
+  auto acc0 = _mm256_setzero_pd();
+  auto acc1 = _mm256_setzero_pd();
+  auto i = 0UL;
+  for (; i + 8UL <= n; i += 8UL) {
+    acc0 = _mm256_add_pd(acc0, _mm256_load_pd(v + i));
+    acc1 = _mm256_add_pd(acc1, _mm256_load_pd(v + i + 4UL));
+  }
+  return horizontalSum(_mm256_add_pd(acc0, acc1)) + sumScalar(v + i, n - i);
+}
+
+__attribute__((target("avx2,fma"))) double
+dotAvx2(double const* a, double const* b, std::size_t n)
+{
+  auto acc0 = _mm256_setzero_pd();
+  auto acc1 = _mm256_setzero_pd();
+  auto i = 0UL;
+  for (; i + 8UL <= n; i += 8UL) {
+    acc0 = _mm256_fmadd_pd(_mm256_load_pd(a + i), _mm256_load_pd(b + i), acc0);
+    acc1 = _mm256_fmadd_pd(
+      _mm256_load_pd(a + i + 4UL), _mm256_load_pd(b + i + 4UL), acc1);
+  }
+  return horizontalSum(_mm256_add_pd(acc0, acc1)) +
+         dotScalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2,fma"))) void
+scaleAvx2(double* v, std::size_t n, double factor)
+{
+  auto f = _mm256_set1_pd(factor);
+  auto i = 0UL;
+  for (; i + 4UL <= n; i += 4UL) {
+    _mm256_store_pd(v + i, _mm256_mul_pd(_mm256_load_pd(v + i), f));
+  }
+  scaleScalar(v + i, n - i, factor);
+}
+
+__attribute__((target("avx2,fma"))) void
+addAvx2(double* a, double const* b, std::size_t n)
+{
+  auto i = 0UL;
+  for (; i + 4UL <= n; i += 4UL) {
+    _mm256_store_pd(a + i,
+                    _mm256_add_pd(_mm256_load_pd(a + i), _mm256_load_pd(b + i)));
+  }
+  addScalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2,fma"))) double
+minAvx2(double const* v, std::size_t n)
+{
+  if (n < 4UL) {
+    return minScalar(v, n);
+  }
+  auto acc = _mm256_load_pd(v);
+  auto i = 4UL;
+  for (; i + 4UL <= n; i += 4UL) {
+    acc = _mm256_min_pd(acc, _mm256_load_pd(v + i));
+  }
+  alignas(32) double lanes[4];
+  _mm256_store_pd(lanes, acc);
+  auto res = minScalar(lanes, 4UL);
+  return i < n ? std::min(res, minScalar(v + i, n - i)) : res;
+}
+
+__attribute__((target("avx2,fma"))) double
+maxAvx2(double const* v, std::size_t n)
+{
+  if (n < 4UL) {
+    return maxScalar(v, n);
+  }
+  auto acc = _mm256_load_pd(v);
+  auto i = 4UL;
+  for (; i + 4UL <= n; i += 4UL) {
+    acc = _mm256_max_pd(acc, _mm256_load_pd(v + i));
+  }
+  alignas(32) double lanes[4];
+  _mm256_store_pd(lanes, acc);
+  auto res = maxScalar(lanes, 4UL);
+  return i < n ? std::max(res, maxScalar(v + i, n - i)) : res;
+}
+
+#endif
+
+Kernels const&
+activeKernels()
+{
+  static auto const active = []() -> Kernels {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+      return { "avx2", sumAvx2, dotAvx2, scaleAvx2, addAvx2, minAvx2, maxAvx2 };
+    }
+    return { "sse2", sumSse2, dotSse2, scaleSse2, addSse2, minSse2, maxSse2 };
+#else
+    return { "scalar",    sumScalar, dotScalar, scaleScalar,
+             addScalar, minScalar, maxScalar };
+#endif
+  }();
+  return active;
+}
+
+#pragma endregion
+
+#pragma region natives
+
+// 2 GiB of numbers, anything larger is a mistake rather than data
+constexpr auto max_size = 1UL << 28;
+
+std::size_t
+toIndex(double index)
+{
+  if (!(index >= 0.0) || index != std::floor(index)) {
+    throw LoxRuntimeError{ std::to_string(index),
+                           "Index must be a non-negative whole number." };
+  }
+  // no array is this large, and the cast of larger ones is undefined
+  if (index > static_cast<double>(max_size)) {
+    throw LoxRuntimeError{ std::to_string(index), "Index out of range." };
+  }
+  return static_cast<std::size_t>(index);
+}
+
+std::shared_ptr<NumberArray>
+numberArray(Interpreter& interpreter, double size)
+{
+  if (size > static_cast<double>(max_size)) {
+    throw LoxRuntimeError{ std::to_string(size),
+                           "Size must be at most " +
+                             std::to_string(max_size) + "." };
+  }
+  auto count = toIndex(size);
+  interpreter.budget().allocate(count * sizeof(double));
+  try {
+    return std::make_shared<NumberArray>(count);
+  } catch (std::bad_alloc const&) {
+    throw LoxRuntimeError{ std::to_string(size), "Out of memory." };
+  }
+}
+
+double
+arrayGet(NumberArray& array, double index)
+{
+  return array.get(toIndex(index));
+}
+
+void
+arraySet(NumberArray& array, double index, double value)
+{
+  array.set(toIndex(index), value);
+}
+
+double
+arrayLen(NumberArray& array)
+{
+  return static_cast<double>(array.size());
+}
+
+void
+arrayPush(Interpreter& interpreter, NumberArray& array, double value)
+{
+  auto before = array.bytes();
+  array.push(value);
+  interpreter.budget().allocate(array.bytes() - before);
+}
+
+double
+arraySum(NumberArray& array)
+{
+  return array.sum();
+}
+
+double
+arrayDot(NumberArray& lhs, NumberArray& rhs)
+{
+  return lhs.dot(rhs);
+}
+
+void
+arrayScale(NumberArray& array, double factor)
+{
+  array.scale(factor);
+}
+
+void
+arrayAdd(NumberArray& array, NumberArray& other)
+{
+  array.add(other);
+}
+
+Object
+arrayMin(NumberArray& array)
+{
+  auto res = array.min();
+  return res ? Object{ *res } : Object::null();
+}
+
+Object
+arrayMax(NumberArray& array)
+{
+  auto res = array.max();
+  return res ? Object{ *res } : Object::null();
+}
+
+void
+arraySort(NumberArray& array)
+{
+  array.sort();
+}
+
+std::string_view
+arrayKernels()
+{
+  return NumberArray::kernels();
+}
+
+#pragma endregion
+
+} // namespace
+
+double
+NumberArray::get(std::size_t index) const
+{
+  if (index >= values.size()) {
+    throw LoxRuntimeError{ std::to_string(index), "Index out of range." };
+  }
+  return values[index];
+}
+
+void
+NumberArray::set(std::size_t index, double value)
+{
+  if (index >= values.size()) {
+    throw LoxRuntimeError{ std::to_string(index), "Index out of range." };
+  }
+  write();
+  values[index] = value;
+}
+
+void
+NumberArray::push(double value)
+{
+  write();
+  values.push_back(value);
+}
+
+double
+NumberArray::sum() const noexcept
+{
+  return activeKernels().sum(values.data(), values.size());
+}
+
+double
+NumberArray::dot(NumberArray const& other) const
+{
+  checkSize(other);
+  return activeKernels().dot(values.data(), other.values.data(), values.size());
+}
+
+void
+NumberArray::add(NumberArray const& other)
+{
+  checkSize(other);
+  write();
+  activeKernels().add(values.data(), other.values.data(), values.size());
+}
+
+void
+NumberArray::scale(double factor)
+{
+  write();
+  activeKernels().scale(values.data(), values.size(), factor);
+}
+
+std::optional<double>
+NumberArray::min() const noexcept
+{
+  if (values.empty()) {
+    return std::nullopt;
+  }
+  return activeKernels().min(values.data(), values.size());
+}
+
+std::optional<double>
+NumberArray::max() const noexcept
+{
+  if (values.empty()) {
+    return std::nullopt;
+  }
+  return activeKernels().max(values.data(), values.size());
+}
+
+void
+NumberArray::sort()
+{
+  write();
+  // NaN isn't ordered, keep it out of the way of std::sort
+  auto nan = std::partition(
+    values.begin(), values.end(), [](double v) { return !std::isnan(v); });
+  std::sort(values.begin(), nan);
+}
+
+std::string
+NumberArray::toString() const
+{
+  constexpr auto shown = 16UL;
+
+  auto str = std::ostringstream{};
+  str << "[";
+  for (auto i = 0UL; i < values.size() && i < shown; ++i) {
+    str << (i > 0UL ? ", " : "") << std::to_string(values[i]);
+  }
+  if (values.size() > shown) {
+    str << ", ... (" << values.size() << " numbers)";
+  }
+  str << "]";
+  return str.str();
+}
+
+std::unique_ptr<NativeObject>
+NumberArray::clone() const
+{
+  auto res = std::make_unique<NumberArray>();
+  res->values = values;
+  return res;
+}
+
+void
+NumberArray::restore(NativeObject& saved)
+{
+  values = std::move(static_cast<NumberArray&>(saved).values);
+}
+
+NumberArray::NumberArray(std::size_t size)
+  : values(size, 0.0)
+{}
+
+char const*
+NumberArray::kernels() noexcept
+{
+  return activeKernels().name;
+}
+
+void
+NumberArray::checkSize(NumberArray const& other) const
+{
+  if (other.size() != size()) {
+    throw LoxRuntimeError{ "array",
+                           "Arrays differ in size (" +
+                             std::to_string(size()) + " and " +
+                             std::to_string(other.size()) + ")." };
+  }
+}
+
+NativeModule
+numberArrayModule()
+{
+  auto module = NativeModule{ "array" };
+  module.function<&numberArray>("numberArray")
+    .function<&arrayGet>("arrayGet")
+    .function<&arraySet>("arraySet")
+    .function<&arrayLen>("arrayLen")
+    .function<&arrayPush>("arrayPush")
+    .function<&arraySum>("arraySum")
+    .function<&arrayDot>("arrayDot")
+    .function<&arrayScale>("arrayScale")
+    .function<&arrayAdd>("arrayAdd")
+    .function<&arrayMin>("arrayMin")
+    .function<&arrayMax>("arrayMax")
+    .function<&arraySort>("arraySort")
+    .function<&arrayKernels>("arrayKernels");
+  return module;
+}
+
+} // namespace Lox
\ No newline at end of file
@@ -1,8 +1,69 @@
+#include <atomic>
+#include <mutex>
+#include <vector>
+
 #include <Callable.hpp>
+#include <NativeObject.hpp>
 #include <Object.hpp>
 
 namespace Lox {
 
+namespace {
+
+/**
+ * Counted per thread, interpreters running in parallel would
+ * otherwise contend on the cache line of a shared counter. Threads
+ * that live as long as their interpreter, like task pool workers,
+ * never exit while it is queried, so live counters are kept in
+ * a registry and summed with the ones of threads that are gone.
+ * */
+struct CopyCounter;
+
+struct CopyRegistry
+{
+  std::mutex mutex;
+  std::vector<CopyCounter const*> live;
+  std::size_t exited = 0UL;
+};
+
+CopyRegistry&
+copyRegistry()
+{
+  static auto registry = CopyRegistry{};
+  return registry;
+}
+
+struct CopyCounter
+{
+  // only written by its own thread, atomic so others may read it
+  std::atomic<std::size_t> count{ 0UL };
+
+  void increment() noexcept
+  {
+    count.store(count.load(std::memory_order_relaxed) + 1UL,
+                std::memory_order_relaxed);
+  }
+
+  CopyCounter()
+  {
+    auto& registry = copyRegistry();
+    auto lock = std::lock_guard{ registry.mutex };
+    registry.live.push_back(this);
+  }
+
+  ~CopyCounter()
+  {
+    auto& registry = copyRegistry();
+    auto lock = std::lock_guard{ registry.mutex };
+    std::erase(registry.live, this);
+    registry.exited += count.load(std::memory_order_relaxed);
+  }
+};
+
+thread_local auto copy_count = CopyCounter{};
+
+} // namespace
+
 std::string const&
 Object::string() const
 {
@@ -12,7 +73,17 @@ Object::string() const
 double
 Object::number() const
 {
-  return num.value();
+  auto value = num.value();
+  return integral ? static_cast<double>(value.integer) : value.real;
+}
+
+std::int64_t
+Object::integer() const
+{
+  if (!integral) {
+    throw std::bad_optional_access{};
+  }
+  return num->integer;
 }
 
 bool
@@ -27,6 +98,12 @@ Object::callable() const
   return *_callable;
 }
 
+NativeObject&
+Object::native() const
+{
+  return *_native;
+}
+
 bool
 Object::isString() const noexcept
 {
@@ -39,6 +116,12 @@ Object::isNumber() const noexcept
   return num.has_value();
 }
 
+bool
+Object::isInteger() const noexcept
+{
+  return integral;
+}
+
 bool
 Object::isBoolean() const noexcept
 {
@@ -57,6 +140,12 @@ Object::isCallable() const noexcept
   return _callable.operator bool();
 }
 
+bool
+Object::isNative() const noexcept
+{
+  return _native.operator bool();
+}
+
 ObjectType
 Object::type() const noexcept
 {
@@ -65,30 +154,37 @@ Object::type() const noexcept
 
 Object::operator bool() const noexcept
 {
-  return str.has_value() || num.has_value() || _boolean.has_value();
+  return str.has_value() || num.has_value() || _boolean.has_value() ||
+         _callable || _native;
 }
 
 Object::Object()
   : str()
   , num()
   , _boolean()
+  , integral(false)
   , _callable()
+  , _native()
   , _type(ObjectType::NIL)
 {}
 
 Object::Object(std::string str)
-  : str(str)
+  : str(std::move(str))
   , num()
   , _boolean()
+  , integral(false)
   , _callable()
+  , _native()
   , _type(ObjectType::STRING)
 {}
 
 Object::Object(double num)
   : str()
-  , num(num)
+  , num(Number{ .real = num })
   , _boolean()
+  , integral(false)
   , _callable()
+  , _native()
   , _type(ObjectType::NUMBER)
 {}
 
@@ -96,15 +192,29 @@ Object::Object(bool boolean)
   : str()
   , num()
   , _boolean(boolean)
+  , integral(false)
   , _callable()
+  , _native()
   , _type(ObjectType::BOOLEAN)
 {}
 
-Object::Object(std::unique_ptr<Callable> in_callable)
+Object::Object(std::shared_ptr<NativeObject> in_native)
   : str()
   , num()
   , _boolean()
+  , integral(false)
+  , _callable()
+  , _native(std::move(in_native))
+  , _type(ObjectType::NATIVE)
+{}
+
+Object::Object(std::shared_ptr<Callable> in_callable)
+  : str()
+  , num()
+  , _boolean()
+  , integral(false)
   , _callable(std::move(in_callable))
+  , _native()
   , _type(ObjectType::CALLABLE)
 {}
 
@@ -112,14 +222,24 @@ Object::Object(Object const& orig)
   : str(orig.str)
   , num(orig.num)
   , _boolean(orig._boolean)
-  , _callable()
-  , _type()
+  , integral(orig.integral)
+  , _callable(orig._callable)
+  , _native(orig._native)
+  , _type(orig._type)
 {
-  if (orig._callable) {
-    _callable = orig._callable->clone();
-  }
+  copy_count.increment();
 }
 
+Object::Object(Object&& orig) noexcept
+  : str(std::move(orig.str))
+  , num(orig.num)
+  , _boolean(orig._boolean)
+  , integral(orig.integral)
+  , _callable(std::move(orig._callable))
+  , _native(std::move(orig._native))
+  , _type(orig._type)
+{}
+
 Object&
 Object::operator=(Object const& orig)
 {
@@ -127,10 +247,27 @@ Object::operator=(Object const& orig)
     str = orig.str;
     num = orig.num;
     _boolean = orig._boolean;
-    _callable = {};
-    if (orig._callable) {
-      _callable = orig._callable->clone();
-    }
+    integral = orig.integral;
+    _callable = orig._callable;
+    _native = orig._native;
+    _type = orig._type;
+    copy_count.increment();
+  }
+
+  return *this;
+}
+
+Object&
+Object::operator=(Object&& orig) noexcept
+{
+  if (this != &orig) {
+    str = std::move(orig.str);
+    num = orig.num;
+    _boolean = orig._boolean;
+    integral = orig.integral;
+    _callable = std::move(orig._callable);
+    _native = std::move(orig._native);
+    _type = orig._type;
   }
 
   return *this;
@@ -138,10 +275,37 @@ Object::operator=(Object const& orig)
 
 Object::~Object() = default;
 
+std::size_t
+Object::copies() noexcept
+{
+  auto& registry = copyRegistry();
+  auto lock = std::lock_guard{ registry.mutex };
+
+  auto total = registry.exited;
+  for (auto const* counter : registry.live) {
+    total += counter->count.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
 Object
 Object::null()
 {
   return Object{};
 }
 
+Object
+Object::fromInteger(std::int64_t value)
+{
+  if (!fitsInteger(value)) {
+    return Object{ static_cast<double>(value) };
+  }
+
+  auto obj = Object{};
+  obj.num = Number{ .integer = value };
+  obj.integral = true;
+  obj._type = ObjectType::NUMBER;
+  return obj;
+}
+
 } // namespace Lox
\ No newline at end of file
@@ -76,6 +76,19 @@ Parser::returnStatement()
   return std::make_unique<ReturnStatement>(std::move(val));
 }
 
+Stmt
+Parser::yieldStatement()
+{
+  auto val =
+    static_cast<Expr>(std::make_unique<LiteralExpression>(Object::null()));
+  if (!check(TokenType::SEMICOLON)) {
+    val = expression();
+  }
+
+  consume(TokenType::SEMICOLON, "Expect ';' after yield statement.");
+  return std::make_unique<YieldStatement>(std::move(val));
+}
+
 Stmt
 Parser::statement()
 {
@@ -87,6 +100,8 @@ Parser::statement()
     return printStatement();
   else if (match(TokenType::RETURN)) {
     return returnStatement();
+  } else if (match(TokenType::YIELD)) {
+    return yieldStatement();
   } else if (match(TokenType::WHILE)) {
     return whileStatement();
   } else if (match(TokenType::LEFT_BRACE))
@@ -186,6 +201,8 @@ Parser::forStatement()
 
   auto body = statement();
 
+  auto counted = countedLoop(initializer.get(), condition.get(), incr.get());
+
   if (incr) {
     /**
      * add incr as statement after rest of body
@@ -201,8 +218,8 @@ Parser::forStatement()
   if (!condition) {
     condition = std::make_unique<LiteralExpression>(Object{ true });
   }
-  body =
-    std::make_unique<WhileStatement>(std::move(condition), std::move(body));
+  body = std::make_unique<WhileStatement>(
+    std::move(condition), std::move(body), std::move(counted));
 
   if (initializer) {
     /**
@@ -218,6 +235,51 @@ Parser::forStatement()
   return body;
 }
 
+std::optional<CountedLoop>
+Parser::countedLoop(Statement const* initializer,
+                    Expression const* condition,
+                    Expression const* incr)
+{
+  auto const* var = dynamic_cast<VarDeclarationStatement const*>(initializer);
+  auto const* cmp = dynamic_cast<BinaryExpression const*>(condition);
+  auto const* assign = dynamic_cast<AssignmentExpression const*>(incr);
+  if (!var || !cmp || !assign) {
+    return std::nullopt;
+  }
+
+  auto const& counter = var->name().lexeme();
+  auto isCounter = [&counter](Expression const& expr) {
+    auto const* var = dynamic_cast<VariableExpression const*>(&expr);
+    return var && var->name().lexeme() == counter;
+  };
+
+  // i < bound or i <= bound, with a bound that is cheap to re-evaluate
+  auto op = cmp->op().type();
+  if ((op != TokenType::LESS && op != TokenType::LESS_EQUAL) ||
+      !isCounter(cmp->lhs()) || isCounter(cmp->rhs()) ||
+      (!dynamic_cast<LiteralExpression const*>(&cmp->rhs()) &&
+       !dynamic_cast<VariableExpression const*>(&cmp->rhs()))) {
+    return std::nullopt;
+  }
+
+  // i = i + step
+  auto const* sum = dynamic_cast<BinaryExpression const*>(&assign->value());
+  if (assign->name().lexeme() != counter || !sum ||
+      sum->op().type() != TokenType::PLUS || !isCounter(sum->lhs())) {
+    return std::nullopt;
+  }
+  auto const* step = dynamic_cast<LiteralExpression const*>(&sum->rhs());
+  if (!step || !step->value().isInteger() || step->value().integer() <= 0) {
+    return std::nullopt;
+  }
+
+  auto loop = CountedLoop{};
+  loop.counter = counter;
+  loop.inclusive = op == TokenType::LESS_EQUAL;
+  loop.step = step->value().integer();
+  return loop;
+}
+
 Expr
 Parser::expression()
 {
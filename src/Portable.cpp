@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <vector>
+
+#include <Callable.hpp>
+#include <Interpreter.hpp>
+#include <Map.hpp>
+#include <NativeObject.hpp>
+#include <Portable.hpp>
+
+namespace Lox {
+
+namespace {
+
+/**
+ * Maps being copied on this thread, a map holding
+ * itself can't be copied entry by entry.
+ * */
+thread_local auto copying = std::vector<Map const*>{};
+
+struct Copying
+{
+  explicit Copying(Map const& map) { copying.push_back(&map); }
+  Copying(Copying const&) = delete;
+  Copying& operator=(Copying const&) = delete;
+  ~Copying() { copying.pop_back(); }
+};
+
+} // namespace
+
+/**
+ * Object of a Portable, the overloads on rvalues
+ * move what they can instead of copying it.
+ * */
+struct Portable::Materialize
+{
+  Interpreter& interpreter;
+
+  Object operator()(std::monostate) const { return Object::null(); }
+
+  Object operator()(bool value) const { return Object{ value }; }
+
+  Object operator()(double value) const { return Object{ value }; }
+
+  Object operator()(std::int64_t value) const
+  {
+    return Object::fromInteger(value);
+  }
+
+  Object operator()(std::string const& value) const { return Object{ value }; }
+
+  Object operator()(std::string&& value) const
+  {
+    return Object{ std::move(value) };
+  }
+
+  Object operator()(Code const& code) const
+  {
+    return Object{ std::shared_ptr<Callable>{ std::make_shared<LoxFunction>(
+      code.declaration, interpreter.globalEnvironment()) } };
+  }
+
+  Object operator()(std::shared_ptr<Callable> const& callable) const
+  {
+    return Object{ callable };
+  }
+
+  Object operator()(std::shared_ptr<NativeObject> const& native) const
+  {
+    return Object{ native };
+  }
+
+  Object operator()(Cloned const& cloned) const
+  {
+    return Object{ std::shared_ptr<NativeObject>{ cloned.value->clone() } };
+  }
+
+  Object operator()(Cloned&& cloned) const
+  {
+    return Object{ std::shared_ptr<NativeObject>{ std::move(cloned.value) } };
+  }
+
+  Object operator()(MapEntries const& entries) const
+  {
+    auto map = std::make_shared<Map>();
+    for (auto i = 0UL; i < entries.keys.size(); ++i) {
+      map->set(entries.keys[i].toObject(interpreter),
+               entries.values[i].toObject(interpreter));
+    }
+    return Object{ std::shared_ptr<NativeObject>{ std::move(map) } };
+  }
+
+  Object operator()(MapEntries&& entries) const
+  {
+    auto map = std::make_shared<Map>();
+    for (auto i = 0UL; i < entries.keys.size(); ++i) {
+      map->set(std::move(entries.keys[i]).toObject(interpreter),
+               std::move(entries.values[i]).toObject(interpreter));
+    }
+    return Object{ std::shared_ptr<NativeObject>{ std::move(map) } };
+  }
+};
+
+Portable::Cloned::Cloned(Cloned const& orig)
+  : value(orig.value->clone())
+{}
+
+Portable::Cloned&
+Portable::Cloned::operator=(Cloned const& orig)
+{
+  value = orig.value->clone();
+  return *this;
+}
+
+Portable
+Portable::from(Interpreter const& interpreter,
+               Object const& obj,
+               std::string const& what)
+{
+  auto res = Portable{};
+  switch (obj.type()) {
+    case ObjectType::BOOLEAN:
+      res.value = obj.boolean();
+      break;
+    case ObjectType::NUMBER:
+      if (obj.isInteger()) {
+        res.value = obj.integer();
+      } else {
+        res.value = obj.number();
+      }
+      break;
+    case ObjectType::STRING:
+      res.value = obj.string();
+      break;
+    case ObjectType::CALLABLE:
+      if (auto const* fn = dynamic_cast<LoxFunction const*>(&obj.callable())) {
+        if (fn->closure != interpreter.globalEnvironment()) {
+          throw LoxRuntimeError{
+            what,
+            what + " can't be passed to a task, only top-level functions can."
+          };
+        }
+        res.value = Code{ fn->declaration };
+      } else {
+        // natives are immutable
+        res.value = obj.sharedCallable();
+      }
+      break;
+    case ObjectType::NATIVE: {
+      auto const& native = obj.native();
+      if (native.shareable()) {
+        res.value = obj.sharedNative();
+      } else if (auto const* map = dynamic_cast<Map const*>(&native)) {
+        if (std::ranges::find(copying, map) != copying.end()) {
+          throw LoxRuntimeError{
+            what, what + " can't be passed to a task, it contains itself."
+          };
+        }
+        auto guard = Copying{ *map };
+
+        // values may be functions, which are rebound rather than cloned
+        auto entries = MapEntries{};
+        for (auto const& entry : map->items()) {
+          entries.keys.push_back(
+            from(interpreter, Map::toObject(entry.key), what));
+          entries.values.push_back(
+            from(interpreter, Map::toObject(entry.value), what));
+        }
+        res.value = std::move(entries);
+      } else if (auto cloned = native.clone()) {
+        res.value = Cloned{ std::move(cloned) };
+      } else {
+        throw LoxRuntimeError{ what, what + " can't be passed to a task." };
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  return res;
+}
+
+Object
+Portable::toObject(Interpreter& interpreter) const&
+{
+  return std::visit(Materialize{ interpreter }, value);
+}
+
+Object
+Portable::toObject(Interpreter& interpreter) &&
+{
+  return std::visit(Materialize{ interpreter }, std::move(value));
+}
+
+} // namespace Lox
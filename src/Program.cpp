@@ -0,0 +1,23 @@
+#include <Parser.hpp>
+#include <Program.hpp>
+#include <PurityAnalyzer.hpp>
+#include <Resolver.hpp>
+#include <Scanner.hpp>
+
+namespace Lox {
+
+std::shared_ptr<Program const>
+Program::compile(std::string_view src)
+{
+  auto tokens = Scanner{ src.size(), src.data() }.scanTokens();
+  return std::make_shared<Program const>(Parser{ std::move(tokens) }.parse());
+}
+
+Program::Program(std::vector<Stmt> statements)
+  : _statements(std::move(statements))
+{
+  Resolver{}.resolve(_statements);
+  PurityAnalyzer{}.analyze(_statements);
+}
+
+} // namespace Lox
\ No newline at end of file
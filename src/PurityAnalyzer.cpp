@@ -0,0 +1,279 @@
+#include <PurityAnalyzer.hpp>
+
+namespace Lox {
+
+void
+PurityAnalyzer::analyze(std::vector<Stmt> const& statements)
+{
+  auto functions = std::map<std::string, FunctionDeclarationStatement const*>{};
+  auto declared = std::map<std::string, size_t>{};
+
+  for (auto& stmt : statements) {
+    if (auto* fn =
+          dynamic_cast<FunctionDeclarationStatement const*>(stmt.get())) {
+      functions[fn->name().lexeme()] = fn;
+      ++declared[fn->name().lexeme()];
+    } else if (auto* var =
+                 dynamic_cast<VarDeclarationStatement const*>(stmt.get())) {
+      ++declared[var->name().lexeme()];
+    }
+  }
+
+  // top-level code is only walked to collect assignments
+  auto top_level = Facts{};
+  facts = &top_level;
+  for (auto& stmt : statements) {
+    if (!dynamic_cast<FunctionDeclarationStatement const*>(stmt.get())) {
+      analyze(*stmt);
+    }
+  }
+
+  auto candidates = std::map<std::string, Facts>{};
+  for (auto const& [name, fn] : functions) {
+    analyze(*fn, candidates[name]);
+  }
+
+  for (auto it = candidates.begin(); it != candidates.end();) {
+    auto const& name = it->first;
+    if (it->second.impure || declared.at(name) > 1UL ||
+        assigned.contains(name)) {
+      it = candidates.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  /**
+   * Remaining candidates may still depend on names which turned out
+   * to be impure, drop those until nothing changes anymore.
+   * */
+  auto changed = true;
+  while (changed) {
+    changed = false;
+    for (auto it = candidates.begin(); it != candidates.end();) {
+      auto depends_on_impure = false;
+      for (auto const& name : it->second.free_names) {
+        depends_on_impure |= !candidates.contains(name);
+      }
+
+      if (depends_on_impure) {
+        it = candidates.erase(it);
+        changed = true;
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  // what is left only calls other pure functions of this unit
+  for (auto const& [name, fn] : functions) {
+    if (!candidates.contains(name)) {
+      fn->markPure(false);
+      continue;
+    }
+
+    auto reached = std::set<std::string>{};
+    auto pending = std::vector<std::string>{ name };
+    while (!pending.empty()) {
+      auto next = std::move(pending.back());
+      pending.pop_back();
+      for (auto const& callee : candidates.at(next).free_names) {
+        if (reached.insert(callee).second) {
+          pending.push_back(callee);
+        }
+      }
+    }
+    fn->markPure(true, { reached.begin(), reached.end() });
+  }
+  facts = nullptr;
+}
+
+void
+PurityAnalyzer::visitBlockStatement(BlockStatement const& stmt)
+{
+  scopes.emplace_back();
+  for (auto& inner : stmt.statements()) {
+    analyze(*inner);
+  }
+  scopes.pop_back();
+}
+
+void
+PurityAnalyzer::visitExpressionStatement(ExpressionStatement const& stmt)
+{
+  analyze(stmt.expression());
+}
+
+void
+PurityAnalyzer::visitPrintStatement(PrintStatement const& stmt)
+{
+  facts->impure = true;
+  analyze(stmt.expression());
+}
+
+void
+PurityAnalyzer::visitVarDeclarationStatement(
+  VarDeclarationStatement const& stmt)
+{
+  analyze(stmt.initializer());
+  if (!scopes.empty()) {
+    scopes.back().insert(stmt.name().lexeme());
+  }
+}
+
+void
+PurityAnalyzer::visitIfStatement(IfStatement const& stmt)
+{
+  analyze(stmt.condition());
+  analyze(stmt.thenBranch());
+  if (stmt.hasElseBranch()) {
+    analyze(stmt.elseBranch());
+  }
+}
+
+void
+PurityAnalyzer::visitWhileStatement(WhileStatement const& stmt)
+{
+  analyze(stmt.condition());
+  analyze(stmt.body());
+}
+
+void
+PurityAnalyzer::visitFunctionDeclarationStatement(
+  FunctionDeclarationStatement const& stmt)
+{
+  // a closure may capture locals, nested functions are never pure
+  auto nested = Facts{};
+  analyze(stmt, nested);
+  stmt.markPure(false);
+
+  facts->impure = true;
+  if (!scopes.empty()) {
+    scopes.back().insert(stmt.name().lexeme());
+  }
+}
+
+void
+PurityAnalyzer::visitReturnStatement(ReturnStatement const& stmt)
+{
+  analyze(stmt.value());
+}
+
+void
+PurityAnalyzer::visitYieldStatement(YieldStatement const& stmt)
+{
+  // every call returns a generator of its own
+  facts->impure = true;
+  analyze(stmt.value());
+}
+
+std::any
+PurityAnalyzer::visitAssignmentExpression(AssignmentExpression const& expr)
+{
+  analyze(expr.value());
+
+  assigned.insert(expr.name().lexeme());
+  if (!isLocal(expr.name().lexeme())) {
+    facts->impure = true;
+  }
+  return {};
+}
+
+std::any
+PurityAnalyzer::visitBinaryExpression(BinaryExpression const& expr)
+{
+  analyze(expr.lhs());
+  analyze(expr.rhs());
+  return {};
+}
+
+std::any
+PurityAnalyzer::visitGroupingExpression(GroupingExpression const& expr)
+{
+  analyze(expr.expr());
+  return {};
+}
+
+std::any
+PurityAnalyzer::visitLiteralExpression(LiteralExpression const&)
+{
+  return {};
+}
+
+std::any
+PurityAnalyzer::visitVariableExpression(VariableExpression const& expr)
+{
+  if (!isLocal(expr.name().lexeme())) {
+    facts->free_names.insert(expr.name().lexeme());
+  }
+  return {};
+}
+
+std::any
+PurityAnalyzer::visitUnaryExpression(UnaryExpression const& expr)
+{
+  analyze(expr.rhs());
+  return {};
+}
+
+std::any
+PurityAnalyzer::visitCallExpression(CallExpression const& expr)
+{
+  // only calls of a top-level function by name can be checked
+  auto const* callee = dynamic_cast<VariableExpression const*>(&expr.callee());
+  if (!callee || isLocal(callee->name().lexeme())) {
+    facts->impure = true;
+  }
+
+  analyze(expr.callee());
+  for (auto& arg : expr.arguments()) {
+    analyze(*arg);
+  }
+  return {};
+}
+
+void
+PurityAnalyzer::analyze(FunctionDeclarationStatement const& fn, Facts& in_facts)
+{
+  auto outer_scopes = std::move(scopes);
+  auto* outer_facts = facts;
+
+  scopes = {};
+  scopes.emplace_back();
+  for (auto& param : fn.params()) {
+    scopes.back().insert(param.lexeme());
+  }
+
+  facts = &in_facts;
+  for (auto& stmt : fn.body()) {
+    analyze(*stmt);
+  }
+
+  scopes = std::move(outer_scopes);
+  facts = outer_facts;
+}
+
+void
+PurityAnalyzer::analyze(Statement const& stmt)
+{
+  stmt.accept(*this);
+}
+
+void
+PurityAnalyzer::analyze(Expression const& expr)
+{
+  expr.accept(*this);
+}
+
+bool
+PurityAnalyzer::isLocal(std::string const& name) const
+{
+  for (auto& scope : scopes) {
+    if (scope.contains(name)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace Lox
\ No newline at end of file
@@ -0,0 +1,251 @@
+#include <atomic>
+#include <utility>
+
+#include <Resolver.hpp>
+
+namespace Lox {
+
+namespace {
+
+// 0 is never a unit, the interpreter uses it for "no unit cached"
+std::atomic<std::uint32_t> next_unit{ 1U };
+
+} // namespace
+
+void
+Resolver::resolve(std::vector<Stmt> const& statements)
+{
+  for (auto& stmt : statements) {
+    resolve(*stmt);
+  }
+}
+
+void
+Resolver::visitBlockStatement(BlockStatement const& stmt)
+{
+  auto functions_before = functions;
+
+  beginScope(stmt.statements());
+  auto locals = !scopes.back().empty();
+  resolve(stmt.statements());
+  endScope();
+
+  stmt.markScope(locals, functions != functions_before);
+}
+
+void
+Resolver::visitExpressionStatement(ExpressionStatement const& stmt)
+{
+  resolve(stmt.expression());
+}
+
+void
+Resolver::visitPrintStatement(PrintStatement const& stmt)
+{
+  resolve(stmt.expression());
+}
+
+void
+Resolver::visitVarDeclarationStatement(VarDeclarationStatement const& stmt)
+{
+  resolve(stmt.initializer());
+}
+
+void
+Resolver::visitIfStatement(IfStatement const& stmt)
+{
+  resolve(stmt.condition());
+  resolve(stmt.thenBranch());
+  if (stmt.hasElseBranch()) {
+    resolve(stmt.elseBranch());
+  }
+}
+
+void
+Resolver::visitWhileStatement(WhileStatement const& stmt)
+{
+  resolve(stmt.condition());
+
+  auto* loop = stmt.countedLoop();
+  if (!loop) {
+    resolve(stmt.body());
+    return;
+  }
+
+  /**
+   * Same scopes as resolving the body block, but only accesses of the
+   * counter in the original body count, not the one by the increment.
+   * */
+  loop->checked = true;
+  loop->body_reads_counter = false;
+
+  auto const& block = static_cast<BlockStatement const&>(stmt.body());
+  auto functions_before = functions;
+
+  beginScope(block.statements());
+  auto locals = !scopes.back().empty();
+  loops.push_back(loop);
+  resolve(stmt.loopBody());
+  loops.pop_back();
+  resolve(stmt.increment());
+  endScope();
+
+  block.markScope(locals, functions != functions_before);
+}
+
+void
+Resolver::visitFunctionDeclarationStatement(
+  FunctionDeclarationStatement const& stmt)
+{
+  ++functions;
+  auto outer_yields = std::exchange(yields, 0UL);
+
+  // params and body share one environment when called
+  beginScope(stmt.body(), stmt.params());
+  resolve(stmt.body());
+  endScope();
+
+  stmt.markGenerator(yields > 0UL);
+  yields = outer_yields;
+}
+
+void
+Resolver::visitReturnStatement(ReturnStatement const& stmt)
+{
+  resolve(stmt.value());
+}
+
+void
+Resolver::visitYieldStatement(YieldStatement const& stmt)
+{
+  resolve(stmt.value());
+  ++yields;
+}
+
+std::any
+Resolver::visitAssignmentExpression(AssignmentExpression const& expr)
+{
+  resolve(expr.value());
+  resolveSite(expr.name(), expr.site());
+
+  for (auto* loop : loops) {
+    if (loop->counter == expr.name().lexeme()) {
+      loop->checked = false;
+    }
+  }
+  return {};
+}
+
+std::any
+Resolver::visitBinaryExpression(BinaryExpression const& expr)
+{
+  resolve(expr.lhs());
+  resolve(expr.rhs());
+  return {};
+}
+
+std::any
+Resolver::visitGroupingExpression(GroupingExpression const& expr)
+{
+  resolve(expr.expr());
+  return {};
+}
+
+std::any
+Resolver::visitLiteralExpression(LiteralExpression const&)
+{
+  return {};
+}
+
+std::any
+Resolver::visitVariableExpression(VariableExpression const& expr)
+{
+  resolveSite(expr.name(), expr.site());
+
+  for (auto* loop : loops) {
+    if (loop->counter == expr.name().lexeme()) {
+      loop->body_reads_counter = true;
+    }
+  }
+  return {};
+}
+
+std::any
+Resolver::visitUnaryExpression(UnaryExpression const& expr)
+{
+  resolve(expr.rhs());
+  return {};
+}
+
+std::any
+Resolver::visitCallExpression(CallExpression const& expr)
+{
+  resolve(expr.callee());
+  for (auto& arg : expr.arguments()) {
+    resolve(*arg);
+  }
+  return {};
+}
+
+void
+Resolver::resolve(Statement const& stmt)
+{
+  stmt.accept(*this);
+}
+
+void
+Resolver::resolve(Expression const& expr)
+{
+  expr.accept(*this);
+}
+
+void
+Resolver::beginScope(std::vector<Stmt> const& statements,
+                     std::vector<Token> const& params)
+{
+  auto names = std::set<std::string>{};
+  for (auto& param : params) {
+    names.insert(param.lexeme());
+  }
+
+  /**
+   * Only declarations directly in this scope, nested blocks
+   * get a scope of their own.
+   * */
+  for (auto& stmt : statements) {
+    if (auto* var = dynamic_cast<VarDeclarationStatement const*>(stmt.get())) {
+      names.insert(var->name().lexeme());
+    } else if (auto* fun = dynamic_cast<FunctionDeclarationStatement const*>(
+                 stmt.get())) {
+      names.insert(fun->name().lexeme());
+    }
+  }
+
+  scopes.push_back(std::move(names));
+}
+
+void
+Resolver::endScope()
+{
+  scopes.pop_back();
+}
+
+void
+Resolver::resolveSite(Token const& name, GlobalSite& site)
+{
+  for (auto& scope : scopes) {
+    if (scope.contains(name.lexeme())) {
+      site.global = false;
+      return;
+    }
+  }
+  site.global = true;
+  site.unit = unit;
+  site.index = sites++;
+}
+
+Resolver::Resolver()
+  : unit(next_unit.fetch_add(1U, std::memory_order_relaxed))
+{}
+
+} // namespace Lox
\ No newline at end of file
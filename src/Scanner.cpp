@@ -1,5 +1,6 @@
 #include <Scanner.hpp>
 #include <array>
+#include <charconv>
 #include <map>
 
 namespace Lox {
@@ -154,8 +155,18 @@ Scanner::addNumber()
       advance();
   }
 
-  auto value = std::stod(std::string{ src + start, current - start });
-  addToken(TokenType::NUMBER, Object{ value });
+  auto lexeme = std::string{ src + start, current - start };
+
+  // whole numbers start out in the integer representation
+  auto integer = std::int64_t{};
+  auto [end, err] =
+    std::from_chars(lexeme.data(), lexeme.data() + lexeme.size(), integer);
+  if (err == std::errc{} && end == lexeme.data() + lexeme.size() &&
+      Object::fitsInteger(integer)) {
+    addToken(TokenType::NUMBER, Object::fromInteger(integer));
+  } else {
+    addToken(TokenType::NUMBER, Object{ std::stod(lexeme) });
+  }
 }
 
 void
@@ -164,7 +175,7 @@ Scanner::addIdentifier()
   while (isAlphaNumeric(peek()))
     advance();
 
-  static auto keywords = std::map<std::string, TokenType>{
+  static auto const keywords = std::map<std::string, TokenType>{
     { "and", TokenType::AND },       { "class", TokenType::CLASS },
     { "else", TokenType::ELSE },     { "false", TokenType::FALSE },
     { "for", TokenType::FOR },       { "fun", TokenType::FUN },
@@ -172,7 +183,8 @@ Scanner::addIdentifier()
     { "or", TokenType::OR },         { "print", TokenType::PRINT },
     { "return", TokenType::RETURN }, { "super", TokenType::SUPER },
     { "this", TokenType::THIS },     { "true", TokenType::TRUE },
-    { "var", TokenType::VAR },       { "while", TokenType::WHILE }
+    { "var", TokenType::VAR },       { "while", TokenType::WHILE },
+    { "yield", TokenType::YIELD }
   };
 
   auto identifier = std::string(src + start, current - start);
@@ -0,0 +1,543 @@
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <ostream>
+#include <streambuf>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <Interpreter.hpp>
+#include <Program.hpp>
+#include <Server.hpp>
+
+namespace Lox {
+
+namespace {
+
+constexpr std::size_t max_header = 4096UL;
+constexpr std::size_t max_source = 64UL * 1024UL * 1024UL;
+
+// waits after failed accepts, doubled while they keep failing
+constexpr auto min_backoff = std::chrono::milliseconds{ 10 };
+constexpr auto max_backoff = std::chrono::milliseconds{ 1000 };
+
+sockaddr_un
+address(std::string const& path)
+{
+  auto addr = sockaddr_un{};
+  if (path.size() >= sizeof(addr.sun_path)) {
+    throw std::runtime_error{ path + ": socket path is too long" };
+  }
+  addr.sun_family = AF_UNIX;
+  path.copy(addr.sun_path, path.size());
+  return addr;
+}
+
+int
+connectTo(std::string const& path)
+{
+  auto addr = address(path);
+  auto fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    throw std::system_error{ errno, std::generic_category(), path };
+  }
+  if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+    auto err = errno;
+    close(fd);
+    throw std::system_error{ err, std::generic_category(), path };
+  }
+  return fd;
+}
+
+bool
+sendAll(int fd, std::string_view data)
+{
+  while (!data.empty()) {
+    auto n = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      return false;
+    }
+    data.remove_prefix(static_cast<std::size_t>(n));
+  }
+  return true;
+}
+
+bool
+sendFrame(int fd, std::string_view kind, std::string_view data)
+{
+  auto frame = std::string{ kind };
+  frame += ' ';
+  frame += std::to_string(data.size());
+  frame += '\n';
+  frame += data;
+  return sendAll(fd, frame);
+}
+
+/**
+ * Reads a socket a line or a number of bytes at a time, giving up
+ * at an optional deadline or once stopping is set.
+ * */
+class Reader
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * Next line without its newline, false at the end of the
+   * stream or if the line is longer than limit.
+   * */
+  bool line(std::string& out, std::size_t limit)
+  {
+    auto end = std::string::npos;
+    while ((end = buffer.find('\n', pos)) == std::string::npos) {
+      if (buffer.size() - pos > limit || !fill()) {
+        return false;
+      }
+    }
+    out.assign(buffer, pos, end - pos);
+    pos = end + 1UL;
+    return out.size() <= limit;
+  }
+
+  bool bytes(std::string& out, std::size_t count)
+  {
+    while (buffer.size() - pos < count) {
+      if (!fill()) {
+        return false;
+      }
+    }
+    out.assign(buffer, pos, count);
+    pos += count;
+    return true;
+  }
+
+  /**
+   * Whether reading failed for the deadline or stopping.
+   * */
+  bool gaveUp() const noexcept { return gave_up; }
+
+  explicit Reader(int fd)
+    : fd(fd)
+    , buffer()
+    , pos(0UL)
+    , deadline()
+    , stopping(nullptr)
+    , gave_up(false)
+  {}
+
+  Reader(int fd, Clock::time_point deadline, std::atomic<bool> const& stopping)
+    : fd(fd)
+    , buffer()
+    , pos(0UL)
+    , deadline(deadline)
+    , stopping(&stopping)
+    , gave_up(false)
+  {}
+
+private:
+  bool fill()
+  {
+    buffer.erase(0UL, pos);
+    pos = 0UL;
+
+    auto chunk = std::array<char, 16UL * 1024UL>{};
+    while (true) {
+      if (deadline && !await()) {
+        gave_up = true;
+        return false;
+      }
+      auto n = recv(fd, chunk.data(), chunk.size(), 0);
+      if (n > 0) {
+        buffer.append(chunk.data(), static_cast<std::size_t>(n));
+        return true;
+      }
+      if (n == 0 || errno != EINTR) {
+        return false;
+      }
+    }
+  }
+
+  /**
+   * Waits for the socket to be readable, in slices so that stopping
+   * is noticed as well. False if the deadline passed first.
+   * */
+  bool await()
+  {
+    using namespace std::chrono;
+    constexpr auto slice = milliseconds{ 100 };
+
+    while (!stopping->load()) {
+      auto left = ceil<milliseconds>(*deadline - Clock::now());
+      if (left <= milliseconds::zero()) {
+        return false;
+      }
+      auto events = pollfd{ fd, POLLIN, 0 };
+      auto wait = std::min(left, slice);
+      auto n = poll(&events, 1, static_cast<int>(wait.count()));
+      // readable, closed or broken, recv() tells which
+      if (n > 0 || (n < 0 && errno != EINTR)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+private:
+  int fd;
+  std::string buffer;
+  std::size_t pos;
+  std::optional<Clock::time_point> deadline;
+  std::atomic<bool> const* stopping;
+  bool gave_up;
+};
+
+/**
+ * Sends what is written to it as "out" frames, whenever its buffer
+ * is full and on every flush, so prints reach the client right away.
+ * Once the client is gone writes fail and the stream goes bad.
+ * */
+class FrameBuffer : public std::streambuf
+{
+public:
+  explicit FrameBuffer(int fd)
+    : fd(fd)
+    , buffer()
+  {
+    setp(buffer.data(), buffer.data() + buffer.size());
+  }
+
+protected:
+  virtual int_type overflow(int_type ch) override
+  {
+    if (!flushFrame()) {
+      return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(ch);
+      pbump(1);
+    }
+    return traits_type::not_eof(ch);
+  }
+
+  virtual int sync() override { return flushFrame() ? 0 : -1; }
+
+private:
+  bool flushFrame()
+  {
+    auto size = static_cast<std::size_t>(pptr() - pbase());
+    setp(buffer.data(), buffer.data() + buffer.size());
+    return size == 0UL || sendFrame(fd, "out", { buffer.data(), size });
+  }
+
+private:
+  int fd;
+  std::array<char, 16UL * 1024UL> buffer;
+};
+
+/**
+ * Parses the "<kind> <number>" header of a frame or request.
+ * */
+bool
+parseHeader(std::string_view line, std::string_view& kind, std::size_t& number)
+{
+  auto space = line.find(' ');
+  if (space == std::string_view::npos) {
+    return false;
+  }
+  kind = line.substr(0UL, space);
+  auto digits = line.substr(space + 1UL);
+  auto [end, err] =
+    std::from_chars(digits.data(), digits.data() + digits.size(), number);
+  return err == std::errc{} && end == digits.data() + digits.size();
+}
+
+bool
+readFile(std::string const& path, std::string& out)
+{
+  auto f = std::ifstream{ path, std::ios::binary | std::ios::ate };
+  if (!f.is_open()) {
+    return false;
+  }
+  out.resize(static_cast<std::size_t>(f.tellg()));
+  f.seekg(0);
+  f.read(out.data(), static_cast<std::streamsize>(out.size()));
+  return static_cast<bool>(f);
+}
+
+/**
+ * Sleeps for duration in slices, returning early once stopping is set.
+ * */
+void
+backOff(std::chrono::milliseconds duration, std::atomic<bool> const& stopping)
+{
+  auto until = std::chrono::steady_clock::now() + duration;
+  while (!stopping && std::chrono::steady_clock::now() < until) {
+    std::this_thread::sleep_for(min_backoff);
+  }
+}
+
+} // namespace
+
+#pragma region Server
+
+void
+Server::run()
+{
+  auto workers = std::vector<std::jthread>{};
+  try {
+    for (auto i = 0UL; i < std::max(options.workers, 1UL); ++i) {
+      workers.emplace_back([this]() { work(); });
+    }
+  } catch (...) {
+    // the workers already started only return once stopping
+    stop();
+    throw;
+  }
+}
+
+void
+Server::stop() noexcept
+{
+  // wakes the workers reading requests and those blocked in accept()
+  stopping = true;
+  shutdown(listener, SHUT_RDWR);
+}
+
+size_t
+Server::cachedPrograms() const
+{
+  auto lock = std::lock_guard{ mutex };
+  return programs.size();
+}
+
+Server::Server(ServerOptions options)
+  : options(std::move(options))
+  , listener(-1)
+  , stopping(false)
+  , mutex()
+  , programs()
+  , ticks(0UL)
+{
+  auto const& path = this->options.path;
+  auto addr = address(path);
+
+  // a socket left behind by a server that is gone is replaced
+  struct stat info{};
+  if (lstat(path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode)) {
+    try {
+      close(connectTo(path));
+      throw std::runtime_error{ path + ": a server is already running" };
+    } catch (std::system_error const&) {
+      unlink(path.c_str());
+    }
+  }
+
+  listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (listener < 0 ||
+      bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+      listen(listener, SOMAXCONN) < 0) {
+    auto err = errno;
+    if (listener >= 0) {
+      close(listener);
+    }
+    throw std::system_error{ err, std::generic_category(), path };
+  }
+}
+
+Server::~Server()
+{
+  close(listener);
+  unlink(options.path.c_str());
+}
+
+void
+Server::work()
+{
+  /**
+   * The interpreter is set up once and reset to its snapshot after
+   * every script, which leaves its frame stacks, pools and options warm.
+   * */
+  auto interpreter = Interpreter{};
+  if (options.configure) {
+    options.configure(interpreter);
+  }
+  interpreter.snapshot();
+
+  auto backoff = std::chrono::milliseconds{ 0 };
+  while (true) {
+    auto client = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+    if (client < 0) {
+      auto err = errno;
+      if (stopping) {
+        // the listener was shut down by stop()
+        return;
+      }
+      if (err == EINTR || err == ECONNABORTED) {
+        continue;
+      }
+      // e.g. out of descriptors or memory, the connection stays queued
+      // until some are released
+      backoff = std::clamp(backoff * 2, min_backoff, max_backoff);
+      std::cerr << "accept: " << std::generic_category().message(err)
+                << ", retrying in " << backoff.count() << " ms" << std::endl;
+      backOff(backoff, stopping);
+      continue;
+    }
+    backoff = std::chrono::milliseconds{ 0 };
+
+    serve(client, interpreter);
+    close(client);
+    interpreter.reset();
+  }
+}
+
+void
+Server::serve(int client, Interpreter& interpreter)
+{
+  auto reader =
+    Reader{ client, Reader::Clock::now() + options.request_timeout, stopping };
+  auto frames = FrameBuffer{ client };
+  auto out = std::ostream{ &frames };
+
+  auto finish = [&](ScriptStatus status, std::string const& error) {
+    out.flush();
+    if (!error.empty()) {
+      sendFrame(client, "err", error + "\n");
+    }
+    auto exit = "exit " + std::to_string(static_cast<int>(status)) + "\n";
+    sendAll(client, exit);
+  };
+
+  auto header = std::string{};
+  auto kind = std::string_view{};
+  auto size = 0UL;
+  auto source = std::string{};
+
+  auto malformed = [&]() {
+    finish(ScriptStatus::bad_request,
+           !reader.gaveUp() ? "Malformed request."
+           : stopping       ? "Server is stopping."
+                            : "Request timed out.");
+  };
+
+  if (!reader.line(header, max_header)) {
+    return malformed();
+  }
+
+  if (header.starts_with("path ")) {
+    auto path = header.substr(5UL);
+    if (!readFile(path, source)) {
+      return finish(ScriptStatus::unreadable,
+                    path + ": File could not be opened");
+    }
+  } else if (!parseHeader(header, kind, size) || kind != "source" ||
+             size > max_source || !reader.bytes(source, size)) {
+    return malformed();
+  }
+
+  auto compiled = std::shared_ptr<Program const>{};
+  try {
+    compiled = program(source);
+  } catch (std::exception const& err) {
+    return finish(ScriptStatus::syntax_error, err.what());
+  }
+
+  try {
+    interpreter.setOutput(out);
+    auto ok = interpreter.interpret(compiled);
+    finish(ok ? ScriptStatus::ok : ScriptStatus::runtime_error, {});
+  } catch (std::exception const& err) {
+    finish(ScriptStatus::runtime_error, err.what());
+  }
+}
+
+std::shared_ptr<Program const>
+Server::program(std::string_view source)
+{
+  auto key = std::hash<std::string_view>{}(source);
+  {
+    auto lock = std::lock_guard{ mutex };
+    auto it = programs.find(key);
+    if (it != programs.end() && it->second.source == source) {
+      it->second.used = ++ticks;
+      return it->second.program;
+    }
+  }
+
+  // compiled outside the lock, a source sent twice at once is compiled twice
+  auto compiled = Program::compile(source);
+  if (options.cache_entries == 0UL) {
+    return compiled;
+  }
+
+  auto lock = std::lock_guard{ mutex };
+  if (programs.size() >= options.cache_entries && !programs.contains(key)) {
+    auto oldest = std::min_element(
+      programs.begin(), programs.end(), [](auto const& lhs, auto const& rhs) {
+        return lhs.second.used < rhs.second.used;
+      });
+    programs.erase(oldest);
+  }
+  programs.insert_or_assign(
+    key, Entry{ std::string{ source }, compiled, ++ticks });
+
+  return compiled;
+}
+
+#pragma endregion
+
+int
+runOnServer(std::string const& socket,
+            ScriptRequest request,
+            std::ostream& out,
+            std::ostream& err)
+{
+  auto fd = connectTo(socket);
+
+  auto message = std::string{};
+  if (request.kind == ScriptRequest::Kind::path) {
+    message = "path " + std::string{ request.text } + "\n";
+  } else {
+    message = "source " + std::to_string(request.text.size()) + "\n";
+    message += request.text;
+  }
+
+  auto reader = Reader{ fd };
+  auto line = std::string{};
+  auto data = std::string{};
+  auto kind = std::string_view{};
+  auto number = 0UL;
+
+  auto ok = sendAll(fd, message);
+  while (ok && reader.line(line, max_header) &&
+         parseHeader(line, kind, number)) {
+    if (kind == "exit") {
+      close(fd);
+      return static_cast<int>(number);
+    }
+    if (!reader.bytes(data, number)) {
+      break;
+    }
+    (kind == "err" ? err : out) << data << std::flush;
+  }
+
+  close(fd);
+  throw std::runtime_error{ socket + ": connection to the server was lost" };
+}
+
+} // namespace Lox
\ No newline at end of file
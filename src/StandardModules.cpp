@@ -0,0 +1,302 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <sstream>
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <EventLoop.hpp>
+#include <Interpreter.hpp>
+#include <Map.hpp>
+#include <NativeModule.hpp>
+#include <NumberArray.hpp>
+#include <StringBuilder.hpp>
+#include <TaskPool.hpp>
+
+namespace Lox {
+
+namespace {
+
+#pragma region math
+
+double
+sqrt(double x)
+{
+  return std::sqrt(x);
+}
+
+double
+abs(double x)
+{
+  return std::fabs(x);
+}
+
+double
+floor(double x)
+{
+  return std::floor(x);
+}
+
+double
+ceil(double x)
+{
+  return std::ceil(x);
+}
+
+double
+pow(double base, double exponent)
+{
+  return std::pow(base, exponent);
+}
+
+double
+min(double lhs, double rhs)
+{
+  return std::min(lhs, rhs);
+}
+
+double
+max(double lhs, double rhs)
+{
+  return std::max(lhs, rhs);
+}
+
+#pragma endregion
+
+#pragma region string
+
+double
+len(std::string_view str)
+{
+  return static_cast<double>(str.size());
+}
+
+std::string
+upper(std::string_view str)
+{
+  auto res = std::string{ str };
+  std::transform(res.begin(), res.end(), res.begin(), [](unsigned char c) {
+    return static_cast<char>(std::toupper(c));
+  });
+  return res;
+}
+
+std::string
+lower(std::string_view str)
+{
+  auto res = std::string{ str };
+  std::transform(res.begin(), res.end(), res.begin(), [](unsigned char c) {
+    return static_cast<char>(std::tolower(c));
+  });
+  return res;
+}
+
+bool
+contains(std::string_view str, std::string_view part)
+{
+  return str.find(part) != std::string_view::npos;
+}
+
+#pragma endregion
+
+#pragma region time
+
+double
+nanos()
+{
+  using namespace std::chrono;
+
+  return static_cast<double>(
+    duration_cast<nanoseconds>(steady_clock::now().time_since_epoch())
+      .count());
+}
+
+/**
+ * CPU time of the calling thread, the one running the interpreter,
+ * so the work of other threads, e.g. of --jobs or tasks, doesn't count.
+ * */
+std::chrono::nanoseconds
+threadCpuTime()
+{
+  auto ts = timespec{};
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return std::chrono::seconds{ ts.tv_sec } +
+         std::chrono::nanoseconds{ ts.tv_nsec };
+}
+
+double
+cpuNanos()
+{
+  return static_cast<double>(threadCpuTime().count());
+}
+
+/**
+ * Hardware counter of the calling thread, user space only. Unavailable
+ * e.g. in containers or with a strict perf_event_paranoid setting.
+ * */
+class PerfCounter
+{
+public:
+  std::optional<std::uint64_t> read() const
+  {
+    auto value = std::uint64_t{};
+    if (fd < 0 || ::read(fd, &value, sizeof(value)) != sizeof(value)) {
+      return std::nullopt;
+    }
+    return value;
+  }
+
+  explicit PerfCounter(std::uint64_t config)
+    : fd(-1)
+  {
+    auto attr = perf_event_attr{};
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+  }
+  PerfCounter(PerfCounter const&) = delete;
+  PerfCounter& operator=(PerfCounter const&) = delete;
+  ~PerfCounter()
+  {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+
+private:
+  int fd;
+};
+
+Object
+counterValue(PerfCounter const& counter)
+{
+  auto value = counter.read();
+  return value ? Object{ static_cast<double>(*value) } : Object::null();
+}
+
+Object
+cycles()
+{
+  thread_local auto const counter = PerfCounter{ PERF_COUNT_HW_CPU_CYCLES };
+  return counterValue(counter);
+}
+
+Object
+instructions()
+{
+  thread_local auto const counter = PerfCounter{ PERF_COUNT_HW_INSTRUCTIONS };
+  return counterValue(counter);
+}
+
+/**
+ * benchmark(fn, runs) calls fn runs times, prints the fastest and the
+ * median run and returns the median in nanoseconds of CPU time of the
+ * interpreter's thread. Beyond 1024 runs the median is that of a
+ * uniform sample of them.
+ * */
+Object
+benchmark(Interpreter& interpreter, Arguments args)
+{
+  constexpr auto max_runs = 1UL << 32;
+  constexpr auto max_samples = 1024UL;
+
+  if (!args[0].isCallable()) {
+    throw LoxRuntimeError{ "benchmark", "Argument 1 must be a function." };
+  }
+  if (!args[1].isNumber() ||
+      !(args[1].number() >= 1.0 &&
+        args[1].number() <= static_cast<double>(max_runs))) {
+    throw LoxRuntimeError{ "benchmark",
+                           "Argument 2 must be between 1 and " +
+                             std::to_string(max_runs) + "." };
+  }
+
+  using duration = std::chrono::nanoseconds;
+  auto runs = static_cast<std::uint64_t>(args[1].number());
+  auto times = std::vector<duration>{};
+  times.reserve(std::min(runs, max_samples));
+  auto fastest = duration::max();
+  // reservoir sampling, every run is kept with the same probability
+  auto random = std::mt19937_64{};
+  for (auto run = 0UL; run < runs; ++run) {
+    auto start = threadCpuTime();
+    interpreter.call(args[0], {});
+    auto time = threadCpuTime() - start;
+
+    fastest = std::min(fastest, time);
+    if (times.size() < max_samples) {
+      times.push_back(time);
+    } else if (auto i = random() % (run + 1UL); i < max_samples) {
+      times[i] = time;
+    }
+  }
+  std::sort(times.begin(), times.end());
+
+  auto ns = [](duration time) {
+    return std::chrono::duration<double, std::nano>(time).count();
+  };
+  auto n = times.size();
+  auto median = n % 2 == 1 ? ns(times[n / 2])
+                           : (ns(times[n / 2 - 1]) + ns(times[n / 2])) / 2.0;
+
+  auto report = std::ostringstream{};
+  report << std::fixed << std::setprecision(0)
+         << args[0].callable().toString() << ": min " << ns(fastest)
+         << " ns, median " << median << " ns (" << runs << " runs)";
+  interpreter.output() << report.str() << std::endl;
+  return Object{ median };
+}
+
+#pragma endregion
+
+} // namespace
+
+std::vector<NativeModule>
+standardModules()
+{
+  auto modules = std::vector<NativeModule>{};
+
+  auto& math = modules.emplace_back("math");
+  math.function<&sqrt>("sqrt")
+    .function<&abs>("abs")
+    .function<&floor>("floor")
+    .function<&ceil>("ceil")
+    .function<&pow>("pow")
+    .function<&min>("min")
+    .function<&max>("max");
+
+  auto& string = modules.emplace_back("string");
+  string.function<&len>("len")
+    .function<&upper>("upper")
+    .function<&lower>("lower")
+    .function<&contains>("contains");
+  addStringBuilder(string);
+
+  auto& time = modules.emplace_back("time");
+  time.function<&nanos>("nanos")
+    .function<&cpuNanos>("cpuNanos")
+    .function<&cycles>("cycles")
+    .function<&instructions>("instructions")
+    .function("benchmark", &benchmark, 2UL);
+
+  modules.push_back(numberArrayModule());
+  modules.push_back(mapModule());
+  modules.push_back(taskModule());
+  modules.push_back(eventModule());
+
+  return modules;
+}
+
+} // namespace Lox
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <new>
+
+#include <Interpreter.hpp>
+#include <StringBuilder.hpp>
+
+namespace Lox {
+
+void
+StringBuilder::append(std::string_view str)
+{
+  write();
+  buffer.append(str);
+}
+
+void
+StringBuilder::append(double num)
+{
+  // fixed with 6 decimals like std::to_string, DBL_MAX has 309 digits
+  auto digits = std::array<char, 320>{};
+  auto res = std::to_chars(
+    digits.data(), digits.data() + digits.size(), num, std::chars_format::fixed, 6);
+  write();
+  buffer.append(digits.data(), res.ptr);
+}
+
+void
+StringBuilder::append(std::int64_t num)
+{
+  auto digits = std::array<char, 24>{};
+  auto res = std::to_chars(digits.data(), digits.data() + digits.size(), num);
+  write();
+  buffer.append(digits.data(), res.ptr);
+  buffer.append(".000000");
+}
+
+void
+StringBuilder::append(Object const& obj)
+{
+  if (obj.isString()) {
+    append(std::string_view{ obj.string() });
+  } else if (obj.isInteger()) {
+    append(obj.integer());
+  } else if (obj.isNumber()) {
+    append(obj.number());
+  } else {
+    append(std::string_view{ Interpreter::stringify(obj) });
+  }
+}
+
+void
+StringBuilder::reserve(std::size_t size)
+{
+  buffer.reserve(size);
+}
+
+std::unique_ptr<NativeObject>
+StringBuilder::clone() const
+{
+  auto res = std::make_unique<StringBuilder>();
+  res->buffer = buffer;
+  return res;
+}
+
+void
+StringBuilder::restore(NativeObject& saved)
+{
+  buffer = std::move(static_cast<StringBuilder&>(saved).buffer);
+}
+
+std::string
+StringBuilder::toString() const
+{
+  return buffer;
+}
+
+namespace {
+
+#pragma region natives
+
+std::shared_ptr<StringBuilder>
+newStringBuilder()
+{
+  return std::make_shared<StringBuilder>();
+}
+
+void
+builderAppend(Interpreter& interpreter,
+              StringBuilder& builder,
+              Object const& value)
+{
+  auto before = builder.bytes();
+  builder.append(value);
+  interpreter.budget().allocate(builder.bytes() - before);
+}
+
+// a hint beyond 1 GiB is a mistake rather than a plan
+constexpr auto max_reserve = 1UL << 30;
+
+void
+builderReserve(Interpreter& interpreter, StringBuilder& builder, double size)
+{
+  if (!(size >= 0.0)) {
+    throw LoxRuntimeError{ "builderReserve",
+                           "Size must be a non-negative number." };
+  }
+  if (size > static_cast<double>(max_reserve)) {
+    throw LoxRuntimeError{ "builderReserve",
+                           "Size must be at most " +
+                             std::to_string(max_reserve) + "." };
+  }
+  // charged up front, a reservation over the quota is never made
+  auto bytes = static_cast<std::size_t>(size);
+  interpreter.budget().allocate(bytes - std::min(bytes, builder.bytes()));
+  try {
+    builder.reserve(bytes);
+  } catch (std::bad_alloc const&) {
+    throw LoxRuntimeError{ "builderReserve", "Out of memory." };
+  }
+}
+
+double
+builderLength(StringBuilder& builder)
+{
+  return static_cast<double>(builder.length());
+}
+
+std::string
+builderString(StringBuilder& builder)
+{
+  return builder.str();
+}
+
+#pragma endregion
+
+} // namespace
+
+void
+addStringBuilder(NativeModule& module)
+{
+  module.function<&newStringBuilder>("StringBuilder")
+    .function<&builderAppend>("builderAppend")
+    .function<&builderReserve>("builderReserve")
+    .function<&builderLength>("builderLength")
+    .function<&builderString>("builderString");
+}
+
+} // namespace Lox
\ No newline at end of file
@@ -0,0 +1,377 @@
+#include <optional>
+#include <utility>
+
+#include <Callable.hpp>
+#include <Channel.hpp>
+#include <Interpreter.hpp>
+#include <Portable.hpp>
+#include <TaskPool.hpp>
+
+namespace Lox {
+
+/**
+ * Globals of the spawning interpreter that hold shareable values, kept
+ * by it and reused by every spawn until a global is written. Globals
+ * holding native values like maps may change in place, a task gets its
+ * own copy of those at the spawn.
+ * */
+struct TaskSnapshot
+{
+  std::weak_ptr<Environment const> env;
+  std::size_t generation = 0UL;
+  std::vector<std::pair<std::string, Portable>> globals;
+  std::vector<std::string> copied;
+};
+
+struct TaskState
+{
+  Portable fn;
+  std::vector<Portable> args;
+  std::shared_ptr<TaskSnapshot const> globals;
+  std::vector<std::pair<std::string, Portable>> copied;
+  // what is left of the spawning interpreter's budget
+  Budget budget;
+
+  std::atomic<bool> done{ false };
+  Portable result;
+  std::optional<std::string> error;
+};
+
+namespace {
+
+std::shared_ptr<TaskSnapshot const>
+snapshot(Interpreter& from)
+{
+  auto const& globals = from.globalEnvironment();
+  auto& cached = from.taskSnapshot();
+  if (cached && cached->env.lock() == globals &&
+      cached->generation == globals->generation()) {
+    return cached;
+  }
+
+  auto res = std::make_shared<TaskSnapshot>();
+  res->env = globals;
+  res->generation = globals->generation();
+  globals->forEach([&](std::string const& name, Object const& value) {
+    if (value.isNative() && !value.native().shareable()) {
+      res->copied.push_back(name);
+      return;
+    }
+    try {
+      res->globals.emplace_back(name, Portable::from(from, value, name));
+    } catch (LoxRuntimeError const&) {
+      // stays undefined in the task
+    }
+  });
+  cached = res;
+  return res;
+}
+
+void
+install(Interpreter& to, TaskState& task)
+{
+  // globals of an unrelated script's tasks must not show through
+  to.resetGlobals();
+  for (auto const& [name, value] : task.globals->globals) {
+    to.globalEnvironment()->define(name, value.toObject(to));
+  }
+  for (auto& [name, value] : task.copied) {
+    to.globalEnvironment()->define(name, std::move(value).toObject(to));
+  }
+}
+
+/**
+ * The worker running on this thread, if any.
+ * */
+struct Worker
+{
+  TaskPool* pool = nullptr;
+  std::size_t index = 0UL;
+  Interpreter* interpreter = nullptr;
+  // whether a task runs, tasks run while joining nest
+  bool running = false;
+};
+
+thread_local auto worker = Worker{};
+
+/**
+ * Waits on changed until done holds, a LoxRuntimeError
+ * if the time of budget is up first.
+ * */
+template<typename Predicate>
+void
+await(std::condition_variable& changed,
+      std::unique_lock<std::mutex>& lock,
+      Budget& budget,
+      Predicate done)
+{
+  auto limit = budget.waitLimit();
+  if (!limit) {
+    changed.wait(lock, done);
+  } else if (!changed.wait_until(lock, *limit, done)) {
+    budget.checkTime();
+  }
+}
+
+std::atomic<std::size_t> shared_workers{ 0UL };
+
+} // namespace
+
+std::shared_ptr<TaskHandle>
+TaskPool::spawn(Interpreter& from, Object const& fn, Arguments args)
+{
+  if (!fn.isCallable()) {
+    throw LoxRuntimeError{ "spawn", "Argument 1 must be a function." };
+  }
+  auto arity = fn.callable().arity();
+  if (arity != Callable::variadic && arity != args.size()) {
+    throw LoxRuntimeError{ fn.callable().toString(),
+                           "Expected " + std::to_string(arity) +
+                             " arguments but got " +
+                             std::to_string(args.size()) + "." };
+  }
+
+  auto task = std::make_shared<TaskState>();
+  task->fn = Portable::from(from, fn, "Argument 1");
+  for (auto i = 0UL; i < args.size(); ++i) {
+    task->args.push_back(
+      Portable::from(from, args[i], "Argument " + std::to_string(i + 2UL)));
+  }
+  task->globals = snapshot(from);
+  for (auto const& name : task->globals->copied) {
+    try {
+      task->copied.emplace_back(
+        name, Portable::from(from, *from.globalEnvironment()->cell(name), name));
+    } catch (LoxRuntimeError const&) {
+      // files, generators and the like stay undefined
+    }
+  }
+  task->budget = from.budget();
+
+  push(task);
+  return std::make_shared<TaskHandle>(std::move(task));
+}
+
+Object
+TaskPool::join(Interpreter& interpreter, TaskHandle const& handle)
+{
+  auto& task = *handle.state;
+
+  if (worker.pool == this) {
+    // keep the worker busy, the awaited task may be queued behind others
+    while (!task.done) {
+      if (auto other = take(worker.index)) {
+        run(*worker.interpreter, *other);
+        continue;
+      }
+      auto lock = std::unique_lock{ mutex };
+      await(changed, lock, interpreter.budget(), [&]() {
+        return task.done || queued > 0UL;
+      });
+    }
+  } else {
+    auto lock = std::unique_lock{ mutex };
+    await(changed, lock, interpreter.budget(), [&]() {
+      return task.done.load();
+    });
+  }
+
+  if (task.error) {
+    throw LoxRuntimeError{ "join", *task.error };
+  }
+  return task.result.toObject(interpreter);
+}
+
+TaskPool::TaskPool(std::size_t workers)
+  : queues()
+  , queued(0UL)
+  , next_queue(0UL)
+  , mutex()
+  , changed()
+  , stopping(false)
+  , threads()
+{
+  for (auto i = 0UL; i < std::max(workers, 1UL); ++i) {
+    queues.push_back(std::make_unique<Queue>());
+  }
+  for (auto i = 0UL; i < queues.size(); ++i) {
+    threads.emplace_back([this, i]() { work(i); });
+  }
+}
+
+TaskPool::~TaskPool()
+{
+  {
+    auto lock = std::lock_guard{ mutex };
+    stopping = true;
+  }
+  changed.notify_all();
+  threads.clear();
+}
+
+TaskPool&
+TaskPool::shared()
+{
+  static auto pool =
+    TaskPool{ shared_workers ? shared_workers.load()
+                             : std::thread::hardware_concurrency() };
+  return pool;
+}
+
+void
+TaskPool::setSharedWorkers(std::size_t workers) noexcept
+{
+  shared_workers = workers;
+}
+
+void
+TaskPool::work(std::size_t index)
+{
+  auto interpreter = Interpreter{};
+  interpreter.snapshot();
+
+  worker = Worker{ this, index, &interpreter, false };
+  while (true) {
+    if (auto task = take(index)) {
+      run(interpreter, *task);
+      continue;
+    }
+    auto lock = std::unique_lock{ mutex };
+    changed.wait(lock, [&]() { return stopping || queued > 0UL; });
+    if (stopping) {
+      break;
+    }
+  }
+  worker = Worker{};
+}
+
+std::shared_ptr<TaskState>
+TaskPool::take(std::size_t index)
+{
+  {
+    auto& own = *queues[index];
+    auto lock = std::lock_guard{ own.mutex };
+    if (!own.tasks.empty()) {
+      auto task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      --queued;
+      return task;
+    }
+  }
+
+  for (auto i = 1UL; i < queues.size(); ++i) {
+    auto& other = *queues[(index + i) % queues.size()];
+    auto lock = std::lock_guard{ other.mutex };
+    if (!other.tasks.empty()) {
+      auto task = std::move(other.tasks.front());
+      other.tasks.pop_front();
+      --queued;
+      return task;
+    }
+  }
+
+  return nullptr;
+}
+
+void
+TaskPool::run(Interpreter& interpreter, TaskState& task)
+{
+  auto body = [&]() {
+    install(interpreter, task);
+    auto budget = std::exchange(interpreter.budget(), task.budget);
+
+    try {
+      auto fn = task.fn.toObject(interpreter);
+      auto args = std::vector<Object>{};
+      for (auto& arg : task.args) {
+        args.push_back(std::move(arg).toObject(interpreter));
+      }
+      task.result =
+        Portable::from(interpreter, interpreter.call(fn, args), "Result");
+    } catch (std::exception const& err) {
+      task.error = err.what();
+    }
+    interpreter.budget() = budget;
+  };
+
+  auto nested = std::exchange(worker.running, true);
+  if (nested) {
+    // the joining task further up the stack keeps its globals
+    interpreter.withOwnGlobals(body);
+  } else {
+    body();
+  }
+  worker.running = nested;
+
+  {
+    auto lock = std::lock_guard{ mutex };
+    task.done = true;
+  }
+  changed.notify_all();
+}
+
+void
+TaskPool::push(std::shared_ptr<TaskState> task)
+{
+  auto index = worker.pool == this ? worker.index
+                                   : next_queue++ % queues.size();
+  {
+    auto& queue = *queues[index];
+    auto lock = std::lock_guard{ queue.mutex };
+    queue.tasks.push_back(std::move(task));
+  }
+
+  {
+    // no worker may miss the increment between checking and waiting
+    auto lock = std::lock_guard{ mutex };
+    ++queued;
+  }
+  changed.notify_all();
+}
+
+namespace {
+
+#pragma region natives
+
+Object
+spawn(Interpreter& interpreter, Arguments args)
+{
+  if (args.empty()) {
+    throw LoxRuntimeError{ "spawn", "Argument 1 must be a function." };
+  }
+  return Object{ std::shared_ptr<NativeObject>{
+    TaskPool::shared().spawn(interpreter, args[0], args.subspan(1UL)) } };
+}
+
+Object
+join(Interpreter& interpreter, Arguments args)
+{
+  auto const* task = args[0].native<TaskHandle>();
+  if (!task) {
+    throw LoxRuntimeError{ "join", "Argument 1 must be a task." };
+  }
+  return TaskPool::shared().join(interpreter, *task);
+}
+
+double
+workers()
+{
+  return static_cast<double>(TaskPool::shared().workers());
+}
+
+#pragma endregion
+
+} // namespace
+
+NativeModule
+taskModule()
+{
+  auto module = NativeModule{ "task" };
+  module.function("spawn", &spawn, Callable::variadic)
+    .function("join", &join, 1UL)
+    .function<&workers>("workers");
+  addChannel(module);
+  return module;
+}
+
+} // namespace Lox
\ No newline at end of file
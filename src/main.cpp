@@ -1,12 +1,33 @@
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
 #include <vector>
 
+#include <fcntl.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <sys/wait.h>
+
 #include <ExpressionPrinter.hpp>
 #include <Interpreter.hpp>
-#include <Parser.hpp>
-#include <Scanner.hpp>
+#include <NativeModule.hpp>
+#include <Program.hpp>
+#include <Server.hpp>
+#include <TaskPool.hpp>
 
 std::vector<char>
 readFromFile(char const* path_str)
@@ -31,33 +52,522 @@ readFromFile(char const* path_str)
   return buffer;
 }
 
-template<typename T>
+std::shared_ptr<Lox::Program const>
+compile(std::vector<char> const& src)
+{
+  return Lox::Program::compile(std::string_view{ src.data(), src.size() });
+}
+
+struct Options
+{
+  std::optional<size_t> max_depth;
+  std::optional<Lox::MemoOptions> memo;
+  std::optional<Lox::JitOptions> jit;
+  std::optional<Lox::BudgetOptions> budget;
+  std::vector<std::string_view> modules;
+  bool stats = false;
+  // executions of each script, each in a fresh interpreter
+  size_t repeat = 1UL;
+  // scan and parse again for every execution instead of reusing the program
+  bool reparse = false;
+  // run every execution in the same interpreter, reset to its snapshot
+  bool reuse = false;
+  // run before scripts, once per interpreter
+  std::shared_ptr<Lox::Program const> prelude;
+};
+
+void
+configure(Lox::Interpreter& interpreter, Options const& options)
+{
+  if (options.max_depth) {
+    interpreter.setMaxCallDepth(*options.max_depth);
+  }
+  if (options.memo) {
+    interpreter.enableMemoization(*options.memo);
+  }
+  if (options.jit) {
+    auto jit = *options.jit;
+    jit.measure = options.stats;
+    interpreter.enableJit(jit);
+  }
+  if (options.budget) {
+    interpreter.setBudget(*options.budget);
+  }
+  for (auto module : options.modules) {
+    interpreter.load(module);
+  }
+  if (options.prelude) {
+    interpreter.interpret(options.prelude);
+  }
+}
+
 void
-run(T const& src, Lox::Interpreter& interpreter)
+printStats(Lox::Interpreter& interpreter, std::ostream& err)
 {
-  auto scanner = Lox::Scanner{ src };
-  auto tokens = scanner.scanTokens();
-  auto parser = Lox::Parser{ tokens };
+  if (auto* memo = interpreter.memoizer()) {
+    for (auto const& s : memo->stats()) {
+      err << "memo " << s.function << ": " << s.hits << " hits, " << s.misses
+          << " misses, " << s.entries << " entries, " << s.bytes
+          << " bytes, " << s.evictions << " evictions" << std::endl;
+    }
+    err << "memo total: " << memo->bytes() << " bytes, peak "
+        << memo->peakBytes() << " bytes" << std::endl;
+  }
 
-  auto statements = parser.parse();
+  if (auto* jit = interpreter.jit()) {
+    for (auto const& s : jit->stats()) {
+      err << "jit " << s.function << ": ";
+      if (!s.unsupported.empty()) {
+        err << "not compiled (" << s.unsupported << ")" << std::endl;
+        continue;
+      }
 
-  interpreter.interpret(statements);
+      err << "compiled in "
+          << std::chrono::duration_cast<std::chrono::microseconds>(
+               s.compile_time)
+               .count()
+          << " us, " << s.code_bytes << " bytes, " << s.native_calls
+          << " native calls, " << s.bailouts << " bailouts";
+      if (s.speedup) {
+        err << ", " << *s.speedup << "x faster than interpreted";
+      }
+      err << std::endl;
+    }
+  }
 }
 
+/**
+ * Runs every script in an interpreter of its own, up to jobs of them
+ * at the same time. Output of each script is collected separately and
+ * written in the order of paths as soon as all scripts before it are done.
+ * Fails if any script could not be run or ended in a runtime error.
+ * */
 int
-main(int argc, char** argv)
+runBatch(std::vector<char const*> const& paths,
+         Options const& options,
+         size_t jobs)
 {
-  auto interpreter = Lox::Interpreter{};
-  if (argc > 2) {
-    std::cout << "Usage: cpplox [file]" << std::endl;
+  struct Result
+  {
+    std::ostringstream out;
+    std::ostringstream err;
+    bool done = false;
+  };
+
+  /**
+   * A script given several times is compiled once, by whichever
+   * worker gets to it first, and shared by all its runs.
+   * */
+  struct Source
+  {
+    std::once_flag compiled;
+    std::shared_ptr<Lox::Program const> program;
+    std::string error;
+  };
+
+  auto sources = std::map<std::string_view, Source>{};
+  for (auto const* path : paths) {
+    sources.try_emplace(path);
+  }
+
+  auto results = std::vector<Result>(paths.size());
+  auto next = std::atomic<size_t>{ 0UL };
+  auto failed = std::atomic<bool>{ false };
+  auto mutex = std::mutex{};
+  auto finished = std::condition_variable{};
+
+  auto work = [&]() {
+    for (auto i = next++; i < paths.size(); i = next++) {
+      auto& source = sources.at(paths[i]);
+      auto& result = results[i];
+      try {
+        std::call_once(source.compiled, [&]() {
+          try {
+            source.program = compile(readFromFile(paths[i]));
+          } catch (std::exception const& err) {
+            source.error = err.what();
+          }
+        });
+        if (!source.program) {
+          throw std::runtime_error{ source.error };
+        }
+
+        // before configuring, the prelude prints as well
+        auto interpreter = Lox::Interpreter{};
+        interpreter.setOutput(result.out);
+        configure(interpreter, options);
+        if (!interpreter.interpret(source.program)) {
+          failed = true;
+        }
+        if (options.stats) {
+          printStats(interpreter, result.err);
+        }
+      } catch (std::exception const& err) {
+        result.err << paths[i] << ": " << err.what() << std::endl;
+        failed = true;
+      }
+
+      {
+        auto lock = std::lock_guard{ mutex };
+        result.done = true;
+      }
+      finished.notify_all();
+    }
+  };
+
+  auto workers = std::vector<std::jthread>{};
+  for (auto i = 0UL; i < std::min(jobs, paths.size()); ++i) {
+    workers.emplace_back(work);
+  }
+
+  for (auto& result : results) {
+    {
+      auto lock = std::unique_lock{ mutex };
+      finished.wait(lock, [&]() { return result.done; });
+    }
+    std::cout << result.out.str() << std::flush;
+    std::cerr << result.err.str() << std::flush;
+  }
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/**
+ * Serves scripts on socket with workers interpreters until SIGINT
+ * or SIGTERM, see Lox::Server.
+ * */
+int
+runServer(std::string const& socket, Options const& options, size_t workers)
+{
+  // blocked before any thread starts, so only the waiter below gets them
+  auto signals = sigset_t{};
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+  auto server = std::optional<Lox::Server>{};
+  try {
+    server.emplace(Lox::ServerOptions{
+      .path = socket,
+      .workers = workers,
+      .configure =
+        [&options](Lox::Interpreter& interpreter) {
+          configure(interpreter, options);
+        },
+    });
+  } catch (std::exception const& err) {
+    std::cerr << err.what() << std::endl;
     return EXIT_FAILURE;
-  } else if (argc == 2) {
-    auto buf = readFromFile(argv[1]);
-    run(buf, interpreter);
-  } else {
+  }
+
+  auto waiter = std::jthread{ [&]() {
+    auto signal = 0;
+    sigwait(&signals, &signal);
+    server->stop();
+  } };
+
+  std::cerr << "Serving on " << socket << " with " << workers << " workers."
+            << std::endl;
+  auto status = EXIT_SUCCESS;
+  try {
+    server->run();
+  } catch (std::exception const& err) {
+    std::cerr << err.what() << std::endl;
+    status = EXIT_FAILURE;
+  }
+
+  // the waiter is still in sigwait() unless a signal stopped the server
+  pthread_kill(waiter.native_handle(), SIGTERM);
+  return status;
+}
+
+/**
+ * Runs `cpplox path` in a new process with its output discarded,
+ * the baseline the server is measured against.
+ * */
+int
+spawnScript(std::string const& path)
+{
+  auto actions = posix_spawn_file_actions_t{};
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY, 0);
+  posix_spawn_file_actions_addopen(&actions, 2, "/dev/null", O_WRONLY, 0);
+
+  auto name = std::string{ "cpplox" };
+  auto arg = path;
+  char* argv[] = { name.data(), arg.data(), nullptr };
+
+  auto pid = pid_t{};
+  auto err = posix_spawn(
+    &pid, "/proc/self/exe", &actions, nullptr, argv, environ);
+  posix_spawn_file_actions_destroy(&actions);
+  if (err != 0) {
+    throw std::system_error{ err, std::generic_category(), "spawn" };
+  }
+
+  auto status = 0;
+  while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+  }
+  return WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_FAILURE;
+}
+
+/**
+ * Runs the script at path count times, jobs of them at a time, on the
+ * server at socket or in a new process each if there is none. Reports
+ * throughput and latency, the scripts' output is discarded.
+ * */
+int
+runLoadTest(char const* path,
+            std::optional<std::string> const& socket,
+            size_t count,
+            size_t jobs)
+{
+  using Clock = std::chrono::steady_clock;
+
+  auto script = std::filesystem::absolute(path).string();
+  auto latencies = std::vector<Clock::duration>(count);
+  auto next = std::atomic<size_t>{ 0UL };
+  auto failures = std::atomic<size_t>{ 0UL };
+
+  auto work = [&]() {
+    auto discard = std::ostream{ nullptr };
+    for (auto i = next++; i < count; i = next++) {
+      auto start = Clock::now();
+      auto status = EXIT_FAILURE;
+      try {
+        status = socket ? Lox::runOnServer(
+                            *socket,
+                            { Lox::ScriptRequest::Kind::path, script },
+                            discard,
+                            discard)
+                        : spawnScript(script);
+      } catch (std::exception const&) {
+      }
+      latencies[i] = Clock::now() - start;
+      if (status != EXIT_SUCCESS) {
+        ++failures;
+      }
+    }
+  };
+
+  auto start = Clock::now();
+  {
+    auto workers = std::vector<std::jthread>{};
+    for (auto i = 0UL; i < std::min(jobs, count); ++i) {
+      workers.emplace_back(work);
+    }
+  }
+  auto elapsed = std::chrono::duration<double>(Clock::now() - start);
+
+  std::ranges::sort(latencies);
+  auto percentile = [&](size_t p) {
+    auto rank = std::max((count * p + 99UL) / 100UL, 1UL);
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+             latencies[rank - 1UL])
+      .count();
+  };
+
+  std::cout << count << " jobs "
+            << (socket ? "on " + *socket : std::string{ "in new processes" })
+            << ", " << jobs << " at a time: " << count / elapsed.count()
+            << " jobs/s, p50 " << percentile(50UL) << " us, p99 "
+            << percentile(99UL) << " us";
+  if (failures > 0UL) {
+    std::cout << ", " << failures << " failed";
+  }
+  std::cout << std::endl;
+
+  return failures > 0UL ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/**
+ * The whole of arg as a non-negative integer,
+ * std::invalid_argument if it is anything else.
+ * */
+std::uint64_t
+parseNumber(std::string_view arg)
+{
+  auto res = std::uint64_t{};
+  auto [end, err] = std::from_chars(arg.data(), arg.data() + arg.size(), res);
+  if (err != std::errc{} || end != arg.data() + arg.size()) {
+    throw std::invalid_argument{ std::string{ arg } };
+  }
+  return res;
+}
+
+int
+usage()
+{
+  std::cout << "Usage: cpplox [--max-depth N] [--memo] [--memo-limit BYTES] "
+               "[--jit] [--jit-threshold CALLS] [--fuel N] [--timeout MS] "
+               "[--heap-limit BYTES] [--module NAME]... [--stats] "
+               "[--prelude FILE] [--jobs N] [--workers N] "
+               "[--repeat N [--reparse] [--reuse]] "
+               "[--serve SOCKET] [--connect SOCKET [--load-test N]] [file...]"
+            << std::endl;
+  return EXIT_FAILURE;
+}
+
+int
+main(int argc, char** argv)
+{
+  auto options = Options{};
+  auto paths = std::vector<char const*>{};
+  auto jobs = std::optional<size_t>{};
+  auto serve = std::optional<std::string>{};
+  auto connect = std::optional<std::string>{};
+  auto load_test = std::optional<size_t>{};
+
+  try {
+    for (auto i = 1; i < argc; ++i) {
+      auto arg = std::string_view{ argv[i] };
+      if (arg == "--max-depth" && i + 1 < argc) {
+        options.max_depth = parseNumber(argv[++i]);
+        if (*options.max_depth > Lox::Interpreter::limit_max_call_depth) {
+          throw std::invalid_argument{ "--max-depth" };
+        }
+      } else if (arg == "--memo") {
+        options.memo = options.memo.value_or(Lox::MemoOptions{});
+      } else if (arg == "--memo-limit" && i + 1 < argc) {
+        options.memo = options.memo.value_or(Lox::MemoOptions{});
+        options.memo->max_bytes = parseNumber(argv[++i]);
+      } else if (arg == "--jit") {
+        options.jit = options.jit.value_or(Lox::JitOptions{});
+      } else if (arg == "--jit-threshold" && i + 1 < argc) {
+        options.jit = options.jit.value_or(Lox::JitOptions{});
+        options.jit->threshold = parseNumber(argv[++i]);
+      } else if (arg == "--fuel" && i + 1 < argc) {
+        options.budget = options.budget.value_or(Lox::BudgetOptions{});
+        options.budget->fuel = parseNumber(argv[++i]);
+      } else if (arg == "--timeout" && i + 1 < argc) {
+        options.budget = options.budget.value_or(Lox::BudgetOptions{});
+        options.budget->time =
+          std::chrono::milliseconds{ parseNumber(argv[++i]) };
+      } else if (arg == "--heap-limit" && i + 1 < argc) {
+        options.budget = options.budget.value_or(Lox::BudgetOptions{});
+        options.budget->heap_bytes = parseNumber(argv[++i]);
+      } else if (arg == "--module" && i + 1 < argc) {
+        options.modules.emplace_back(argv[++i]);
+      } else if (arg == "--stats") {
+        options.stats = true;
+      } else if (arg == "--repeat" && i + 1 < argc) {
+        options.repeat = parseNumber(argv[++i]);
+      } else if (arg == "--reparse") {
+        options.reparse = true;
+      } else if (arg == "--reuse") {
+        options.reuse = true;
+      } else if (arg == "--prelude" && i + 1 < argc) {
+        auto const* path = argv[++i];
+        try {
+          options.prelude = compile(readFromFile(path));
+        } catch (std::runtime_error const& err) {
+          std::cerr << path << ": " << err.what() << std::endl;
+          return EXIT_FAILURE;
+        }
+      } else if (arg == "--jobs" && i + 1 < argc) {
+        jobs = std::max(parseNumber(argv[++i]), 1UL);
+      } else if (arg == "--workers" && i + 1 < argc) {
+        Lox::TaskPool::setSharedWorkers(std::max(parseNumber(argv[++i]), 1UL));
+      } else if (arg == "--serve" && i + 1 < argc) {
+        serve = argv[++i];
+      } else if (arg == "--connect" && i + 1 < argc) {
+        connect = argv[++i];
+      } else if (arg == "--load-test" && i + 1 < argc) {
+        load_test = std::max(parseNumber(argv[++i]), 1UL);
+      } else if (!arg.starts_with("--")) {
+        paths.push_back(argv[i]);
+      } else {
+        return usage();
+      }
+    }
+  } catch (std::invalid_argument const&) {
+    // a flag's number that isn't one
+    return usage();
+  }
+
+  for (auto module : options.modules) {
+    if (!Lox::NativeModule::find(module)) {
+      std::cerr << "Unknown module '" << module << "'." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (serve) {
+    auto workers = std::max(std::thread::hardware_concurrency(), 1U);
+    return runServer(*serve, options, jobs.value_or(workers));
+  }
+
+  if (load_test) {
+    if (paths.size() != 1UL) {
+      return usage();
+    }
+    return runLoadTest(paths.front(), connect, *load_test, jobs.value_or(1UL));
+  }
+
+  if (connect) {
+    if (paths.size() > 1UL) {
+      return usage();
+    }
+
+    // the server reads a path itself, source comes from stdin
+    auto script = paths.empty() ? std::string{ std::istreambuf_iterator{
+                                                 std::cin },
+                                               {} }
+                                : std::filesystem::absolute(paths.front())
+                                    .string();
+    auto kind = paths.empty() ? Lox::ScriptRequest::Kind::source
+                              : Lox::ScriptRequest::Kind::path;
+    try {
+      return Lox::runOnServer(*connect, { kind, script }, std::cout, std::cerr);
+    } catch (std::exception const& err) {
+      std::cerr << err.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (jobs || paths.size() > 1UL) {
+    return runBatch(paths, options, jobs.value_or(1UL));
+  }
+
+  if (paths.empty()) {
+    auto interpreter = Lox::Interpreter{};
+    configure(interpreter, options);
     auto line = std::string{};
     while (std::getline(std::cin, line)) {
-      run(line, interpreter);
+      interpreter.interpret(Lox::Program::compile(line));
+    }
+    return EXIT_SUCCESS;
+  }
+
+  auto src = std::vector<char>{};
+  try {
+    src = readFromFile(paths.front());
+  } catch (std::runtime_error const& err) {
+    std::cerr << paths.front() << ": " << err.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  auto program = compile(src);
+  auto interpreter = std::optional<Lox::Interpreter>{};
+  for (auto i = 0UL; i < options.repeat; ++i) {
+    if (options.reparse && i > 0UL) {
+      program = compile(src);
+    }
+
+    if (options.reuse && interpreter) {
+      interpreter->reset();
+    } else {
+      interpreter.emplace();
+      configure(*interpreter, options);
+      if (options.reuse) {
+        interpreter->snapshot();
+      }
+    }
+    interpreter->interpret(program);
+
+    if (options.stats && i + 1UL == options.repeat) {
+      printStats(*interpreter, std::cerr);
+      std::cerr << "object copies: " << Lox::Object::copies() << std::endl;
     }
   }
 }
\ No newline at end of file
@@ -0,0 +1,182 @@
+#include <chrono>
+
+#include <gtest/gtest.h>
+
+#include <Interpreter.hpp>
+
+#include "TestHelpers.hpp"
+
+TEST(BudgetTest, FuelEndsRunawayLoops)
+{
+  auto interpreter = Lox::Interpreter{};
+  interpreter.setBudget({ .fuel = 100UL });
+
+  // 50 iterations and 50 calls
+  auto out = runProgram(interpreter,
+                        "fun f() {}"
+                        "for(var i = 0; i < 50; i = i + 1) { f(); }"
+                        "print \"done\";");
+  EXPECT_EQ(out, "done\n");
+  EXPECT_EQ(interpreter.budget().fuelUsed(), 100UL);
+
+  out = runProgram(interpreter,
+                   "var i = 0;"
+                   "while(i < 10) { print i; }");
+  EXPECT_TRUE(out.ends_with("Out of fuel.\n"));
+  EXPECT_EQ(interpreter.budget().fuelUsed(), 101UL);
+
+  // every run gets the whole budget again
+  out = runProgram(interpreter,
+                   "fun down(n) { if(n > 0) down(n - 1); }"
+                   "down(90);"
+                   "print \"again\";");
+  EXPECT_EQ(out, "again\n");
+}
+
+TEST(BudgetTest, DeadlineEndsRunawayLoops)
+{
+  auto interpreter = Lox::Interpreter{};
+  interpreter.setBudget({ .time = std::chrono::milliseconds{ 50 } });
+
+  auto start = std::chrono::steady_clock::now();
+  auto out = runProgram(interpreter,
+                        "fun spin() {"
+                        "  var n = 0;"
+                        "  while(true) { n = n + 1; }"
+                        "}"
+                        "spin();");
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  EXPECT_EQ(out, "Deadline exceeded.\n");
+  EXPECT_GE(elapsed, std::chrono::milliseconds{ 50 });
+  EXPECT_LT(elapsed, std::chrono::seconds{ 5 });
+}
+
+TEST(BudgetTest, HeapQuotaEndsStringGrowth)
+{
+  auto interpreter = Lox::Interpreter{};
+  interpreter.setBudget({ .heap_bytes = 1UL << 20 });
+
+  auto out = runProgram(interpreter,
+                        "var s = \"x\";"
+                        "while(true) { s = s + s; }");
+  EXPECT_EQ(out, "Heap quota exceeded.\n");
+  EXPECT_LE(interpreter.budget().allocatedBytes(), 2UL << 20);
+
+  out = runProgram(interpreter,
+                   "load(\"string\");"
+                   "var s = \"x\";"
+                   "while(true) { s = upper(s + s); }");
+  EXPECT_EQ(out, "Heap quota exceeded.\n");
+}
+
+TEST(BudgetTest, HeapQuotaCountsNativeBuffers)
+{
+  auto interpreter = Lox::Interpreter{};
+  interpreter.setBudget({ .heap_bytes = 1UL << 20 });
+
+  auto out = runProgram(interpreter,
+                        "load(\"string\");"
+                        "var b = StringBuilder();"
+                        "while(true) { builderAppend(b, \"0123456789\"); }");
+  EXPECT_EQ(out, "Heap quota exceeded.\n");
+  EXPECT_LE(interpreter.budget().allocatedBytes(), 3UL << 20);
+
+  out = runProgram(interpreter,
+                   "load(\"array\");"
+                   "var a = numberArray(0);"
+                   "while(true) { arrayPush(a, 1); }");
+  EXPECT_EQ(out, "Heap quota exceeded.\n");
+
+  out = runProgram(interpreter,
+                   "load(\"map\");"
+                   "var m = Map();"
+                   "var i = 0;"
+                   "while(true) { mapSet(m, i, i); i = i + 1; }");
+  EXPECT_EQ(out, "Heap quota exceeded.\n");
+
+  out = runProgram(interpreter,
+                   "load(\"array\");"
+                   "numberArray(1000000);");
+  EXPECT_EQ(out, "Heap quota exceeded.\n");
+}
+
+TEST(BudgetTest, JitStaysOffWhileMetered)
+{
+  auto interpreter = Lox::Interpreter{};
+  interpreter.enableJit({ .threshold = 0UL });
+  interpreter.setBudget({ .fuel = 1000UL });
+
+  auto out = runProgram(interpreter,
+                        "fun fib(n) {"
+                        "  if(n < 2) return n;"
+                        "  return fib(n - 1) + fib(n - 2);"
+                        "}"
+                        "print fib(30);");
+  EXPECT_EQ(out, "Out of fuel.\n");
+  EXPECT_TRUE(interpreter.jit()->stats().empty());
+}
+
+TEST(BudgetTest, TasksShareTheDeadline)
+{
+  auto interpreter = Lox::Interpreter{};
+  interpreter.setBudget({ .time = std::chrono::milliseconds{ 100 } });
+
+  auto start = std::chrono::steady_clock::now();
+  auto out = runProgram(interpreter,
+                        "load(\"task\");"
+                        "fun spin() { while(true) {} }"
+                        "join(spawn(spin));");
+  EXPECT_EQ(out, "Deadline exceeded.\n");
+
+  out = runProgram(interpreter,
+                   "load(\"task\");"
+                   "channelReceive(Channel(1));");
+  EXPECT_EQ(out, "Deadline exceeded.\n");
+
+  out = runProgram(interpreter,
+                   "load(\"task\");"
+                   "var c = Channel(1);"
+                   "channelSend(c, 1);"
+                   "channelSend(c, 2);"
+                   "channelSend(c, 3);");
+  EXPECT_EQ(out, "Deadline exceeded.\n");
+  EXPECT_LT(std::chrono::steady_clock::now() - start,
+            std::chrono::seconds{ 5 });
+}
+
+TEST(BudgetTest, DeadlineEndsPendingTimers)
+{
+  auto interpreter = Lox::Interpreter{};
+  interpreter.setBudget({ .time = std::chrono::milliseconds{ 100 } });
+
+  auto start = std::chrono::steady_clock::now();
+  auto out = runProgram(interpreter,
+                        "load(\"event\");"
+                        "fun late() { print \"fired\"; }"
+                        "setTimeout(late, 3000);");
+  EXPECT_EQ(out, "Deadline exceeded.\n");
+  EXPECT_LT(std::chrono::steady_clock::now() - start,
+            std::chrono::seconds{ 2 });
+}
+
+TEST(BudgetTest, TasksGetTheFuelLeft)
+{
+  auto interpreter = Lox::Interpreter{};
+  interpreter.setBudget({ .fuel = 1000UL });
+
+  auto out = runProgram(interpreter,
+                        "load(\"task\");"
+                        "fun spin() { while(true) {} }"
+                        "join(spawn(spin));");
+  EXPECT_EQ(out, "Out of fuel.\n");
+
+  out = runProgram(interpreter,
+                   "load(\"task\");"
+                   "fun count(n) {"
+                   "  for(var i = 0; i < n; i = i + 1) {}"
+                   "  return n;"
+                   "}"
+                   "print join(spawn(count, 100));");
+  EXPECT_EQ(out, "100.000000\n");
+}
\ No newline at end of file
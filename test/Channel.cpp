@@ -0,0 +1,166 @@
+#include <sstream>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <Channel.hpp>
+#include <Interpreter.hpp>
+#include <Program.hpp>
+
+#include "TestHelpers.hpp"
+
+TEST(ChannelTest, BoundedFifo)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto channel = Lox::Channel{ 3UL };
+  EXPECT_EQ(channel.capacity(), 4UL);
+
+  for (auto i = 0; i < 4; ++i) {
+    auto value = Lox::Portable::from(
+      interpreter, Lox::Object{ static_cast<double>(i) }, "value");
+    EXPECT_TRUE(channel.trySend(value));
+  }
+  auto extra = Lox::Portable{};
+  EXPECT_FALSE(channel.trySend(extra));
+
+  EXPECT_EQ(channel.tryReceive()->toObject(interpreter).number(), 0.0);
+  EXPECT_TRUE(channel.trySend(extra));
+
+  channel.close();
+  EXPECT_THROW(channel.send(Lox::Portable{}), Lox::LoxRuntimeError);
+  for (auto i = 1; i < 4; ++i) {
+    EXPECT_EQ(channel.receive()->toObject(interpreter).number(), i);
+  }
+  EXPECT_TRUE(channel.receive()->toObject(interpreter).isNull());
+  EXPECT_FALSE(channel.receive());
+}
+
+TEST(ChannelTest, CapacityIsChecked)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto out = runProgram(interpreter,
+                        "load(\"task\");"
+                        "print Channel(1048576);");
+  auto nan = runProgram(interpreter, "load(\"task\"); Channel(0 / 0);");
+  auto large = runProgram(interpreter, "load(\"task\"); Channel(1048577);");
+  auto zero = runProgram(interpreter, "load(\"task\"); Channel(0);");
+
+  auto const error = "Capacity must be between 1 and 1048576.\n";
+  EXPECT_EQ(out, "<channel 1048576>\n");
+  EXPECT_EQ(nan, error);
+  EXPECT_EQ(large, error);
+  EXPECT_EQ(zero, error);
+}
+
+TEST(ChannelTest, InterpretersOnThreads)
+{
+  constexpr auto producers = 3;
+  constexpr auto consumers = 2;
+
+  auto channel = std::make_shared<Lox::Channel>(8UL);
+  auto produce = Lox::Program::compile("load(\"task\");"
+                                       "for(var i = 1; i <= 1000; i = i + 1) {"
+                                       "  channelSend(channel, i);"
+                                       "}");
+  auto consume = Lox::Program::compile("load(\"task\");"
+                                       "var sum = 0;"
+                                       "var value = channelReceive(channel);"
+                                       "while(value != nil) {"
+                                       "  sum = sum + value;"
+                                       "  value = channelReceive(channel);"
+                                       "}"
+                                       "print sum;");
+
+  auto run = [&](std::shared_ptr<Lox::Program const> const& program) {
+    auto interpreter = Lox::Interpreter{};
+    interpreter.globalEnvironment()->define(
+      "channel", Lox::Object{ std::shared_ptr<Lox::NativeObject>{ channel } });
+    auto out = std::ostringstream{};
+    interpreter.setOutput(out);
+    interpreter.interpret(program);
+    return out.str();
+  };
+
+  auto sums = std::vector<std::string>(consumers);
+  auto receivers = std::vector<std::jthread>{};
+  for (auto i = 0; i < consumers; ++i) {
+    receivers.emplace_back([&, i]() { sums[i] = run(consume); });
+  }
+  {
+    auto senders = std::vector<std::jthread>{};
+    for (auto i = 0; i < producers; ++i) {
+      senders.emplace_back([&]() { run(produce); });
+    }
+  }
+  channel->close();
+  receivers.clear();
+
+  auto total = 0.0;
+  for (auto const& sum : sums) {
+    total += std::stod(sum);
+  }
+  EXPECT_EQ(total, producers * 500500.0);
+}
+
+TEST(ChannelTest, BetweenTasks)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto out = runProgram(interpreter,
+                        "load(\"task\");"
+                        "fun consume(channel) {"
+                        "  var count = 0;"
+                        "  while(channelReceive(channel) != nil) {"
+                        "    count = count + 1;"
+                        "  }"
+                        "  return count;"
+                        "}"
+                        "var channel = Channel(4);"
+                        "var consumer = spawn(consume, channel);"
+                        "for(var i = 0; i < 100; i = i + 1) {"
+                        "  channelSend(channel, \"item\");"
+                        "}"
+                        "channelClose(channel);"
+                        "print join(consumer);"
+                        "print channelTryReceive(channel);"
+                        "channelSend(channel, 1);");
+
+  EXPECT_EQ(out, "100.000000\nnil\nChannel is closed.\n");
+}
+TEST(ChannelTest, CloseRacingSends)
+{
+  constexpr auto senders = 4;
+
+  for (auto round = 0; round < 20; ++round) {
+    auto channel = Lox::Channel{ 64UL };
+    auto interpreter = Lox::Interpreter{};
+    auto succeeded = std::atomic<std::size_t>{ 0UL };
+
+    // sends that return did go through, the rest throw
+    auto threads = std::vector<std::jthread>{};
+    for (auto i = 0; i < senders; ++i) {
+      threads.emplace_back([&]() {
+        try {
+          while (true) {
+            channel.send(Lox::Portable{});
+            ++succeeded;
+          }
+        } catch (Lox::LoxRuntimeError const&) {
+        }
+      });
+    }
+
+    auto received = 0UL;
+    for (auto i = 0; i < 100; ++i) {
+      received += channel.receive() ? 1UL : 0UL;
+    }
+    channel.close();
+    while (channel.receive()) {
+      ++received;
+    }
+    threads.clear();
+
+    // nothing sent after close() returned, nothing sent before lost
+    EXPECT_FALSE(channel.tryReceive());
+    EXPECT_EQ(received, succeeded.load());
+  }
+}
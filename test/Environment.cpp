@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+
+#include <Environment.hpp>
+
+namespace {
+
+Lox::Token
+identifier(std::string const& name)
+{
+  return Lox::Token{ Lox::TokenType::IDENTIFIER, name };
+}
+
+} // namespace
+
+TEST(EnvironmentTest, OutgrowsInlineSlots)
+{
+  auto parent = std::make_shared<Lox::Environment>();
+  parent->define("outer", Lox::Object{ 1.0 });
+
+  auto env = Lox::Environment{ parent };
+  for (auto i = 0UL; i < 2 * Lox::Environment::inline_slots; ++i) {
+    env.define("v" + std::to_string(i), Lox::Object{ static_cast<double>(i) });
+  }
+  env.assign(identifier("v0"), Lox::Object{ 42.0 });
+  env.assign(identifier("outer"), Lox::Object{ 2.0 });
+
+  EXPECT_EQ(env.get(identifier("v0")).number(), 42.0);
+  EXPECT_EQ(env.get(identifier("v7")).number(), 7.0);
+  EXPECT_EQ(env.get(identifier("outer")).number(), 2.0);
+  EXPECT_EQ(env.cell("outer"), nullptr);
+  EXPECT_THROW(env.get(identifier("missing")), Lox::LoxRuntimeError);
+
+  env.clear();
+  EXPECT_EQ(env.cell("v0"), nullptr);
+  EXPECT_EQ(env.get(identifier("outer")).number(), 2.0);
+}
+
+TEST(EnvironmentTest, RootCellsStayPut)
+{
+  auto env = Lox::Environment{};
+  env.define("first", Lox::Object{ 1.0 });
+  auto* cell = env.cell("first");
+
+  for (auto i = 0UL; i < 100UL; ++i) {
+    env.define("v" + std::to_string(i), Lox::Object{});
+  }
+  env.define("first", Lox::Object{ 2.0 });
+
+  EXPECT_EQ(env.cell("first"), cell);
+  EXPECT_EQ(cell->number(), 2.0);
+}
+
+TEST(EnvironmentTest, PoolRecyclesFrames)
+{
+  auto pool = std::make_shared<Lox::EnvironmentPool>();
+  auto root = std::make_shared<Lox::Environment>();
+
+  for (auto i = 0; i < 100; ++i) {
+    auto env = pool->make(root);
+    env->define("x", Lox::Object{ 1.0 });
+  }
+
+  EXPECT_EQ(pool->allocations(), 1UL);
+  EXPECT_EQ(pool->reuses(), 99UL);
+
+  // an environment kept alive outlives the pool's owner
+  auto kept = pool->make(root);
+  pool.reset();
+  kept->define("y", Lox::Object{ 2.0 });
+  EXPECT_EQ(kept->cell("y")->number(), 2.0);
+}
+
+TEST(EnvironmentTest, RestoresSnapshot)
+{
+  auto env = Lox::Environment{};
+  EXPECT_FALSE(env.restore());
+
+  env.define("a", Lox::Object{ 1.0 });
+  env.define("b", Lox::Object{ 2.0 });
+  env.snapshot();
+
+  env.assign(identifier("a"), Lox::Object{ 10.0 });
+  env.assign(identifier("a"), Lox::Object{ 11.0 });
+  env.define("b", Lox::Object{ 20.0 });
+  env.define("c", Lox::Object{ 3.0 });
+  auto* cell = env.cell("b");
+  env.preserve(cell);
+  *cell = Lox::Object{ 21.0 };
+
+  EXPECT_TRUE(env.restore());
+  EXPECT_EQ(env.get(identifier("a")).number(), 1.0);
+  EXPECT_EQ(env.get(identifier("b")).number(), 2.0);
+  EXPECT_EQ(env.cell("c"), nullptr);
+
+  // the snapshot stays for the next round
+  env.define("c", Lox::Object{ 4.0 });
+  env.assign(identifier("b"), Lox::Object{ 22.0 });
+  EXPECT_TRUE(env.restore());
+  EXPECT_EQ(env.get(identifier("b")).number(), 2.0);
+  EXPECT_EQ(env.cell("c"), nullptr);
+  EXPECT_EQ(env.cell("b"), cell);
+}
\ No newline at end of file
@@ -0,0 +1,156 @@
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#include <csignal>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include <Interpreter.hpp>
+
+#include "TestHelpers.hpp"
+
+TEST(EventLoopTest, TimersFireInOrder)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto out = runProgram(interpreter,
+                        "load(\"event\");"
+                        "fun later(label) {"
+                        "  fun show() { print label; }"
+                        "  return show;"
+                        "}"
+                        "setTimeout(later(\"30\"), 30);"
+                        "setTimeout(later(\"10\"), 10);"
+                        "var cancelled = setTimeout(later(\"never\"), 20);"
+                        "setTimeout(later(\"0\"), 0);"
+                        "print clearTimeout(cancelled);"
+                        "print clearTimeout(cancelled);"
+                        "print \"sync\";");
+
+  EXPECT_EQ(out, "true\nfalse\nsync\n0\n10\n30\n");
+  EXPECT_FALSE(interpreter.eventLoop().pending());
+}
+
+TEST(EventLoopTest, DueTimersCanBeCancelled)
+{
+  auto interpreter = Lox::Interpreter{};
+  // both are due by the time the first runs
+  auto out = runProgram(interpreter,
+                        "load(\"event\");"
+                        "var b;"
+                        "fun runA() { print clearTimeout(b); }"
+                        "fun runB() { print \"b ran\"; }"
+                        "setTimeout(runA, 5);"
+                        "b = setTimeout(runB, 5);");
+
+  EXPECT_EQ(out, "true\n");
+  EXPECT_FALSE(interpreter.eventLoop().pending());
+}
+
+TEST(EventLoopTest, FilesRoundTrip)
+{
+  auto path = tempPath("round_trip.txt");
+  auto interpreter = Lox::Interpreter{};
+  auto out = runProgram(interpreter,
+                        "load(\"event\");"
+                        "var path = \"" + path.string() + "\";"
+                        "fun missing(data, error) { print error; }"
+                        "fun read(data, error) {"
+                        "  print data;"
+                        "  print error;"
+                        "  readFile(\"/nonexistent/lox\", missing);"
+                        "}"
+                        "fun written(error) {"
+                        "  print error;"
+                        "  readFile(path, read);"
+                        "}"
+                        "writeFile(path, \"hello\", written);");
+
+  EXPECT_EQ(out,
+            "nil\n"
+            "hello\n"
+            "nil\n"
+            "/nonexistent/lox: No such file or directory\n");
+  std::filesystem::remove(path);
+}
+
+TEST(EventLoopTest, ReadsPipeWithoutBlocking)
+{
+  auto path = tempPath("fifo");
+  ASSERT_EQ(mkfifo(path.c_str(), 0600), 0);
+
+  auto writer = std::jthread{ [&]() {
+    auto fifo = std::ofstream{ path };
+    fifo << "piped";
+  } };
+
+  auto interpreter = Lox::Interpreter{};
+  auto out = runProgram(interpreter,
+                        "load(\"event\");"
+                        "fun read(data, error) { print data; }"
+                        "readFile(\"" + path.string() + "\", read);"
+                        "print \"sync\";");
+
+  EXPECT_EQ(out, "sync\npiped\n");
+  writer.join();
+  std::filesystem::remove(path);
+}
+
+TEST(EventLoopTest, ClosedPipeFailsTheWrite)
+{
+  auto path = tempPath("closed_fifo");
+  ASSERT_EQ(mkfifo(path.c_str(), 0600), 0);
+
+  // the reader goes away once the pipe is full
+  auto reader = open(path.c_str(), O_RDONLY | O_NONBLOCK);
+  ASSERT_GE(reader, 0);
+  auto closer = std::jthread{ [&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds{ 50 });
+    close(reader);
+  } };
+
+  auto interpreter = Lox::Interpreter{};
+  auto out = runProgram(interpreter,
+                        "load(\"event\");"
+                        "var data = \"x\";"
+                        "for(var i = 0; i < 20; i = i + 1) { data = data + data; }"
+                        "fun written(error) { print error; }"
+                        "writeFile(\"" + path.string() + "\", data, written);");
+
+  EXPECT_EQ(out, path.string() + ": Broken pipe\n");
+
+  // nothing changed about SIGPIPE for the rest of the process
+  struct sigaction action{};
+  sigaction(SIGPIPE, nullptr, &action);
+  EXPECT_EQ(action.sa_handler, SIG_DFL);
+
+  closer.join();
+  std::filesystem::remove(path);
+}
+
+TEST(EventLoopTest, CallbackErrorsStopTheLoop)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto out = runProgram(interpreter,
+                        "load(\"event\");"
+                        "fun fail() { return nil + 1; }"
+                        "fun later() { print \"later\"; }"
+                        "setTimeout(fail, 0);"
+                        "setTimeout(later, 5);");
+  EXPECT_EQ(out, "Operands must be two numbers or two strings\n");
+
+  // the rest stays pending for the next script
+  out = runProgram(interpreter, "setTimeout(later, -1);");
+  EXPECT_EQ(out, "Argument 2 must be a number of milliseconds.\n");
+  out = runProgram(interpreter, "setTimeout(later, 0);");
+  EXPECT_EQ(out, "later\nlater\n");
+
+  out = runProgram(interpreter, "setTimeout(fail, 0);");
+  EXPECT_EQ(out, "Operands must be two numbers or two strings\n");
+  out = runProgram(interpreter, "readFile(\"/\", later);");
+  EXPECT_EQ(out, "Argument 2 must be a function taking 2 arguments.\n");
+}
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include <csignal>
+#include <filesystem>
+
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include <File.hpp>
+#include <Interpreter.hpp>
+
+#include "TestHelpers.hpp"
+
+TEST(FileTest, WriteThenIterateLines)
+{
+  auto path = tempPath("lines.txt");
+  auto interpreter = Lox::Interpreter{};
+  auto out = runProgram(interpreter,
+                        "var path = \"" + path.string() + "\";"
+                        "var out = createFile(path);"
+                        "fileWriteLine(out, \"first\");"
+                        "fileWriteLine(out, \"\");"
+                        "fileWrite(out, 3);"
+                        "fileWrite(out, true);"
+                        "fileClose(out);"
+                        "fileClose(out);"
+                        "var file = openFile(path);"
+                        "print file;"
+                        "print fileSize(file);"
+                        "var lines = fileLines(file);"
+                        "while(hasNext(lines)) print \"[\" + next(lines) + \"]\";"
+                        "print next(lines);"
+                        "print fileText(file) == \"first\" + \"\n\n3.000000true\";"
+                        "fileWrite(out, 1);");
+
+  EXPECT_EQ(out,
+            "<file " + path.string() +
+              ">\n"
+              "19.000000\n"
+              "[first]\n"
+              "[]\n"
+              "[3.000000true]\n"
+              "nil\n"
+              "true\n"
+              "File is closed.\n");
+  std::filesystem::remove(path);
+}
+
+TEST(FileTest, LinesAcrossBufferAndLineEndings)
+{
+  auto path = tempPath("large.txt");
+  {
+    auto writer = Lox::FileWriter{ path.string() };
+    auto long_line = std::string(Lox::FileWriter::buffer_size * 2UL, 'x');
+    writer.write("a\r\n");
+    writer.write(long_line);
+    writer.write("\nlast");
+  }
+
+  auto interpreter = Lox::Interpreter{};
+  auto file = std::make_shared<Lox::MappedFile>(path.string());
+  auto lines = Lox::LineIterator{ file };
+  EXPECT_EQ(lines.next(interpreter).string(), "a");
+  EXPECT_EQ(lines.next(interpreter).string().size(),
+            Lox::FileWriter::buffer_size * 2UL);
+  EXPECT_TRUE(lines.hasNext(interpreter));
+  EXPECT_EQ(lines.next(interpreter).string(), "last");
+  EXPECT_FALSE(lines.hasNext(interpreter));
+  std::filesystem::remove(path);
+
+  // the mapping outlives the file's name
+  EXPECT_EQ(file->contents().substr(0UL, 3UL), "a\r\n");
+}
+
+TEST(FileTest, TruncatedWhileOpen)
+{
+  auto path = tempPath("truncated.txt");
+  {
+    auto writer = Lox::FileWriter{ path.string() };
+    writer.write(std::string(Lox::FileWriter::buffer_size, 'x'));
+  }
+
+  auto interpreter = Lox::Interpreter{};
+  auto out = runProgram(interpreter,
+                        "var file = openFile(\"" + path.string() + "\");"
+                        "print fileSize(file);");
+  std::filesystem::resize_file(path, 0UL);
+  out += runProgram(interpreter,
+                    "print fileText(file) == \"\";"
+                    "print \"unreachable\";");
+  out += runProgram(interpreter, "print next(fileLines(file));");
+
+  EXPECT_EQ(out,
+            "65536.000000\n" + path.string() +
+              ": File was truncated while open.\n" + path.string() +
+              ": File was truncated while open.\n");
+  std::filesystem::remove(path);
+}
+
+TEST(FileTest, SigbusOutsideOfReadsReachesThePreviousHandler)
+{
+  GTEST_FLAG_SET(death_test_style, "threadsafe");
+
+  auto path = tempPath("sigbus.txt");
+  {
+    auto writer = Lox::FileWriter{ path.string() };
+    writer.write("x");
+  }
+
+  // run in a process of its own, so the handler is installed afresh
+  EXPECT_EXIT(
+    {
+      std::signal(SIGBUS, [](int) { _exit(42); });
+      auto file = Lox::MappedFile{ path.string() };
+      file.read(0UL, 1UL);
+      std::raise(SIGBUS);
+    },
+    testing::ExitedWithCode(42),
+    "");
+  std::filesystem::remove(path);
+}
+
+TEST(FileTest, Errors)
+{
+  auto empty = tempPath("empty.txt");
+  Lox::FileWriter{ empty.string() }.close();
+
+  auto interpreter = Lox::Interpreter{};
+  auto out = runProgram(interpreter,
+                        "var file = openFile(\"" + empty.string() + "\");"
+                        "print fileSize(file);"
+                        "print hasNext(fileLines(file));"
+                        "openFile(\"/nonexistent/lox\");");
+  EXPECT_EQ(out, "0.000000\nfalse\n/nonexistent/lox: No such file or directory\n");
+
+  out = runProgram(interpreter, "createFile(\"/nonexistent/lox\");");
+  EXPECT_EQ(out, "/nonexistent/lox: No such file or directory\n");
+  std::filesystem::remove(empty);
+}
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+#include <Interpreter.hpp>
+#include <Parser.hpp>
+#include <Resolver.hpp>
+#include <Scanner.hpp>
+
+#include "TestHelpers.hpp"
+
+TEST(GeneratorTest, ResumesInsideLoopsAndBranches)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto out = runProgram(interpreter,
+                        "fun evens(n) {"
+                        "  print \"start\";"
+                        "  var even = true;"
+                        "  for(var i = 0; i < n; i = i + 1) {"
+                        "    if (even) {"
+                        "      var half = i / 2;"
+                        "      yield half;"
+                        "    } else {"
+                        "      print \"odd\";"
+                        "    }"
+                        "    even = !even;"
+                        "  }"
+                        "  yield \"end\";"
+                        "}"
+                        "var gen = evens(4);"
+                        "print gen;"
+                        "while(hasNext(gen)) {"
+                        "  print next(gen);"
+                        "}"
+                        "print next(gen);"
+                        "print hasNext(gen);");
+
+  EXPECT_EQ(out,
+            "<generator evens>\n"
+            "start\n"
+            "0.000000\n"
+            "odd\n"
+            "1.000000\n"
+            "odd\n"
+            "end\n"
+            "nil\n"
+            "false\n");
+}
+
+TEST(GeneratorTest, LazyPipeline)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto out = runProgram(interpreter,
+                        "fun naturals() {"
+                        "  var n = 0;"
+                        "  while(true) {"
+                        "    n = n + 1;"
+                        "    yield n;"
+                        "  }"
+                        "}"
+                        "fun squares(gen) {"
+                        "  while(hasNext(gen)) {"
+                        "    var n = next(gen);"
+                        "    fun square() { return n * n; }"
+                        "    yield square;"
+                        "  }"
+                        "}"
+                        "fun take(gen, count) {"
+                        "  while(count > 0 and hasNext(gen)) {"
+                        "    count = count - 1;"
+                        "    yield next(gen)();"
+                        "  }"
+                        "  return;"
+                        "  yield \"unreachable\";"
+                        "}"
+                        "var sum = 0;"
+                        "var gen = take(squares(naturals()), 100000);"
+                        "while(hasNext(gen)) sum = sum + next(gen);"
+                        "print sum;");
+
+  EXPECT_EQ(out, "333338333350000.000000\n");
+  EXPECT_EQ(interpreter.callDepth(), 0UL);
+}
+
+TEST(GeneratorTest, SuspendsBetweenCalls)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto out = runProgram(interpreter,
+                        "fun limit(n) { return n; }"
+                        "fun square(n) { return n * n; }"
+                        "fun squares(n) {"
+                        "  for(var i = 0; i < limit(n); i = i + 1) {"
+                        "    if (square(i) > 10) return square(i);"
+                        "    yield square(i) + square(i);"
+                        "  }"
+                        "}"
+                        "fun sum(gen) {"
+                        "  var total = 0;"
+                        "  while(hasNext(gen)) total = total + next(gen);"
+                        "  return total;"
+                        "}"
+                        "print sum(squares(3));"
+                        "print sum(squares(10));");
+
+  EXPECT_EQ(out, "10.000000\n28.000000\n");
+  EXPECT_EQ(interpreter.callDepth(), 0UL);
+}
+
+TEST(GeneratorTest, Errors)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto out = runProgram(interpreter,
+                        "fun failing() {"
+                        "  yield 1;"
+                        "  yield nil + 1;"
+                        "  yield 3;"
+                        "}"
+                        "var gen = failing();"
+                        "print next(gen);"
+                        "next(gen);");
+  EXPECT_EQ(out, "1.000000\nOperands must be two numbers or two strings\n");
+
+  out = runProgram(interpreter,
+                   "print hasNext(gen);"
+                   "fun recursive() { yield next(self); }"
+                   "var self = recursive();"
+                   "next(self);");
+  EXPECT_EQ(out, "false\nGenerator is already running.\n");
+
+  out = runProgram(interpreter, "yield 1;");
+  EXPECT_EQ(out, "Can't yield outside of a function.\n");
+
+  out = runProgram(interpreter, "next(1);");
+  EXPECT_EQ(out, "Argument 1 must be an iterator.\n");
+}
+
+TEST(GeneratorTest, BareStatements)
+{
+  // without a Program the declaration is cloned, marks included
+  auto tokens = Lox::Scanner{ "fun count(n) {"
+                              "  for(var i = 0; i < n; i = i + 1) yield i;"
+                              "}"
+                              "var gen = count(3);"
+                              "while(hasNext(gen)) print next(gen);" }
+                  .scanTokens();
+  auto statements = Lox::Parser{ tokens }.parse();
+  Lox::Resolver{}.resolve(statements);
+
+  auto interpreter = Lox::Interpreter{};
+  auto out = std::ostringstream{};
+  interpreter.setOutput(out);
+  interpreter.interpret(statements);
+
+  EXPECT_EQ(out.str(), "0.000000\n1.000000\n2.000000\n");
+}
\ No newline at end of file
@@ -0,0 +1,563 @@
+#include <sstream>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <Interpreter.hpp>
+#include <Parser.hpp>
+#include <PurityAnalyzer.hpp>
+#include <Resolver.hpp>
+#include <Scanner.hpp>
+
+namespace {
+
+std::string
+runScript(Lox::Interpreter& interpreter, std::string const& src)
+{
+  auto tokens = Lox::Scanner{ src }.scanTokens();
+  auto statements = Lox::Parser{ tokens }.parse();
+  Lox::Resolver{}.resolve(statements);
+  Lox::PurityAnalyzer{}.analyze(statements);
+
+  testing::internal::CaptureStdout();
+  interpreter.interpret(statements);
+  return testing::internal::GetCapturedStdout();
+}
+
+} // namespace
+
+TEST(InterpreterTest, DeepRecursion)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto out = runScript(interpreter,
+                       "fun down(n) {"
+                       "  if(n <= 0) return 0;"
+                       "  return 1 + down(n - 1);"
+                       "}"
+                       "print down(90000);");
+
+  EXPECT_EQ(out, "90000.000000\n");
+  EXPECT_EQ(interpreter.callDepth(), 0UL);
+}
+
+TEST(InterpreterTest, StackOverflow)
+{
+  auto interpreter = Lox::Interpreter{};
+  interpreter.setMaxCallDepth(100UL);
+
+  auto out = runScript(interpreter, "fun f(n) { return f(n + 1); } f(0);");
+
+  EXPECT_EQ(out, "Stack overflow.\n");
+  EXPECT_EQ(interpreter.callDepth(), 0UL);
+
+  // the interpreter stays usable after the overflow
+  out = runScript(interpreter, "print 1 + 2;");
+  EXPECT_EQ(out, "3.000000\n");
+
+  EXPECT_THROW(
+    interpreter.setMaxCallDepth(Lox::Interpreter::limit_max_call_depth + 1UL),
+    std::invalid_argument);
+  EXPECT_EQ(interpreter.maxCallDepth(), 100UL);
+}
+
+TEST(InterpreterTest, StackOverflowThroughNatives)
+{
+  // natives calling back into Lox are the calls that recurse natively
+  auto interpreter = Lox::Interpreter{};
+  auto out = runScript(interpreter,
+                       "load(\"map\");"
+                       "var m = Map();"
+                       "mapSet(m, 1, 1);"
+                       "fun dive(key, value) { mapEach(m, dive); }"
+                       "dive(1, 1);");
+
+  EXPECT_EQ(out, "Stack overflow.\n");
+  EXPECT_EQ(interpreter.callDepth(), 0UL);
+
+  out = runScript(interpreter, "print 1 + 2;");
+  EXPECT_EQ(out, "3.000000\n");
+}
+
+TEST(InterpreterTest, CountsCopies)
+{
+  auto tokens = Lox::Scanner{ "var s = \"a string\";"
+                              "for(var i = 0; i < 100; i = i + 1) {"
+                              "  var t = s;"
+                              "}" }
+                  .scanTokens();
+  auto statements = Lox::Parser{ tokens }.parse();
+  Lox::Resolver{}.resolve(statements);
+
+  auto interpreter = Lox::Interpreter{};
+  auto copies = Lox::Object::copies();
+
+  EXPECT_TRUE(interpreter.interpret(statements));
+  EXPECT_GE(Lox::Object::copies(), copies + 100UL);
+}
+
+TEST(InterpreterTest, GlobalRedefinition)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto out = runScript(interpreter,
+                       "var x = 1;"
+                       "fun f() { return x; }"
+                       "print f();"
+                       "var x = 2;"
+                       "print f();"
+                       "x = 3;"
+                       "print f();");
+
+  EXPECT_EQ(out, "1.000000\n2.000000\n3.000000\n");
+}
+
+TEST(InterpreterTest, LaterLocalDeclarationShadowsGlobal)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto out = runScript(interpreter,
+                       "var a = \"global\";"
+                       "{"
+                       "  fun show() { print a; }"
+                       "  show();"
+                       "  var a = \"block\";"
+                       "  show();"
+                       "}");
+
+  EXPECT_EQ(out, "global\nblock\n");
+}
+
+TEST(InterpreterTest, MemoizedPureFunction)
+{
+  auto interpreter = Lox::Interpreter{};
+  interpreter.enableMemoization();
+
+  auto out = runScript(interpreter,
+                       "fun fib(n) {"
+                       "  if(n <= 1) return n;"
+                       "  return fib(n - 2) + fib(n - 1);"
+                       "}"
+                       "print fib(30);");
+  EXPECT_EQ(out, "832040.000000\n");
+
+  auto stats = interpreter.memoizer()->stats();
+  ASSERT_EQ(stats.size(), 1UL);
+  EXPECT_EQ(stats.at(0).function, "fib");
+  EXPECT_EQ(stats.at(0).misses, 31UL);
+  EXPECT_EQ(stats.at(0).entries, 31UL);
+  EXPECT_GT(stats.at(0).hits, 0UL);
+}
+
+TEST(InterpreterTest, ImpureFunctionsAreNotMemoized)
+{
+  auto interpreter = Lox::Interpreter{};
+  interpreter.enableMemoization();
+
+  auto out = runScript(interpreter,
+                       "var k = 1;"
+                       "fun addK(n) { return n + k; }"
+                       "fun loud(n) { print n; return n; }"
+                       "print addK(1);"
+                       "k = 2;"
+                       "print addK(1);"
+                       "loud(3);"
+                       "loud(3);");
+
+  EXPECT_EQ(out, "2.000000\n3.000000\n3.000000\n3.000000\n");
+  EXPECT_TRUE(interpreter.memoizer()->stats().empty());
+}
+
+TEST(InterpreterTest, MemoizationRespectsMemoryCap)
+{
+  auto interpreter = Lox::Interpreter{};
+  interpreter.enableMemoization(Lox::MemoOptions{ 1000UL, 2048UL });
+
+  auto out = runScript(interpreter,
+                       "fun sq(n) { return n * n; }"
+                       "var sum = 0;"
+                       "for(var i = 0; i < 100; i = i + 1) {"
+                       "  sum = sum + sq(i) + sq(i);"
+                       "}"
+                       "print sum;");
+
+  EXPECT_EQ(out, "656700.000000\n");
+  EXPECT_LE(interpreter.memoizer()->bytes(), 2048UL);
+
+  auto stats = interpreter.memoizer()->stats();
+  ASSERT_EQ(stats.size(), 1UL);
+  EXPECT_GT(stats.at(0).evictions, 0UL);
+  EXPECT_EQ(stats.at(0).hits, 100UL);
+}
+
+TEST(InterpreterTest, MemoTablesCountAgainstCap)
+{
+  auto interpreter = Lox::Interpreter{};
+  interpreter.enableMemoization(Lox::MemoOptions{ 1000UL, 2048UL });
+
+  // every run declares a function of its own
+  for (auto i = 0; i < 50; ++i) {
+    runScript(interpreter, "fun sq(n) { return n * n; } sq(2); sq(3);");
+  }
+  EXPECT_LE(interpreter.memoizer()->bytes(), 2048UL);
+  EXPECT_LE(interpreter.memoizer()->stats().size(), 8UL);
+
+  interpreter.reset();
+  EXPECT_EQ(interpreter.memoizer()->bytes(), 0UL);
+  EXPECT_TRUE(interpreter.memoizer()->stats().empty());
+}
+
+TEST(InterpreterTest, RedefinedCalleesDropMemoizedResults)
+{
+  auto interpreter = Lox::Interpreter{};
+  interpreter.enableMemoization();
+
+  runScript(interpreter, "fun g(n) { return 1; } fun f(n) { return g(n); }");
+  auto out = runScript(interpreter,
+                       "print f(1);"
+                       "fun g(n) { return 2; }"
+                       "print f(1);"
+                       "g = nil;"
+                       "print f(1);");
+  EXPECT_EQ(out,
+            "1.000000\n"
+            "2.000000\n"
+            "Can only call functions and classes.\n");
+}
+
+TEST(InterpreterTest, RedefinitionsKeepUnrelatedResultsAndStats)
+{
+  auto interpreter = Lox::Interpreter{};
+  interpreter.enableMemoization();
+
+  runScript(interpreter,
+            "fun g(n) { return 1; }"
+            "fun f(n) { return g(n); }"
+            "fun sq(n) { return n * n; }"
+            "f(1); f(1); sq(2); sq(2);");
+  runScript(interpreter, "fun g(n) { return 2; }");
+
+  auto stats = interpreter.memoizer()->stats();
+  ASSERT_EQ(stats.size(), 3UL);
+  // f called the old g, sq didn't
+  EXPECT_EQ(stats.at(0).function, "f");
+  EXPECT_EQ(stats.at(0).entries, 0UL);
+  EXPECT_EQ(stats.at(0).bytes, 0UL);
+  EXPECT_EQ(stats.at(0).hits, 1UL);
+  EXPECT_EQ(stats.at(2).function, "sq");
+  EXPECT_EQ(stats.at(2).entries, 1UL);
+  EXPECT_EQ(stats.at(2).hits, 1UL);
+  EXPECT_GT(interpreter.memoizer()->peakBytes(),
+            interpreter.memoizer()->bytes());
+}
+
+TEST(InterpreterTest, JitMatchesInterpreter)
+{
+  auto src = std::string{ "fun f(a, b) {"
+                          "  if(a != a or b == 0) return -a;"
+                          "  if(!(a < b) and a >= 1) return f(a - 1, b) * 2;"
+                          "  return a / b + (a - b) * 0.5;"
+                          "}"
+                          "var nan = 0 / 0;"
+                          "print f(5, 3);"
+                          "print f(2, 0);"
+                          "print f(nan, 1);"
+                          "print f(1, nan);"
+                          "print f(-0.5, 4);" };
+
+  auto interpreted = Lox::Interpreter{};
+  auto expected = runScript(interpreted, src);
+
+  auto compiled = Lox::Interpreter{};
+  compiled.enableJit(Lox::JitOptions{ 0UL });
+  EXPECT_EQ(runScript(compiled, src), expected);
+
+  auto const& stats = compiled.jit()->stats();
+  ASSERT_EQ(stats.size(), 1UL);
+  if (Lox::Jit::isSupportedPlatform()) {
+    EXPECT_EQ(stats.at(0).unsupported, "");
+    EXPECT_EQ(stats.at(0).native_calls, 5UL);
+  }
+}
+
+TEST(InterpreterTest, JitFallsBackToInterpreter)
+{
+  auto interpreter = Lox::Interpreter{};
+  interpreter.setMaxCallDepth(1000UL);
+  interpreter.enableJit(Lox::JitOptions{ 0UL });
+
+  auto out = runScript(interpreter,
+                       "fun down(n) {"
+                       "  if(n <= 0) return 0;"
+                       "  return 1 + down(n - 1);"
+                       "}"
+                       "print down(\"a\" + \"b\");");
+  EXPECT_EQ(out, "Operand must be a number\n");
+
+  out = runScript(interpreter, "print down(500);");
+  EXPECT_EQ(out, "500.000000\n");
+
+  out = runScript(interpreter, "print down(5000);");
+  EXPECT_EQ(out, "Stack overflow.\n");
+
+  if (Lox::Jit::isSupportedPlatform()) {
+    EXPECT_EQ(interpreter.jit()->stats().at(0).native_calls, 1UL);
+    EXPECT_EQ(interpreter.jit()->stats().at(0).bailouts, 1UL);
+  }
+}
+
+TEST(InterpreterTest, IntegerArithmeticMatchesDoubles)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto out = runScript(interpreter,
+                       "print 7 + 3;"
+                       "print 7 - 10;"
+                       "print 6 * 7;"
+                       "print 7 / 2;"
+                       "print 0 * -1;"
+                       "print -0;"
+                       "print 1 / -0;"
+                       "print 9007199254740992 + 1;"
+                       "print 4294967296 * 4294967296;"
+                       "print 3 == 3.0;"
+                       "print 2 < 2.5;");
+
+  EXPECT_EQ(out,
+            "10.000000\n"
+            "-3.000000\n"
+            "42.000000\n"
+            "3.500000\n"
+            "-0.000000\n"
+            "-0.000000\n"
+            "-inf\n"
+            "9007199254740992.000000\n"
+            "18446744073709551616.000000\n"
+            "true\n"
+            "true\n");
+}
+
+TEST(InterpreterTest, CountedLoops)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto out = runScript(interpreter,
+                       // counter only read by the loop itself
+                       "var n = 0;"
+                       "for(var i = 0; i < 1000; i = i + 1) { n = n + 1; }"
+                       "print n;"
+                       // counter read and captured by the body
+                       "var f;"
+                       "for(var i = 2; i <= 10; i = i + 4) {"
+                       "  print i;"
+                       "  fun g() { return i; }"
+                       "  f = g;"
+                       "}"
+                       "print f();"
+                       // counter reassigned in the body, regular loop
+                       "for(var i = 0; i < 10; i = i + 1) { i = i + 4; print i; }"
+                       // non-integer start and bound
+                       "for(var i = 0.5; i < 2; i = i + 1) { print i; }"
+                       "for(var i = 0; i < 1.5; i = i + 1) { print i; }");
+
+  EXPECT_EQ(out,
+            "1000.000000\n"
+            "2.000000\n"
+            "6.000000\n"
+            "10.000000\n"
+            "14.000000\n"
+            "4.000000\n"
+            "9.000000\n"
+            "0.500000\n"
+            "1.500000\n"
+            "0.000000\n"
+            "1.000000\n");
+}
+
+TEST(InterpreterTest, CountedLoopBoundErrors)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto out = runScript(interpreter,
+                       "var n = 2;"
+                       "for(var i = 0; i < n; i = i + 1) { n = \"two\"; }");
+
+  EXPECT_EQ(out, "Operand must be a number\n");
+}
+
+TEST(InterpreterTest, BlockEnvironments)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto out = runScript(interpreter,
+                       "var x = \"outer\";"
+                       "var i = 0;"
+                       "while(i < 2) {"
+                       // reads the outer x before the block declares its own
+                       "  fun show() { print x; }"
+                       "  show();"
+                       "  var x = i;"
+                       "  show();"
+                       "  i = i + 1;"
+                       "}"
+                       "var j = 0;"
+                       "var fs = nil;"
+                       "while(j < 2) {"
+                       "  var y = j;"
+                       "  { print y; }"
+                       "  j = j + 1;"
+                       "}"
+                       "for(var k = 0; k < 2; k = k + 1) {"
+                       "  var z = k * 10;"
+                       "  fun get() { return z; }"
+                       "  if(k == 0) fs = get;"
+                       "}"
+                       "print fs();"
+                       "print x;");
+
+  EXPECT_EQ(out,
+            "outer\n"
+            "0.000000\n"
+            "outer\n"
+            "1.000000\n"
+            "0.000000\n"
+            "1.000000\n"
+            "0.000000\n"
+            "outer\n");
+}
+
+TEST(InterpreterTest, CallChecks)
+{
+  auto interpreter = Lox::Interpreter{};
+
+  EXPECT_EQ(runScript(interpreter, "fun f(a, b) {} f(1);"),
+            "Expected 2 arguments but got 1.\n");
+  EXPECT_EQ(runScript(interpreter, "clock(1);"),
+            "Expected 0 arguments but got 1.\n");
+  EXPECT_EQ(runScript(interpreter, "var x = 1; x();"),
+            "Can only call functions and classes.\n");
+}
+
+TEST(InterpreterTest, NestedCallArguments)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto out = runScript(interpreter,
+                       "fun add3(a, b, c) { return a + b + c; }"
+                       "fun id(x) { return x; }"
+                       "print add3(id(1), add3(id(2), 3, id(4)), id(5));"
+                       "print id(\"str\") + id(\"ing\");");
+
+  EXPECT_EQ(out, "15.000000\nstring\n");
+}
+
+TEST(InterpreterTest, IsolatesRunInParallel)
+{
+  constexpr auto threads = 4;
+
+  auto outputs = std::vector<std::ostringstream>(threads);
+  {
+    auto workers = std::vector<std::jthread>{};
+    for (auto i = 0; i < threads; ++i) {
+      workers.emplace_back([&outputs, i]() {
+        auto tokens = Lox::Scanner{ "load(\"map\");"
+                                    "fun fib(n) {"
+                                    "  if(n < 2) return n;"
+                                    "  return fib(n - 2) + fib(n - 1);"
+                                    "}"
+                                    "var m = Map();"
+                                    "for(var i = 0; i < 20; i = i + 1) {"
+                                    "  mapSet(m, i, fib(i));"
+                                    "}"
+                                    "print mapGet(m, 19) + id;" }
+                        .scanTokens();
+        auto statements = Lox::Parser{ tokens }.parse();
+        Lox::Resolver{}.resolve(statements);
+
+        auto interpreter = Lox::Interpreter{};
+        interpreter.setOutput(outputs[i]);
+        interpreter.environment().define("id", Lox::Object{ double(i) });
+        interpreter.interpret(statements);
+      });
+    }
+  }
+
+  for (auto i = 0; i < threads; ++i) {
+    EXPECT_EQ(outputs[i].str(), std::to_string(4181.0 + i) + "\n");
+  }
+}
+
+TEST(InterpreterTest, ResetGoesBackToSnapshot)
+{
+  auto interpreter = Lox::Interpreter{};
+  runScript(interpreter,
+            "var count = 0;"
+            "var name = \"prelude\";"
+            "fun bump() { count = count + 1; return count; }");
+  interpreter.snapshot();
+
+  auto out = runScript(interpreter,
+                       "for(count = 0; count < 5; count = count + 1) {}"
+                       "print bump();"
+                       "name = name + \"!\";"
+                       "var extra = 1;"
+                       "fun bump() { return -1; }");
+  EXPECT_EQ(out, "6.000000\n");
+
+  interpreter.reset();
+  out = runScript(interpreter, "print count; print name; print bump();");
+  EXPECT_EQ(out, "0.000000\nprelude\n1.000000\n");
+
+  interpreter.reset();
+  out = runScript(interpreter, "print count; print extra;");
+  EXPECT_EQ(out, "0.000000\nUndefined variable extra\n");
+}
+
+TEST(InterpreterTest, ResetGoesBackToSnapshottedNatives)
+{
+  auto interpreter = Lox::Interpreter{};
+  runScript(interpreter,
+            "load(\"map\");"
+            "load(\"array\");"
+            "var cfg = Map();"
+            "mapSet(cfg, \"inner\", Map());"
+            "var numbers = numberArray(2);"
+            "var alias = cfg;");
+  interpreter.snapshot();
+
+  auto out = runScript(interpreter,
+                       "mapSet(cfg, \"dirty\", true);"
+                       "mapSet(mapGet(alias, \"inner\"), \"dirty\", true);"
+                       "arraySet(numbers, 0, 1);"
+                       "arrayPush(numbers, 2);"
+                       "cfg = nil;"
+                       "print mapSize(alias);");
+  EXPECT_EQ(out, "2.000000\n");
+
+  for (auto i = 0; i < 2; ++i) {
+    interpreter.reset();
+    out = runScript(interpreter,
+                    "print mapHas(cfg, \"dirty\");"
+                    "print mapHas(mapGet(cfg, \"inner\"), \"dirty\");"
+                    "print arrayLen(numbers) + arrayGet(numbers, 0);"
+                    "mapSet(cfg, \"dirty\", true);");
+    EXPECT_EQ(out, "false\nfalse\n2.000000\n");
+  }
+}
+
+TEST(InterpreterTest, ResetGoesBackToSnapshottedClosures)
+{
+  auto interpreter = Lox::Interpreter{};
+  runScript(interpreter,
+            "load(\"map\");"
+            "fun makeCounter() {"
+            "  var n = 0;"
+            "  var seen = Map();"
+            "  fun inc() {"
+            "    n = n + 1;"
+            "    mapSet(seen, n, true);"
+            "    return n + mapSize(seen) * 10;"
+            "  }"
+            "  return inc;"
+            "}"
+            "var counter = makeCounter();");
+  interpreter.snapshot();
+
+  for (auto i = 0; i < 3; ++i) {
+    auto out = runScript(interpreter, "print counter();");
+    EXPECT_EQ(out, "11.000000\n");
+    interpreter.reset();
+  }
+}
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include <random>
+#include <unordered_map>
+
+#include <gtest/gtest.h>
+
+#include <Interpreter.hpp>
+#include <Map.hpp>
+
+#include "TestHelpers.hpp"
+
+namespace {
+
+std::size_t allocated = 0UL;
+
+template<typename T>
+struct CountingAllocator
+{
+  using value_type = T;
+
+  T* allocate(std::size_t n)
+  {
+    allocated += n * sizeof(T);
+    return std::allocator<T>{}.allocate(n);
+  }
+
+  void deallocate(T* p, std::size_t n) noexcept
+  {
+    allocated -= n * sizeof(T);
+    std::allocator<T>{}.deallocate(p, n);
+  }
+
+  template<typename U>
+  bool operator==(CountingAllocator<U> const&) const noexcept
+  {
+    return true;
+  }
+
+  CountingAllocator() = default;
+  template<typename U>
+  CountingAllocator(CountingAllocator<U> const&) noexcept
+  {}
+};
+
+} // namespace
+
+TEST(MapTest, MatchesUnorderedMap)
+{
+  auto map = Lox::Map{};
+  auto reference = std::unordered_map<std::string, double>{};
+  auto rng = std::mt19937{ 42 };
+
+  for (auto i = 0; i < 20000; ++i) {
+    auto key = "k" + std::to_string(rng() % 3000U);
+    auto op = rng() % 3U;
+    if (op == 0U) {
+      EXPECT_EQ(map.erase(Lox::Object{ key }), reference.erase(key) == 1UL);
+    } else {
+      map.set(Lox::Object{ key }, Lox::Object{ static_cast<double>(i) });
+      reference[key] = i;
+    }
+  }
+
+  ASSERT_EQ(map.size(), reference.size());
+  for (auto const& [key, value] : reference) {
+    auto found = map.get(Lox::Object{ key });
+    ASSERT_TRUE(found) << key;
+    EXPECT_EQ(found->number(), value);
+  }
+  for (auto const& entry : map.items()) {
+    EXPECT_TRUE(reference.contains(std::get<std::string>(entry.key)));
+  }
+}
+
+TEST(MapTest, KeysCompareLikeLox)
+{
+  auto map = Lox::Map{};
+  map.set(Lox::Object::fromInteger(1), Lox::Object{ std::string{ "one" } });
+  map.set(Lox::Object{ -0.0 }, Lox::Object{ std::string{ "zero" } });
+  map.set(Lox::Object::null(), Lox::Object{ true });
+  map.set(Lox::Object{ false }, Lox::Object::null());
+
+  EXPECT_EQ(map.get(Lox::Object{ 1.0 })->string(), "one");
+  EXPECT_EQ(map.get(Lox::Object{ 0.0 })->string(), "zero");
+  EXPECT_TRUE(map.get(Lox::Object::null())->boolean());
+  EXPECT_TRUE(map.get(Lox::Object{ false })->isNull());
+  EXPECT_FALSE(map.contains(Lox::Object{ true }));
+  EXPECT_FALSE(map.contains(Lox::Object{ std::string{ "1" } }));
+  EXPECT_THROW(map.set(Lox::Object{ std::nan("") }, Lox::Object{}),
+               Lox::LoxRuntimeError);
+}
+
+TEST(MapTest, MemoryPerEntry)
+{
+  constexpr auto n = 100000UL;
+
+  auto map = Lox::Map{};
+  for (auto i = 0UL; i < n; ++i) {
+    map.set(Lox::Object{ "key" + std::to_string(i) }, Lox::Object{ 1.0 });
+  }
+
+  allocated = 0UL;
+  {
+    using Pair = std::pair<std::string const, Lox::Object>;
+    auto reference = std::unordered_map<std::string,
+                                        Lox::Object,
+                                        std::hash<std::string>,
+                                        std::equal_to<std::string>,
+                                        CountingAllocator<Pair>>{};
+    for (auto i = 0UL; i < n; ++i) {
+      reference.emplace("key" + std::to_string(i), Lox::Object{ 1.0 });
+    }
+
+    EXPECT_LT(map.bytes(), allocated);
+  }
+}
+
+TEST(MapTest, ScriptUsesMapModule)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto out = runScript(interpreter,
+                       "load(\"map\");"
+                       "var m = Map();"
+                       "mapSet(m, \"a\", 1); mapSet(m, 2, \"b\");"
+                       "mapSet(m, true, nil); mapSet(m, \"a\", 3);"
+                       "print mapSize(m);"
+                       "print mapGet(m, \"a\");"
+                       "print mapHas(m, true);"
+                       "print mapGet(m, \"missing\");"
+                       "print m;"
+                       "fun show(key, value) { print key; }"
+                       "mapEach(m, show);"
+                       "print mapDelete(m, 2);"
+                       "print mapDelete(m, 2);"
+                       "print m;"
+                       "mapSet(m, m, 1);");
+
+  EXPECT_EQ(out,
+            "3.000000\n"
+            "3.000000\n"
+            "true\n"
+            "nil\n"
+            "{a: 3.000000, 2.000000: b, true: nil}\n"
+            "a\n"
+            "2.000000\n"
+            "true\n"
+            "true\n"
+            "false\n"
+            "{a: 3.000000, true: nil}\n"
+            "Map keys must be strings, numbers, booleans or nil.\n");
+}
+
+TEST(MapTest, ScriptCantChangeMapWhileIterating)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto out = runScript(interpreter,
+                       "load(\"map\");"
+                       "var m = Map();"
+                       "mapSet(m, 1, 1); mapSet(m, 2, 2);"
+                       "fun grow(key, value) { mapSet(m, key + 10, value); }"
+                       "mapEach(m, grow);");
+
+  EXPECT_EQ(out, "Map changed during iteration.\n");
+}
\ No newline at end of file
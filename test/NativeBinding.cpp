@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include <Interpreter.hpp>
+#include <NativeBinding.hpp>
+
+namespace {
+
+double
+add(double lhs, double rhs)
+{
+  return lhs + rhs;
+}
+
+std::string
+repeat(std::string_view str, double times)
+{
+  auto res = std::string{};
+  for (auto i = 0; i < times; ++i) {
+    res += str;
+  }
+  return res;
+}
+
+bool
+isNil(Lox::Object const& obj)
+{
+  return obj.isNull();
+}
+
+} // namespace
+
+TEST(NativeBindingTest, UnpacksArguments)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto fn = Lox::NativeFunction::bind<&add>("add");
+  auto args = std::vector<Lox::Object>{ Lox::Object{ 1.5 },
+                                        Lox::Object::fromInteger(2) };
+
+  EXPECT_EQ(fn->arity(), 2UL);
+  EXPECT_EQ(fn->name(), "add");
+  EXPECT_EQ(fn->call(interpreter, args).number(), 3.5);
+}
+
+TEST(NativeBindingTest, ConvertsStringsAndValues)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto args = std::vector<Lox::Object>{ Lox::Object{ std::string{ "ab" } },
+                                        Lox::Object{ 3.0 } };
+
+  auto res = Lox::NativeFunction::bind<&repeat>("repeat")->call(interpreter,
+                                                                args);
+  EXPECT_EQ(res.string(), "ababab");
+
+  auto nil = std::vector<Lox::Object>{ Lox::Object::null() };
+  EXPECT_TRUE(
+    Lox::NativeFunction::bind<&isNil>("isNil")->call(interpreter, nil).boolean());
+}
+
+TEST(NativeBindingTest, RejectsWrongTypes)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto fn = Lox::NativeFunction::bind<&add>("add");
+  auto args = std::vector<Lox::Object>{ Lox::Object{ 1.0 },
+                                        Lox::Object{ std::string{ "2" } } };
+
+  try {
+    fn->call(interpreter, args);
+    FAIL() << "expected a runtime error";
+  } catch (Lox::LoxRuntimeError const& err) {
+    EXPECT_EQ(err.where(), "<native add>");
+    EXPECT_STREQ(err.what(), "Argument 2 must be a number.");
+  }
+}
+
+TEST(NativeBindingTest, ArityErrorsNameTheNative)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto fn = Lox::Object{ Lox::NativeFunction::bind<&add>("add") };
+  auto args = std::vector<Lox::Object>{ Lox::Object{ 1.0 } };
+
+  EXPECT_EQ(Lox::Interpreter::stringify(fn), "<native add>");
+  try {
+    interpreter.call(fn, args);
+    FAIL() << "expected a runtime error";
+  } catch (Lox::LoxRuntimeError const& err) {
+    EXPECT_EQ(err.where(), "<native add>");
+    EXPECT_STREQ(err.what(), "Expected 2 arguments but got 1.");
+  }
+}
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <Interpreter.hpp>
+#include <NativeModule.hpp>
+
+#include "TestHelpers.hpp"
+
+namespace {
+
+double
+distance(double x, double y)
+{
+  return std::sqrt(x * x + y * y);
+}
+
+std::string_view
+firstWord(std::string_view str)
+{
+  return str.substr(0, str.find(' '));
+}
+
+} // namespace
+
+TEST(NativeModuleTest, LoadsRegisteredModule)
+{
+  auto geometry = Lox::NativeModule{ "test_geometry" };
+  geometry.function<&distance>("hypot").function<&firstWord>("firstWord");
+  Lox::NativeModule::add(std::move(geometry));
+
+  auto interpreter = Lox::Interpreter{};
+  auto out = runScript(interpreter,
+                       "load(\"test_geometry\");"
+                       "print hypot(3, 4);"
+                       "print firstWord(\"hello native world\");"
+                       "print hypot(\"3\", 4);");
+
+  EXPECT_EQ(out,
+            "5.000000\n"
+            "hello\n"
+            "Argument 1 must be a number.\n");
+}
+
+TEST(NativeModuleTest, EmbedderLoadsModule)
+{
+  auto interpreter = Lox::Interpreter{};
+  interpreter.load("math");
+  interpreter.load("string");
+
+  auto out = runScript(interpreter,
+                       "print sqrt(16) + max(1, 2);"
+                       "print upper(\"lox\") + \" \" + lower(\"LOX\");"
+                       "print contains(\"interpreter\", \"pre\");"
+                       "print len(\"four\");");
+
+  EXPECT_EQ(out,
+            "6.000000\n"
+            "LOX lox\n"
+            "true\n"
+            "4.000000\n");
+}
+
+TEST(NativeModuleTest, UnknownModule)
+{
+  auto interpreter = Lox::Interpreter{};
+
+  EXPECT_EQ(runScript(interpreter, "load(\"nope\");"),
+            "Unknown module 'nope'.\n");
+  EXPECT_THROW(interpreter.load("nope"), Lox::LoxRuntimeError);
+}
+
+TEST(NativeModuleTest, TimeModule)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto out = runScript(interpreter,
+                       "load(\"time\");"
+                       "var start = nanos();"
+                       "var cpu = cpuNanos();"
+                       "var n = 0;"
+                       "fun work() { for(var i = 0; i < 100; i = i + 1) n = n + i; }"
+                       "var median = benchmark(work, 5);"
+                       "print nanos() > start;"
+                       "print cpuNanos() >= cpu;"
+                       "print median > 0;"
+                       "print n;"
+                       // hardware counters may not be available
+                       "var c = cycles();"
+                       "print c == nil or c >= 0;");
+
+  auto report = out.substr(0, out.find('\n'));
+  EXPECT_TRUE(report.starts_with("<fn work>: min ")) << report;
+  EXPECT_NE(report.find(" ns (5 runs)"), std::string::npos) << report;
+  EXPECT_EQ(out.substr(out.find('\n') + 1),
+            "true\ntrue\ntrue\n24750.000000\ntrue\n");
+}
+
+TEST(NativeModuleTest, CpuTimeIsThatOfTheInterpreter)
+{
+  auto stop = std::atomic<bool>{ false };
+  auto busy = std::thread{ [&stop]() {
+    while (!stop.load(std::memory_order_relaxed)) {
+    }
+  } };
+
+  auto interpreter = Lox::Interpreter{};
+  auto out = runScript(interpreter,
+                       "load(\"time\");"
+                       "var start = nanos();"
+                       "var cpu = cpuNanos();"
+                       "while (nanos() - start < 100000000) {}"
+                       "var used = cpuNanos() - cpu;"
+                       "print used <= nanos() - start;");
+  stop = true;
+  busy.join();
+
+  // another busy thread doesn't count, at most the time that went by
+  EXPECT_EQ(out, "true\n");
+}
+
+TEST(NativeModuleTest, BenchmarkChecksRuns)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto out = runScript(interpreter,
+                       "load(\"time\");"
+                       "fun work() {}"
+                       "print benchmark(work, 5000) >= 0;");
+  auto nan = runScript(interpreter, "benchmark(work, 0 / 0);");
+  auto large = runScript(interpreter, "benchmark(work, 1 / 0);");
+
+  EXPECT_NE(out.find(" ns (5000 runs)\ntrue\n"), std::string::npos) << out;
+  EXPECT_EQ(nan, "Argument 2 must be between 1 and 4294967296.\n");
+  EXPECT_EQ(large, "Argument 2 must be between 1 and 4294967296.\n");
+}
\ No newline at end of file
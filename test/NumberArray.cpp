@@ -0,0 +1,121 @@
+#include <cmath>
+#include <limits>
+
+#include <gtest/gtest.h>
+
+#include <Interpreter.hpp>
+#include <NumberArray.hpp>
+
+#include "TestHelpers.hpp"
+
+TEST(NumberArrayTest, KernelsMatchScalarLoops)
+{
+  // sizes around the vector widths exercise the scalar tails
+  for (auto size = 0UL; size < 40UL; ++size) {
+    auto a = Lox::NumberArray{ size };
+    auto b = Lox::NumberArray{ size };
+    auto sum = 0.0;
+    auto dot = 0.0;
+    auto min = std::numeric_limits<double>::infinity();
+    auto max = -min;
+    for (auto i = 0UL; i < size; ++i) {
+      auto x = static_cast<double>((i * 7UL) % 13UL) - 6.0;
+      auto y = static_cast<double>(i) * 0.5;
+      a.set(i, x);
+      b.set(i, y);
+      sum += x;
+      dot += x * y;
+      min = std::min(min, x);
+      max = std::max(max, x);
+    }
+
+    EXPECT_DOUBLE_EQ(a.sum(), sum) << size;
+    EXPECT_DOUBLE_EQ(a.dot(b), dot) << size;
+    EXPECT_EQ(a.min(), size ? std::optional{ min } : std::nullopt) << size;
+    EXPECT_EQ(a.max(), size ? std::optional{ max } : std::nullopt) << size;
+
+    a.scale(2.0);
+    a.add(b);
+    for (auto i = 0UL; i < size; ++i) {
+      auto x = static_cast<double>((i * 7UL) % 13UL) - 6.0;
+      EXPECT_EQ(a.get(i), 2.0 * x + b.get(i)) << size;
+    }
+  }
+}
+
+TEST(NumberArrayTest, StorageIsAligned)
+{
+  auto a = Lox::NumberArray{};
+  for (auto i = 0; i < 100; ++i) {
+    a.push(i);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(a.data()) %
+                Lox::NumberArray::alignment,
+              0UL);
+  }
+}
+
+TEST(NumberArrayTest, SortPutsNanLast)
+{
+  auto a = Lox::NumberArray{};
+  for (auto v : { 3.0, std::nan(""), -1.0, 2.0, std::nan(""), 0.0 }) {
+    a.push(v);
+  }
+  a.sort();
+
+  EXPECT_EQ(a.get(0), -1.0);
+  EXPECT_EQ(a.get(1), 0.0);
+  EXPECT_EQ(a.get(2), 2.0);
+  EXPECT_EQ(a.get(3), 3.0);
+  EXPECT_TRUE(std::isnan(a.get(4)));
+  EXPECT_TRUE(std::isnan(a.get(5)));
+}
+
+TEST(NumberArrayTest, ScriptUsesArrayModule)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto out = runScript(interpreter,
+                       "load(\"array\");"
+                       "var a = numberArray(3);"
+                       "arraySet(a, 0, 3); arraySet(a, 1, 1); arraySet(a, 2, 2);"
+                       "arrayPush(a, 4);"
+                       "print arrayLen(a);"
+                       "print arraySum(a);"
+                       "print arrayDot(a, a);"
+                       "arraySort(a);"
+                       "print a;"
+                       "print arrayMin(numberArray(0));"
+                       "arrayAdd(a, numberArray(2));");
+
+  EXPECT_EQ(out,
+            "4.000000\n"
+            "10.000000\n"
+            "30.000000\n"
+            "[1.000000, 2.000000, 3.000000, 4.000000]\n"
+            "nil\n"
+            "Arrays differ in size (4 and 2).\n");
+}
+
+TEST(NumberArrayTest, ScriptChecksIndices)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto out = runScript(interpreter,
+                       "load(\"array\");"
+                       "var a = numberArray(2);"
+                       "print arrayGet(a, 2);");
+  auto fraction = runScript(interpreter, "print arrayGet(a, 0.5);");
+  auto type = runScript(interpreter, "print arraySum(1);");
+  auto huge = runScript(interpreter,
+                        "print arrayGet(a, 1000000000 * 1000000000 * 1000);");
+  auto infinite = runScript(interpreter, "arraySet(a, 1 / 0, 1);");
+  auto nan = runScript(interpreter, "print numberArray(0 / 0);");
+  auto large = runScript(interpreter,
+                         "print numberArray(1000000000 * 1000000000);");
+
+  EXPECT_EQ(out, "Index out of range.\n");
+  EXPECT_EQ(huge, "Index out of range.\n");
+  EXPECT_EQ(infinite, "Index out of range.\n");
+  EXPECT_EQ(nan, "Index must be a non-negative whole number.\n");
+  EXPECT_EQ(large, "Size must be at most 268435456.\n");
+  EXPECT_EQ(fraction, "Index must be a non-negative whole number.\n");
+  EXPECT_EQ(type, "Argument 1 must be a NumberArray.\n");
+}
\ No newline at end of file
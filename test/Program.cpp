@@ -0,0 +1,78 @@
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <Interpreter.hpp>
+#include <Program.hpp>
+
+#include "TestHelpers.hpp"
+
+TEST(ProgramTest, RunsInManyInterpreters)
+{
+  auto program = Lox::Program::compile("var count = 0;"
+                                       "fun bump() { count = count + 1; }"
+                                       "bump(); bump();"
+                                       "print count;");
+
+  auto first = Lox::Interpreter{};
+  auto second = Lox::Interpreter{};
+  EXPECT_EQ(runProgram(first, program), "2.000000\n");
+  EXPECT_EQ(runProgram(second, program), "2.000000\n");
+  // globals are the interpreter's, not the program's
+  EXPECT_EQ(runProgram(first, program), "2.000000\n");
+}
+
+TEST(ProgramTest, FunctionsKeepProgramAlive)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto program = Lox::Program::compile("fun outer(n) {"
+                                       "  fun inner() { return n * 2; }"
+                                       "  return inner;"
+                                       "}");
+  runProgram(interpreter, program);
+
+  auto weak = std::weak_ptr<Lox::Program const>{ program };
+  program.reset();
+  EXPECT_FALSE(weak.expired());
+
+  auto out = runProgram(interpreter,
+                        Lox::Program::compile("var f = outer(21);"
+                                              "print f();"));
+  EXPECT_EQ(out, "42.000000\n");
+}
+
+TEST(ProgramTest, SharedBetweenThreads)
+{
+  constexpr auto threads = 4;
+
+  auto program = Lox::Program::compile("fun fib(n) {"
+                                       "  if(n < 2) return n;"
+                                       "  return fib(n - 2) + fib(n - 1);"
+                                       "}"
+                                       "var total = 0;"
+                                       "for(var i = 0; i < 15; i = i + 1) {"
+                                       "  total = total + fib(i);"
+                                       "}"
+                                       "print total;");
+
+  auto outputs = std::vector<std::string>(threads);
+  {
+    auto workers = std::vector<std::jthread>{};
+    for (auto i = 0; i < threads; ++i) {
+      workers.emplace_back([&outputs, &program, i]() {
+        for (auto run = 0; run < 10; ++run) {
+          auto interpreter = Lox::Interpreter{};
+          outputs[i] += runProgram(interpreter, program);
+        }
+      });
+    }
+  }
+
+  auto expected = std::string{};
+  for (auto run = 0; run < 10; ++run) {
+    expected += "986.000000\n";
+  }
+  for (auto const& out : outputs) {
+    EXPECT_EQ(out, expected);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+
+#include <Parser.hpp>
+#include <PurityAnalyzer.hpp>
+#include <Scanner.hpp>
+
+namespace {
+
+std::map<std::string, bool>
+analyze(std::string const& src)
+{
+  auto tokens = Lox::Scanner{ src }.scanTokens();
+  auto statements = Lox::Parser{ tokens }.parse();
+  Lox::PurityAnalyzer{}.analyze(statements);
+
+  auto res = std::map<std::string, bool>{};
+  for (auto& stmt : statements) {
+    if (auto* fn =
+          dynamic_cast<Lox::FunctionDeclarationStatement const*>(stmt.get())) {
+      res[fn->name().lexeme()] = fn->isPure();
+    }
+  }
+  return res;
+}
+
+} // namespace
+
+TEST(PurityAnalyzerTest, RecursionAndLocals)
+{
+  auto res = analyze("fun fib(n) {"
+                     "  if(n <= 1) return n;"
+                     "  return fib(n - 2) + fib(n - 1);"
+                     "}"
+                     "fun sum(n) {"
+                     "  var acc = 0;"
+                     "  for(var i = 0; i < n; i = i + 1) acc = acc + fib(i);"
+                     "  return acc;"
+                     "}");
+
+  EXPECT_TRUE(res.at("fib"));
+  EXPECT_TRUE(res.at("sum"));
+}
+
+TEST(PurityAnalyzerTest, SideEffectsAndFreeVariables)
+{
+  auto res = analyze("var g = 0;"
+                     "fun printer(n) { print n; }"
+                     "fun writer(n) { g = n; }"
+                     "fun reader(n) { return n + g; }"
+                     "fun timer() { return clock(); }"
+                     "fun caller(n) { return printer(n); }"
+                     "fun higher(f, n) { return f(n); }"
+                     "fun closure() { fun inner() { return 1; } return inner; }"
+                     "fun scoped(n) { { var x = n; } return x; }");
+
+  for (auto const& [name, pure] : res) {
+    EXPECT_FALSE(pure) << name;
+  }
+}
+
+TEST(PurityAnalyzerTest, ReassignedFunctions)
+{
+  auto res = analyze("fun id(n) { return n; }"
+                     "fun twice(n) { return id(id(n)); }"
+                     "fun other(n) { return n; }"
+                     "fun other(n) { return n + 1; }"
+                     "id = other;");
+
+  EXPECT_FALSE(res.at("id"));
+  EXPECT_FALSE(res.at("twice"));
+  EXPECT_FALSE(res.at("other"));
+}
\ No newline at end of file
@@ -0,0 +1,209 @@
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <gtest/gtest.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <Server.hpp>
+
+#include "TestHelpers.hpp"
+
+namespace {
+
+struct Reply
+{
+  int status;
+  std::string out;
+  std::string err;
+};
+
+Reply
+runSource(std::string const& socket, std::string_view src)
+{
+  auto out = std::ostringstream{};
+  auto err = std::ostringstream{};
+  auto status = Lox::runOnServer(
+    socket, { Lox::ScriptRequest::Kind::source, src }, out, err);
+  return Reply{ status, out.str(), err.str() };
+}
+
+/**
+ * A client connected to socket that doesn't send anything yet.
+ * */
+int
+connectIdle(std::string const& socket)
+{
+  auto addr = sockaddr_un{};
+  addr.sun_family = AF_UNIX;
+  socket.copy(addr.sun_path, sizeof(addr.sun_path) - 1UL);
+  auto fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  EXPECT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+  return fd;
+}
+
+/**
+ * Everything the server sends to fd until it closes the connection.
+ * */
+std::string
+readAll(int fd)
+{
+  auto res = std::string{};
+  auto chunk = std::array<char, 256UL>{};
+  auto n = 0L;
+  while ((n = recv(fd, chunk.data(), chunk.size(), 0)) > 0) {
+    res.append(chunk.data(), static_cast<std::size_t>(n));
+  }
+  close(fd);
+  return res;
+}
+
+/**
+ * A server on a temporary socket, serving on a thread of its own.
+ * */
+class ServerTest : public ::testing::Test
+{
+protected:
+  void start(size_t workers,
+             std::chrono::milliseconds timeout = std::chrono::seconds{ 10 })
+  {
+    server = std::make_unique<Lox::Server>(Lox::ServerOptions{
+      .path = socket, .workers = workers, .request_timeout = timeout });
+    thread = std::jthread{ [this]() { server->run(); } };
+  }
+
+  virtual void TearDown() override
+  {
+    server->stop();
+    if (thread.joinable()) {
+      thread.join();
+    }
+    server.reset();
+  }
+
+  std::string socket = tempPath("server.sock").string();
+  std::unique_ptr<Lox::Server> server;
+  std::jthread thread;
+};
+
+} // namespace
+
+TEST_F(ServerTest, RunsSourceAndPaths)
+{
+  start(2UL);
+
+  auto reply = runSource(socket, "print 1 + 2; print \"done\";");
+  EXPECT_EQ(reply.status, 0);
+  EXPECT_EQ(reply.out, "3.000000\ndone\n");
+  EXPECT_EQ(reply.err, "");
+
+  auto path = tempPath("server_script.lox");
+  std::ofstream{ path } << "print 1 + 2; print \"done\";";
+  auto out = std::ostringstream{};
+  auto err = std::ostringstream{};
+  auto status = Lox::runOnServer(
+    socket, { Lox::ScriptRequest::Kind::path, path.string() }, out, err);
+  std::filesystem::remove(path);
+
+  EXPECT_EQ(status, 0);
+  EXPECT_EQ(out.str(), "3.000000\ndone\n");
+  // same source, parsed once
+  EXPECT_EQ(server->cachedPrograms(), 1UL);
+}
+
+TEST_F(ServerTest, GlobalsDoNotLeakBetweenScripts)
+{
+  start(1UL);
+
+  auto first = runSource(socket, "var x = 1; fun f() { return x; } print f();");
+  EXPECT_EQ(first.status, 0);
+  EXPECT_EQ(first.out, "1.000000\n");
+
+  auto second = runSource(socket, "print clock() >= 0; print x;");
+  EXPECT_EQ(second.status,
+            static_cast<int>(Lox::ScriptStatus::runtime_error));
+  EXPECT_EQ(second.out, "true\nUndefined variable x\n");
+}
+
+TEST_F(ServerTest, ReportsErrors)
+{
+  start(1UL);
+
+  auto syntax = runSource(socket, "print (1;");
+  EXPECT_EQ(syntax.status, static_cast<int>(Lox::ScriptStatus::syntax_error));
+  EXPECT_EQ(syntax.out, "");
+  EXPECT_NE(syntax.err, "");
+
+  auto out = std::ostringstream{};
+  auto err = std::ostringstream{};
+  auto status = Lox::runOnServer(
+    socket,
+    { Lox::ScriptRequest::Kind::path, tempPath("missing.lox").string() },
+    out,
+    err);
+  EXPECT_EQ(status, static_cast<int>(Lox::ScriptStatus::unreadable));
+  EXPECT_EQ(server->cachedPrograms(), 0UL);
+}
+
+TEST_F(ServerTest, IdleClientsTimeOut)
+{
+  start(1UL, std::chrono::milliseconds{ 200 });
+
+  auto idle = connectIdle(socket);
+  EXPECT_EQ(readAll(idle), "err 19\nRequest timed out.\nexit 64\n");
+
+  // the worker is free again
+  auto reply = runSource(socket, "print 1;");
+  EXPECT_EQ(reply.out, "1.000000\n");
+}
+
+TEST_F(ServerTest, StopDoesNotWaitForIdleClients)
+{
+  start(1UL);
+
+  auto idle = connectIdle(socket);
+  // let the worker accept it and start reading
+  std::this_thread::sleep_for(std::chrono::milliseconds{ 100 });
+  auto begin = std::chrono::steady_clock::now();
+  server->stop();
+  thread.join();
+
+  auto took = std::chrono::steady_clock::now() - begin;
+  EXPECT_LT(took, std::chrono::seconds{ 5 });
+  EXPECT_EQ(readAll(idle), "err 20\nServer is stopping.\nexit 64\n");
+}
+TEST_F(ServerTest, RetriesWhenOutOfDescriptors)
+{
+  start(1UL);
+
+  auto addr = sockaddr_un{};
+  addr.sun_family = AF_UNIX;
+  socket.copy(addr.sun_path, sizeof(addr.sun_path) - 1UL);
+  auto client = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  // fails rather than hangs if the worker gave up
+  auto wait = timeval{ .tv_sec = 5, .tv_usec = 0 };
+  setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &wait, sizeof(wait));
+
+  // every descriptor below the lowest free one is taken, so a limit at it
+  // makes the worker's accept() fail with EMFILE
+  auto limit = rlimit{};
+  getrlimit(RLIMIT_NOFILE, &limit);
+  auto lowest = dup(client);
+  close(lowest);
+  auto lowered = rlimit{ static_cast<rlim_t>(lowest), limit.rlim_max };
+  setrlimit(RLIMIT_NOFILE, &lowered);
+  EXPECT_EQ(connect(client, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)),
+            0);
+  std::this_thread::sleep_for(std::chrono::milliseconds{ 100 });
+  setrlimit(RLIMIT_NOFILE, &limit);
+
+  auto request = std::string_view{ "source 8\nprint 1;" };
+  send(client, request.data(), request.size(), 0);
+  EXPECT_EQ(readAll(client), "out 9\n1.000000\nexit 0\n");
+}
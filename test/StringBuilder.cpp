@@ -0,0 +1,65 @@
+#include <limits>
+
+#include <gtest/gtest.h>
+
+#include <Interpreter.hpp>
+#include <StringBuilder.hpp>
+
+#include "TestHelpers.hpp"
+
+TEST(StringBuilderTest, NumbersAppearLikePrinted)
+{
+  auto numbers = {
+    Lox::Object{ 0.5 },
+    Lox::Object{ -0.0 },
+    Lox::Object{ 1e300 },
+    Lox::Object{ std::numeric_limits<double>::infinity() },
+    Lox::Object::fromInteger(-42),
+    Lox::Object::fromInteger(Lox::Object::max_integer),
+  };
+  for (auto const& num : numbers) {
+    auto builder = Lox::StringBuilder{};
+    builder.append(num);
+    EXPECT_EQ(builder.str(), Lox::Interpreter::stringify(num));
+  }
+}
+
+TEST(StringBuilderTest, ScriptBuildsString)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto out = runScript(interpreter,
+                       "load(\"string\");"
+                       "var b = StringBuilder();"
+                       "builderReserve(b, 64);"
+                       "for(var i = 0; i < 3; i = i + 1) {"
+                       "  builderAppend(b, i);"
+                       "  builderAppend(b, \", \");"
+                       "}"
+                       "builderAppend(b, true);"
+                       "builderAppend(b, nil);"
+                       "print builderLength(b);"
+                       "print b;"
+                       "print builderString(b) == builderString(b);"
+                       "builderAppend(\"s\", 1);");
+
+  EXPECT_EQ(out,
+            "37.000000\n"
+            "0.000000, 1.000000, 2.000000, truenil\n"
+            "true\n"
+            "Argument 1 must be a StringBuilder.\n");
+}
+
+TEST(StringBuilderTest, ReserveIsChecked)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto large = runScript(interpreter,
+                         "load(\"string\");"
+                         "var b = StringBuilder();"
+                         "builderReserve(b, 1000000000 * 1000000);");
+  auto infinite = runScript(interpreter, "builderReserve(b, 1 / 0);");
+  auto nan = runScript(interpreter, "builderReserve(b, 0 / 0);");
+
+  EXPECT_EQ(large, "Size must be at most 1073741824.\n");
+  EXPECT_EQ(infinite, "Size must be at most 1073741824.\n");
+  EXPECT_EQ(nan, "Size must be a non-negative number.\n");
+}
\ No newline at end of file
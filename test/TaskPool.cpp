@@ -0,0 +1,179 @@
+#include <gtest/gtest.h>
+
+#include <Interpreter.hpp>
+#include <TaskPool.hpp>
+
+#include "TestHelpers.hpp"
+
+TEST(TaskPoolTest, RecursiveSpawnJoin)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto out = runProgram(interpreter,
+                        "load(\"task\");"
+                        "fun fib(n) {"
+                        "  if (n < 2) return n;"
+                        "  if (n < 12) return fib(n - 1) + fib(n - 2);"
+                        "  var left = spawn(fib, n - 1);"
+                        "  return fib(n - 2) + join(left);"
+                        "}"
+                        "print fib(20);"
+                        "print join(spawn(clock)) > 0;");
+
+  EXPECT_EQ(out, "6765.000000\ntrue\n");
+}
+
+TEST(TaskPoolTest, GlobalsAreCopiedAtSpawn)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto out = runProgram(interpreter,
+                        "load(\"task\");"
+                        "var greeting = \"hello\";"
+                        "fun greet(name) {"
+                        "  greeting = greeting + \"!\";"
+                        "  return greeting + \" \" + name;"
+                        "}"
+                        "var task = spawn(greet, \"task\");"
+                        "greeting = \"bye\";"
+                        "print join(task);"
+                        "print greeting;");
+
+  EXPECT_EQ(out, "hello! task\nbye\n");
+}
+
+TEST(TaskPoolTest, NativeValuesAreCopiedIntoTasks)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto out = runProgram(interpreter,
+                        "load(\"task\");"
+                        "load(\"array\");"
+                        "load(\"map\");"
+                        "var m = Map();"
+                        "mapSet(m, \"k\", 1);"
+                        "fun total(a) {"
+                        "  arraySet(a, 0, 5);"
+                        "  mapSet(m, \"k\", 2);"
+                        "  return arraySum(a) + mapGet(m, \"k\");"
+                        "}"
+                        "var a = numberArray(3);"
+                        "arraySet(a, 1, 3);"
+                        "var inner = Map();"
+                        "mapSet(m, \"inner\", inner);"
+                        "var t = spawn(total, a);"
+                        "print join(t);"
+                        "print arrayGet(a, 0);"
+                        "print mapGet(m, \"k\");"
+                        "mapSet(inner, \"self\", inner);"
+                        "spawn(total, inner);");
+
+  EXPECT_EQ(out,
+            "10.000000\n0.000000\n1.000000\n"
+            "Argument 2 can't be passed to a task, it contains itself.\n");
+}
+
+TEST(TaskPoolTest, SpawnsSeeGlobalsWrittenSinceTheLastOne)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto out = runProgram(interpreter,
+                        "load(\"task\");"
+                        "load(\"map\");"
+                        "var n = 1;"
+                        "var m = Map();"
+                        "fun read() { return n + mapSize(m); }"
+                        "print join(spawn(read));"
+                        "mapSet(m, 1, 1);"
+                        "print join(spawn(read));"
+                        "n = 10;"
+                        "print join(spawn(read));"
+                        "fun read() { return -n; }"
+                        "print join(spawn(read));");
+
+  EXPECT_EQ(out, "1.000000\n2.000000\n11.000000\n-10.000000\n");
+}
+
+TEST(TaskPoolTest, NestedTasksLeaveTheJoiningTasksGlobals)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto out = runProgram(interpreter,
+                        "load(\"task\");"
+                        "var x = 0;"
+                        "fun inner() { x = -1; return 1; }"
+                        "fun outer(n) {"
+                        "  x = n;"
+                        "  for(var i = 0; i < 8; i = i + 1) {"
+                        "    join(spawn(inner));"
+                        "  }"
+                        "  return x;"
+                        "}"
+                        "var sum = 0;"
+                        "for(var i = 1; i <= 4; i = i + 1) {"
+                        "  sum = sum + join(spawn(outer, i));"
+                        "}"
+                        "print sum;"
+                        "print x;");
+
+  EXPECT_EQ(out, "10.000000\n0.000000\n");
+}
+
+TEST(TaskPoolTest, TasksOfOtherScriptsLeaveNoGlobals)
+{
+  auto first = Lox::Interpreter{};
+  auto out = runProgram(first,
+                        "load(\"task\");"
+                        "var secret = \"from first\";"
+                        "fun f() { return secret; }"
+                        "print join(spawn(f));");
+  EXPECT_EQ(out, "from first\n");
+
+  auto second = Lox::Interpreter{};
+  out = runProgram(second,
+                   "load(\"task\");"
+                   "fun g() { return secret; }"
+                   "print join(spawn(g));");
+  EXPECT_EQ(out, "Undefined variable secret\n");
+}
+
+TEST(TaskPoolTest, ErrorsReachJoin)
+{
+  auto interpreter = Lox::Interpreter{};
+  auto out = runProgram(interpreter,
+                        "load(\"task\");"
+                        "fun fail() { return nil + 1; }"
+                        "var task = spawn(fail);"
+                        "print \"spawned\";"
+                        "join(task);");
+  EXPECT_EQ(out, "spawned\nOperands must be two numbers or two strings\n");
+
+  out = runProgram(interpreter,
+                   "fun outer() {"
+                   "  var n = 1;"
+                   "  fun inner() { return n; }"
+                   "  return inner;"
+                   "}"
+                   "spawn(outer());");
+  EXPECT_EQ(out,
+            "Argument 1 can't be passed to a task, "
+            "only top-level functions can.\n");
+
+  out = runProgram(interpreter, "spawn(outer, 1);");
+  EXPECT_EQ(out, "Expected 0 arguments but got 1.\n");
+}
+
+TEST(TaskPoolTest, JoinFromOtherThread)
+{
+  auto pool = Lox::TaskPool{ 2UL };
+  auto interpreter = Lox::Interpreter{};
+  runProgram(interpreter, "fun square(x) { return x * x; }");
+
+  auto square = *interpreter.globalEnvironment()->cell("square");
+  auto tasks = std::vector<std::shared_ptr<Lox::TaskHandle>>{};
+  for (auto i = 0; i < 100; ++i) {
+    auto arg = Lox::Object{ static_cast<double>(i) };
+    tasks.push_back(pool.spawn(interpreter, square, { &arg, 1UL }));
+  }
+
+  auto sum = 0.0;
+  for (auto const& task : tasks) {
+    sum += pool.join(interpreter, *task).number();
+  }
+  EXPECT_EQ(sum, 328350.0);
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <Interpreter.hpp>
+#include <Parser.hpp>
+#include <Program.hpp>
+#include <Resolver.hpp>
+#include <Scanner.hpp>
+
+/**
+ * What running program on interpreter printed, errors included.
+ * */
+inline std::string
+runProgram(Lox::Interpreter& interpreter,
+           std::shared_ptr<Lox::Program const> const& program)
+{
+  auto out = std::ostringstream{};
+  interpreter.setOutput(out);
+  interpreter.interpret(program);
+  return out.str();
+}
+
+inline std::string
+runProgram(Lox::Interpreter& interpreter, std::string_view src)
+{
+  return runProgram(interpreter, Lox::Program::compile(src));
+}
+
+/**
+ * Runs src as bare statements rather than a Program, returns
+ * what it printed to stdout.
+ * */
+inline std::string
+runScript(Lox::Interpreter& interpreter, std::string const& src)
+{
+  auto tokens = Lox::Scanner{ src }.scanTokens();
+  auto statements = Lox::Parser{ tokens }.parse();
+  Lox::Resolver{}.resolve(statements);
+
+  testing::internal::CaptureStdout();
+  interpreter.interpret(statements);
+  return testing::internal::GetCapturedStdout();
+}
+
+/**
+ * A path in the temporary directory unique to this process.
+ * */
+inline std::filesystem::path
+tempPath(std::string const& name)
+{
+  return std::filesystem::temp_directory_path() /
+         ("cpplox_" + std::to_string(getpid()) + "_" + name);
+}
\ No newline at end of file
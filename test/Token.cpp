@@ -35,4 +35,39 @@ TEST(ObjectTest, NumberObject)
   EXPECT_TRUE(obj.operator bool());
 
   EXPECT_EQ(obj.number(), num);
+}
+
+TEST(ObjectTest, IntegerObject)
+{
+  auto obj = Lox::Object::fromInteger(42);
+
+  EXPECT_TRUE(obj.isNumber());
+  EXPECT_TRUE(obj.isInteger());
+  EXPECT_TRUE(obj.operator bool());
+
+  EXPECT_EQ(obj.integer(), 42);
+  EXPECT_EQ(obj.number(), 42.0);
+
+  // out of the exactly representable range it is a plain double
+  auto big = Lox::Object::fromInteger(Lox::Object::max_integer + 1);
+
+  EXPECT_TRUE(big.isNumber());
+  EXPECT_FALSE(big.isInteger());
+}
+
+TEST(ObjectTest, MovesDontCopy)
+{
+  auto obj = Lox::Object{ std::string{ "a string too long for small buffers" } };
+  auto copies = Lox::Object::copies();
+
+  auto moved = std::move(obj);
+  auto assigned = Lox::Object{};
+  assigned = std::move(moved);
+
+  EXPECT_EQ(Lox::Object::copies(), copies);
+  EXPECT_EQ(assigned.string(), "a string too long for small buffers");
+
+  auto copy = assigned;
+  EXPECT_EQ(Lox::Object::copies(), copies + 1UL);
+  EXPECT_EQ(copy.string(), assigned.string());
 }
\ No newline at end of file